@@ -4,11 +4,35 @@
 #include"util.h"
 #endif
 #include "utf8.h"
+#include "AstArena.h"
 
 #ifndef ASTNODE_H
 #define ASTNODE_H
 #endif
 
+// AST ڵ
+enum class NodeKind {
+	// ʽ
+	CALL,
+	NUMBER,
+	CHAR,
+	BOOL,
+	VAR,
+	ARRAY,
+	ARRAY_ELEM,
+	BINARY,
+	// 
+	EXPR_STMT,
+	ASSIGN,
+	IF,
+	RETURN,
+	FUNCTION_DEF,
+	FOR,
+	WHILE,
+	INPUT,
+	OUTPUT,
+};
+
 enum class SymbolType { VAR, CONST, FUNC };
 
 inline std::string valueTypeToString(TokenType a) {
@@ -60,6 +84,8 @@ inline TokenType stringTovalueType(std::string a) {
 		return TokenType::VOID;
 }
 
+struct Symbol;   //  Semantic Analyzer.hAST ֻ󶨺ָ
+
 #if 0
 struct Symbol {
 	std::string name;
@@ -78,9 +104,22 @@ struct Symbol {
 */
 class ASTNode {
 public:
+	// ڵǩ pass  switch ɣ dynamic_cast
+	const NodeKind kind;
+
+	ASTNode(NodeKind kind) :kind(kind) {}
 	virtual ~ASTNode() = default;
 };
 
+/*
+* ǩתͲʱ nullptr
+* ÷ dynamic_cast ֻͬȽһ
+*/
+template<typename T>
+inline T* node_cast(ASTNode* node) {
+	return (node && node->kind == T::classKind) ? static_cast<T*>(node) : nullptr;
+}
+
 /*
 * ʽڵ
 * 壺ʾпԲֵ﷨Ԫ
@@ -88,18 +127,24 @@ public:
 */
 class ExprNode : public ASTNode {
 public:
-	std::vector<uint32_t> name;
-	ExprNode() {}
-	ExprNode(const std::vector<uint32_t>& name) :name(name) {}
+	SymId name = 0;
+	// ƶϳֻͣһΣ pass ֱӶȡ
+	TokenType type = TokenType::UNKNOWN;
+	bool typed = false;     // type ǷѾƶϹUNKNOWN ҲǺϷ
+	ExprNode(NodeKind kind) :ASTNode(kind) {}
+	ExprNode(NodeKind kind, SymId name) :ASTNode(kind), name(name) {}
 	virtual bool isAssignable() const { return false; }
 };
 
 class CallExpr : public ExprNode {
 public:
-	std::vector<uint32_t> callee;  // 
-	std::vector<ExprNode*> args;   // ʽб
-	CallExpr(const std::vector<uint32_t>& callee, const std::vector<ExprNode*>& args)
-		: callee(callee), args(args) {
+	static constexpr NodeKind classKind = NodeKind::CALL;
+
+	SymId callee;                  // 
+	Span<ExprNode*> args;          // ʽб
+	Symbol* fn = nullptr;          // 󶨵ĺţѡأ
+	CallExpr(SymId callee, Span<ExprNode*> args)
+		: ExprNode(classKind), callee(callee), args(args) {
 
 	}
 };
@@ -114,12 +159,13 @@ public:
 */
 class NumberExpr :public ExprNode {
 public:
+	static constexpr NodeKind classKind = NodeKind::NUMBER;
 	double value;
 
-	NumberExpr(const std::vector<uint32_t>& v):
-		value(std::stod(uint32tsToString(v))) {}
+	NumberExpr(SymId v):
+		ExprNode(classKind), value(std::stod(symName(v))) {}
 
-	NumberExpr(double val) :value(val) {}
+	NumberExpr(double val) :ExprNode(classKind), value(val) {}
 };
 
 /*
@@ -131,13 +177,12 @@ public:
 */
 class CharExpr :public ExprNode {
 public:
-	std::string value;
+	static constexpr NodeKind classKind = NodeKind::CHAR;
+	SymId value;
 
-	CharExpr(const std::vector<uint32_t>& v) :
-		value(uint32tsToString(v)) {
+	CharExpr(SymId v) :
+		ExprNode(classKind), value(v) {
 	}
-
-	CharExpr(std::string& val) :value(val) {}
 };
 
 /*
@@ -149,24 +194,25 @@ public:
 */
 class BoolExpr :public ExprNode {
 public:
+	static constexpr NodeKind classKind = NodeKind::BOOL;
 	bool value;
 
-	BoolExpr(const std::vector<uint32_t>& v){
-		std::string s = uint32tsToString(v);
+	BoolExpr(SymId v) :ExprNode(classKind) {
+		const std::string& s = symName(v);
 		if (s == "true")
 			value = true;
 		else
 			value = false;
 	}
 
-	BoolExpr(TokenType t) {
+	BoolExpr(TokenType t) :ExprNode(classKind) {
 		if (t == TokenType::TRUE)
 			value = true;
 		else
 			value = false;
 	}
 
-	BoolExpr(bool val) :value(val) {}
+	BoolExpr(bool val) :ExprNode(classKind), value(val) {}
 };
 
 /*
@@ -178,31 +224,35 @@ public:
 */
 class VarExpr :public ExprNode {
 public:
+	static constexpr NodeKind classKind = NodeKind::VAR;
+	Symbol* symbol = nullptr;   // 󶨵ıţ pass ٲ
 
-	VarExpr(const std::vector<uint32_t>& name):
-		ExprNode(name){ }
+	VarExpr(SymId name):
+		ExprNode(classKind, name){ }
 	virtual bool isAssignable() const override { return true; }
 };
 
 class ArrayExpr :public ExprNode {
 public:
-	std::vector<ExprNode*> elem;
-	TokenType type;
+	static constexpr NodeKind classKind = NodeKind::ARRAY;
+	Span<ExprNode*> elem;
 
-	ArrayExpr(const std::vector<ExprNode*>& elem, const std::vector<uint32_t>& name) :
-		elem(elem), ExprNode(name) {
+	ArrayExpr(Span<ExprNode*> elem, SymId name) :
+		ExprNode(classKind, name), elem(elem) {
 	}
 
-	ArrayExpr(const std::vector<ExprNode*>& elem) :
-		elem(elem){
+	ArrayExpr(Span<ExprNode*> elem) :
+		ExprNode(classKind), elem(elem){
 	}
 };
 
 class ArrayElemExpr :public ExprNode {
 public:
+	static constexpr NodeKind classKind = NodeKind::ARRAY_ELEM;
 	ExprNode* index;
+	Symbol* symbol = nullptr;   // 󶨵
 	bool isAssignable() const override { return true; }
-	ArrayElemExpr(const std::vector<uint32_t>& name,ExprNode* index) :index(index), ExprNode(name) {}
+	ArrayElemExpr(SymId name,ExprNode* index) :ExprNode(classKind, name), index(index) {}
 };
 
 /*
@@ -215,19 +265,20 @@ public:
 */
 class BinaryExpr :public ExprNode {
 public:
+	static constexpr NodeKind classKind = NodeKind::BINARY;
 	ExprNode* left;
-	std::vector<uint32_t> op;
+	SymId op;
 	ExprNode* right;
 
 	BinaryExpr(ExprNode* left,
-	const std::vector<uint32_t>& op,
+	SymId op,
 	ExprNode* right):
-		left(left),op(op),right(right){ }
+		ExprNode(classKind), left(left),op(op),right(right){ }
 
 	BinaryExpr(ExprNode* left,
 		const std::string& op,
 		ExprNode* right) :
-		left(left), op(stringToUint32ts(op)), right(right) {
+		ExprNode(classKind), left(left), op(intern(op)), right(right) {
 	}
 };
 
@@ -238,7 +289,10 @@ public:
 * 壺ʾڵ㣨ִֵж
 * ãֱʽ䣬ʹ
 */
-class Statement :public ASTNode {};
+class Statement :public ASTNode {
+public:
+	Statement(NodeKind kind) :ASTNode(kind) {}
+};
 
 /* 
 * ʽ
@@ -246,9 +300,10 @@ class Statement :public ASTNode {};
 */ 
 class ExprStmt :public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::EXPR_STMT;
 	ExprNode* expr;
 
-	ExprStmt(ExprNode* e) : expr(e) {}
+	ExprStmt(ExprNode* e) : Statement(classKind), expr(e) {}
 };
 
 /*
@@ -260,20 +315,19 @@ public:
 */
 class AssignStmt :public Statement {
 public:
-	std::vector<uint32_t> varName;
+	static constexpr NodeKind classKind = NodeKind::ASSIGN;
+	SymId varName = 0;
 	ExprNode* value;
-#if 0
 	Symbol* symbol = nullptr; // ׶ΰ󶨷ű
-#endif
 	bool isConst = false;
 
-	AssignStmt() {}
+	AssignStmt() :Statement(classKind) {}
 
-	AssignStmt(const std::vector<uint32_t>& name, ExprNode* value, bool isConst) :
-		varName(name), value(value), isConst(isConst) {
+	AssignStmt(SymId name, ExprNode* value, bool isConst) :
+		Statement(classKind), varName(name), value(value), isConst(isConst) {
 	}
 
-	AssignStmt(BinaryExpr* b) {
+	AssignStmt(BinaryExpr* b) :Statement(classKind) {
 		varName = b->left->name;
 		isConst = false;
 	}
@@ -288,12 +342,13 @@ public:
 */
 class IfStmt :public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::IF;
 	ExprNode* condition;
-	std::vector<Statement*> body;
+	Span<Statement*> body;
 
 	IfStmt(ExprNode* condition,
-		const std::vector<Statement*>& body) :
-		condition(condition), body(body) {
+		Span<Statement*> body) :
+		Statement(classKind), condition(condition), body(body) {
 	}
 };
 
@@ -306,9 +361,10 @@ public:
 */
 class ReturnStmt :public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::RETURN;
 	ExprNode* value;
 
-	ReturnStmt(ExprNode* value):value(value){}
+	ReturnStmt(ExprNode* value):Statement(classKind), value(value){}
 };
 
 /*
@@ -320,15 +376,17 @@ public:
 */
 class FunctionDef :public Statement {
 public:
-	std::vector<uint32_t> name;
-	std::vector<Param> params; // (type, name)
-	std::vector<Statement*> body;
+	static constexpr NodeKind classKind = NodeKind::FUNCTION_DEF;
+	SymId name;
+	Span<Param> params; // (type, name)
+	Span<Statement*> body;
 	TokenType retType;
+	Symbol* symbol = nullptr;   // 󶨵ĺţ͵֣
 
-	FunctionDef(const std::vector<uint32_t>& name,
-		const std::vector<Param>& params,
-		const std::vector<Statement*>& body) :
-		name(name), params(params), body(body) {
+	FunctionDef(SymId name,
+		Span<Param> params,
+		Span<Statement*> body) :
+		Statement(classKind), name(name), params(params), body(body) {
 	}
 };
 
@@ -337,18 +395,19 @@ public:
 */
 class ForStmt :public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::FOR;
 	ExprNode* param;
 	ExprNode* startExpr;  // a
 	ExprNode* endExpr;    // b
 	ExprNode* stepExpr;   // cΪ nullptr
-	std::vector<Statement*> body;
+	Span<Statement*> body;
 
 	ForStmt(ExprNode* param,
 		ExprNode* startExpr,  // a
 	ExprNode* endExpr,    // b
 	ExprNode* stepExpr,   // cΪ nullptr
-		const std::vector<Statement*>& body) :
-		param(param), startExpr(startExpr), endExpr(endExpr),
+		Span<Statement*> body) :
+		Statement(classKind), param(param), startExpr(startExpr), endExpr(endExpr),
 		stepExpr(stepExpr), body(body) {
 	}
 };
@@ -358,24 +417,27 @@ public:
 */
 class WhileStmt :public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::WHILE;
 	ExprNode* condition;
-	std::vector<Statement*> body;
+	Span<Statement*> body;
 
 	WhileStmt(ExprNode* condition,
-		const std::vector<Statement*>& body) :
-		condition(condition), body(body) {
+		Span<Statement*> body) :
+		Statement(classKind), condition(condition), body(body) {
 	}
 };
 
 class InputStmt : public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::INPUT;
 	ExprNode* expr;
-	InputStmt(ExprNode* e) : expr(e) {}
+	InputStmt(ExprNode* e) : Statement(classKind), expr(e) {}
 };
 
 class OutputStmt : public Statement {
 public:
+	static constexpr NodeKind classKind = NodeKind::OUTPUT;
 	ExprNode* expr;
-	OutputStmt(ExprNode* e) : expr(e) {}
+	OutputStmt(ExprNode* e) : Statement(classKind), expr(e) {}
 };
 
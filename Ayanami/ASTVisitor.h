@@ -0,0 +1,72 @@
+#pragma once
+#ifndef ASTNODE_H
+#define ASTNODE_H
+#include"ASTNode.h"
+#endif
+
+/*
+* AST ܣCRTP
+* 壺 ASTNode::kind һ switch ɵ visitXxx
+* ã
+*	IR ɵ pass ̳ dynamic_cast ̽
+*	ֻʵֹĵĽڵ㣬δʵֵıʽ ExprResult()ʲôҲ
+* ÷
+*	class Pass : public ASTVisitor<Pass, TokenType> { ... };
+*	 visitXxx Ϊ privateҪ ASTVisitor ΪԪ
+*/
+template<typename Derived, typename ExprResult, typename StmtResult = void>
+class ASTVisitor {
+public:
+	ExprResult dispatchExpr(ExprNode* e) {
+		switch (e->kind) {
+		case NodeKind::NUMBER:     return derived().visitNumber(static_cast<NumberExpr*>(e));
+		case NodeKind::CHAR:       return derived().visitChar(static_cast<CharExpr*>(e));
+		case NodeKind::BOOL:       return derived().visitBool(static_cast<BoolExpr*>(e));
+		case NodeKind::VAR:        return derived().visitVar(static_cast<VarExpr*>(e));
+		case NodeKind::ARRAY:      return derived().visitArray(static_cast<ArrayExpr*>(e));
+		case NodeKind::ARRAY_ELEM: return derived().visitArrayElem(static_cast<ArrayElemExpr*>(e));
+		case NodeKind::BINARY:     return derived().visitBinary(static_cast<BinaryExpr*>(e));
+		case NodeKind::CALL:       return derived().visitCall(static_cast<CallExpr*>(e));
+		default:                   return ExprResult();
+		}
+	}
+
+	StmtResult dispatchStmt(Statement* s) {
+		switch (s->kind) {
+		case NodeKind::EXPR_STMT:    return derived().visitExpr(static_cast<ExprStmt*>(s));
+		case NodeKind::ASSIGN:       return derived().visitAssign(static_cast<AssignStmt*>(s));
+		case NodeKind::IF:           return derived().visitIf(static_cast<IfStmt*>(s));
+		case NodeKind::RETURN:       return derived().visitReturn(static_cast<ReturnStmt*>(s));
+		case NodeKind::FUNCTION_DEF: return derived().visitFunctionDef(static_cast<FunctionDef*>(s));
+		case NodeKind::FOR:          return derived().visitFor(static_cast<ForStmt*>(s));
+		case NodeKind::WHILE:        return derived().visitWhile(static_cast<WhileStmt*>(s));
+		case NodeKind::INPUT:        return derived().visitInput(static_cast<InputStmt*>(s));
+		case NodeKind::OUTPUT:       return derived().visitOutput(static_cast<OutputStmt*>(s));
+		default:                     return StmtResult();
+		}
+	}
+
+protected:
+	// ---------- Ĭʵ֣ఴ踲ǣͬؼɣ virtual ----------
+	ExprResult visitNumber(NumberExpr*) { return ExprResult(); }
+	ExprResult visitChar(CharExpr*) { return ExprResult(); }
+	ExprResult visitBool(BoolExpr*) { return ExprResult(); }
+	ExprResult visitVar(VarExpr*) { return ExprResult(); }
+	ExprResult visitArray(ArrayExpr*) { return ExprResult(); }
+	ExprResult visitArrayElem(ArrayElemExpr*) { return ExprResult(); }
+	ExprResult visitBinary(BinaryExpr*) { return ExprResult(); }
+	ExprResult visitCall(CallExpr*) { return ExprResult(); }
+
+	StmtResult visitExpr(ExprStmt*) { return StmtResult(); }
+	StmtResult visitAssign(AssignStmt*) { return StmtResult(); }
+	StmtResult visitIf(IfStmt*) { return StmtResult(); }
+	StmtResult visitReturn(ReturnStmt*) { return StmtResult(); }
+	StmtResult visitFunctionDef(FunctionDef*) { return StmtResult(); }
+	StmtResult visitFor(ForStmt*) { return StmtResult(); }
+	StmtResult visitWhile(WhileStmt*) { return StmtResult(); }
+	StmtResult visitInput(InputStmt*) { return StmtResult(); }
+	StmtResult visitOutput(OutputStmt*) { return StmtResult(); }
+
+private:
+	Derived& derived() { return *static_cast<Derived*>(this); }
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+*  arena еֻͼ
+*  AST ڵ std::vectorڵ㱾ٳжڴ
+*/
+template<typename T>
+class Span {
+public:
+	Span() = default;
+	Span(T* data, uint32_t count) :ptr(data), count(count) {}
+
+	T* begin() const { return ptr; }
+	T* end() const { return ptr + count; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T& operator[](size_t i) const { return ptr[i]; }
+	T& back() const { return ptr[count - 1]; }
+
+private:
+	T* ptr = nullptr;
+	uint32_t count = 0;
+};
+
+/*
+* AST ڴأbump allocator
+* 壺һ뵥Ԫ AST ڵ㼰ӽڵ鶼
+* ã
+*	ڵ㰴˳УʱѺ
+*	뵥Ԫʱͷţ deleteҲй©
+* ע⣺arena ŽĽڵԱܳжڴ
+*	 SymIdӽڵ Span
+*/
+class AstArena {
+public:
+	AstArena() = default;
+	AstArena(const AstArena&) = delete;
+	AstArena& operator=(const AstArena&) = delete;
+
+	void* allocate(size_t size, size_t align) {
+		uintptr_t p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+		if (!cur || p + size > (uintptr_t)limit) {
+			grow(size + align);
+			p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+		}
+		cur = (char*)(p + size);
+		return (void*)p;
+	}
+
+	template<typename T, typename... Args>
+	T* make(Args&&... args) {
+		void* mem = allocate(sizeof(T), alignof(T));
+		return new (mem) T(std::forward<Args>(args)...);
+	}
+
+	// ѽʱʱռӽڵ㿽 arena
+	template<typename T>
+	Span<T> copy(const std::vector<T>& items) {
+		static_assert(std::is_trivially_copyable<T>::value, "arena spans hold trivially copyable elements only");
+		if (items.empty())
+			return Span<T>();
+		T* mem = (T*)allocate(sizeof(T) * items.size(), alignof(T));
+		std::memcpy(mem, items.data(), sizeof(T) * items.size());
+		return Span<T>(mem, (uint32_t)items.size());
+	}
+
+	// ѷֽβδò֣
+	size_t bytesReserved() const {
+		return reserved;
+	}
+
+private:
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	char* cur = nullptr;
+	char* limit = nullptr;
+	size_t reserved = 0;
+
+	void grow(size_t atLeast) {
+		size_t size = atLeast > BLOCK_SIZE ? atLeast : BLOCK_SIZE;
+		blocks.emplace_back(new char[size]);
+		cur = blocks.back().get();
+		limit = cur + size;
+		reserved += size;
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* λ
+* ãԾȣеļϣ±ɸԼ
+*/
+class BitSet {
+public:
+    explicit BitSet(size_t n = 0) :words((n + 63) / 64, 0) {}
+
+    void set(uint32_t i) { words[i >> 6] |= 1ull << (i & 63); }
+    void reset(uint32_t i) { words[i >> 6] &= ~(1ull << (i & 63)); }
+    bool test(uint32_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+
+    // this |= oǷб仯
+    bool merge(const BitSet& o) {
+        bool changed = false;
+        for (size_t k = 0; k < words.size(); k++) {
+            uint64_t w = words[k] | o.words[k];
+            changed |= w != words[k];
+            words[k] = w;
+        }
+        return changed;
+    }
+
+    // this = gen | (this & ~kill)
+    void transfer(const BitSet& gen, const BitSet& kill) {
+        for (size_t k = 0; k < words.size(); k++)
+            words[k] = gen.words[k] | (words[k] & ~kill.words[k]);
+    }
+
+    // ±СÿԪص f(uint32_t)
+    template<typename F>
+    void forEach(F&& f) const {
+        for (size_t k = 0; k < words.size(); k++)
+            for (uint64_t w = words[k], b = 0; w; w >>= 1, b++)
+                if (w & 1)
+                    f((uint32_t)(k * 64 + b));
+    }
+
+    bool operator==(const BitSet& o) const { return words == o.words; }
+
+private:
+    std::vector<uint64_t> words;
+};
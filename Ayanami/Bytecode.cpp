@@ -0,0 +1,568 @@
+#include "Bytecode.h"
+#include "CFG.h"
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+TokenType elementType(TokenType arr) {
+    switch (arr) {
+    case TokenType::ARR_INT:   return TokenType::INT;
+    case TokenType::ARR_FLOAT: return TokenType::FLOAT;
+    case TokenType::ARR_CHAR:  return TokenType::CHAR;
+    case TokenType::ARR_BOOL:  return TokenType::BOOL;
+    default:                   return TokenType::UNKNOWN;
+    }
+}
+
+bool isIntegral(TokenType t) {
+    return t == TokenType::INT || t == TokenType::CHAR || t == TokenType::BOOL;
+}
+
+// from ͵ֵд to ʱǷҪתchar / bool ڼĴѾǷչ int
+bool needsConversion(TokenType from, TokenType to) {
+    if (from == to)
+        return false;
+    switch (to) {
+    case TokenType::FLOAT: return isIntegral(from);
+    case TokenType::INT:   return from == TokenType::FLOAT;
+    case TokenType::CHAR:  return from == TokenType::FLOAT || from == TokenType::INT;
+    case TokenType::BOOL:  return from == TokenType::FLOAT || from == TokenType::INT || from == TokenType::CHAR;
+    default:               return false;
+    }
+}
+
+// double ת intΧ NaNʱ cvttsd2si һõ INT_MIN
+int64_t floatToInt(double f) {
+    return f > -2147483649.0 && f < 2147483648.0 ? (int32_t)f : INT32_MIN;
+}
+
+class FunctionCompiler {
+public:
+    FunctionCompiler(IRProgram& prog, const IRFunction& fn,
+        const std::unordered_map<SymId, uint32_t>& functionIndex, BcFunction& out)
+        :prog(prog), fn(fn), functionIndex(functionIndex), out(out) {
+    }
+
+    void run() {
+        out.name = symName(fn.name);
+        out.retType = fn.retType;
+        const auto& all = prog.getInstructions();
+        code.assign(all.begin() + fn.begin + 1, all.begin() + fn.end);
+        assignRegisters();
+
+        for (size_t k = 0; k < code.size(); k++) {
+            nextScratch = 0;
+            const IRInstruction* next = k + 1 < code.size() ? &code[k + 1] : nullptr;
+            if (compile(code[k], next))
+                k++;
+        }
+        emit(Op::RET_VOID);
+
+        for (auto& f : fixups) {
+            auto it = labels.find(f.second);
+            if (it == labels.end())
+                throw std::runtime_error("bytecode: jump to undefined label in " + out.name);
+            out.code[f.first].c = (uint16_t)it->second;
+        }
+        if (out.code.size() > 0xFFFF || out.argPool.size() > 0xFFFF)
+            throw std::runtime_error("bytecode: function " + out.name + " is too large");
+        size_t regs = (size_t)out.constBase + out.consts.size();
+        if (regs >= BcInstr::NO_REG)
+            throw std::runtime_error("bytecode: function " + out.name + " uses too many registers");
+        out.regs = (uint16_t)regs;
+    }
+
+private:
+    IRProgram& prog;
+    const IRFunction& fn;
+    const std::unordered_map<SymId, uint32_t>& functionIndex;
+    BcFunction& out;
+
+    std::vector<IRInstruction> code;
+    std::unordered_map<uint64_t, uint16_t> regs;            // operandKey -> Ĵ
+    std::unordered_map<SymId, TokenType> varTypes;
+    std::unordered_set<SymId> refParams;
+    std::unordered_map<uint32_t, uint32_t> tempUses;
+    std::map<std::pair<bool, uint64_t>, uint16_t> consts;  // (Ƿ double, λ) -> Ĵ
+    uint16_t scratchBase = 0, scratchCount = 0, nextScratch = 0;
+    std::unordered_map<uint32_t, uint32_t> labels;          // ǩ -> ָ±
+    std::vector<std::pair<uint32_t, uint32_t>> fixups;      // תָ±, ǩ
+
+    // ---------- Ĵ ----------
+
+    /*
+    * βռǰĴ TEMP / VAR ˳ţ
+    * ÿ IR ָõ 8 + 3 * ʵθ ʱĴÿԪءת±ꡢת͸һ
+    */
+    void assignRegisters() {
+        size_t next = 0;
+        auto add = [&](const Operand& o) {
+            if (regs.emplace(operandKey(o), (uint16_t)next).second)
+                next++;
+        };
+        for (const Param& p : fn.params) {
+            varTypes[p.name] = p.type;
+            if (p.isRef)
+                refParams.insert(p.name);
+            add(Operand::var(p.name));
+        }
+        out.params = (uint16_t)fn.params.size();
+
+        uint32_t maxArgs = 0;
+        for (IRInstruction& instr : code) {
+            if (Operand* d = defOf(instr)) {
+                if (d->isVar())
+                    varTypes.emplace(d->id, instr.resType);
+                add(*d);
+            }
+            forEachUse(prog, instr, [&](Operand& o) {
+                add(o);
+                if (o.isTemp())
+                    tempUses[o.id]++;
+            });
+            auto arrayOf = [&](const Operand& o) {
+                if (o.kind == OperandKind::ELEM)
+                    add(Operand::var(o.id));
+            };
+            arrayOf(instr.result);
+            arrayOf(instr.op1);
+            arrayOf(instr.op2);
+            if (instr.type == IRType::CALL) {
+                maxArgs = std::max(maxArgs, instr.argCount);
+                const Operand* a = prog.args(instr);
+                for (uint32_t k = 0; k < instr.argCount; k++)
+                    arrayOf(a[k]);
+            }
+        }
+        scratchCount = (uint16_t)std::min<size_t>(8 + 3 * (size_t)maxArgs, 0xFFFF);
+        if (next + scratchCount >= BcInstr::NO_REG)
+            throw std::runtime_error("bytecode: function " + out.name + " uses too many registers");
+        scratchBase = (uint16_t)next;
+        out.constBase = (uint16_t)(next + scratchCount);
+    }
+
+    uint16_t scratch() {
+        if (nextScratch >= scratchCount)
+            throw std::logic_error("bytecode: out of scratch registers");
+        return scratchBase + nextScratch++;
+    }
+
+    uint16_t regOf(const Operand& o) const {
+        auto it = regs.find(operandKey(o));
+        if (it == regs.end())
+            throw std::runtime_error("bytecode: no register for " + prog.str(o));
+        return it->second;
+    }
+
+    bool isRefParam(const Operand& o) const {
+        return o.isVar() && refParams.count(o.id);
+    }
+
+    // ֱӵĴдĲ
+    bool isPlain(const Operand& o) const {
+        return o.isLocation() && !isRefParam(o);
+    }
+
+    TokenType typeOf(const Operand& o) const {
+        switch (o.kind) {
+        case OperandKind::TEMP:
+            return prog.tempType(o.id);
+        case OperandKind::VAR: {
+            auto it = varTypes.find(o.id);
+            return it == varTypes.end() ? TokenType::INT : it->second;
+        }
+        case OperandKind::FLOAT:
+            return TokenType::FLOAT;
+        case OperandKind::CHAR:
+            return TokenType::CHAR;
+        case OperandKind::ELEM:
+            return elementType(typeOf(Operand::var(o.id)));
+        default:
+            return TokenType::INT;
+        }
+    }
+
+    TokenType elementOf(const Operand& arr, TokenType fallback) const {
+        TokenType t = elementType(typeOf(arr));
+        return t == TokenType::UNKNOWN ? fallback : t;
+    }
+
+    //  C++ Ĺת to ͺŽĴ
+    uint16_t constAs(const Operand& o, TokenType to) {
+        bool isFloat = o.kind == OperandKind::FLOAT;
+        double f = o.f;
+        int64_t i = o.kind == OperandKind::CHAR ? (int8_t)o.i : (int32_t)o.i;
+        Value v;
+        switch (to) {
+        case TokenType::FLOAT:
+            v.f = isFloat ? f : (double)i;
+            break;
+        case TokenType::CHAR:
+            v.i = (int8_t)(isFloat ? floatToInt(f) : i);
+            break;
+        case TokenType::BOOL:
+            v.i = isFloat ? f != 0 : i != 0;
+            break;
+        default:
+            if (isFloat && to != TokenType::INT) {
+                v.f = f;
+                to = TokenType::FLOAT;
+            }
+            else
+                v.i = isFloat ? floatToInt(f) : i;
+            break;
+        }
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof bits);
+        auto it = consts.emplace(std::make_pair(to == TokenType::FLOAT, bits), (uint16_t)(out.constBase + out.consts.size()));
+        if (it.second)
+            out.consts.push_back(v);
+        return it.first->second;
+    }
+
+    // ---------- д ----------
+
+    void emit(Op op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0) {
+        BcInstr instr;
+        instr.op = op;
+        instr.a = a;
+        instr.b = b;
+        instr.c = c;
+        out.code.push_back(instr);
+    }
+
+    void emitJump(Op op, uint32_t label, uint16_t a = 0, uint16_t b = 0) {
+        fixups.push_back({ (uint32_t)out.code.size(), label });
+        emit(op, a, b);
+    }
+
+    void convert(uint16_t dst, uint16_t src, TokenType from, TokenType to) {
+        switch (to) {
+        case TokenType::FLOAT:
+            emit(Op::I2F, dst, src);
+            break;
+        case TokenType::INT:
+            emit(Op::F2I, dst, src);
+            break;
+        case TokenType::CHAR:
+            if (from == TokenType::FLOAT) {
+                emit(Op::F2I, dst, src);
+                src = dst;
+            }
+            emit(Op::I2C, dst, src);
+            break;
+        default:
+            emit(from == TokenType::FLOAT ? Op::F2B : Op::I2B, dst, src);
+            break;
+        }
+    }
+
+    // ڵļĴref βԪȶʱĴ
+    uint16_t read(const Operand& o) {
+        if (o.isImm())
+            return constAs(o, typeOf(o));
+        if (o.kind == OperandKind::ELEM) {
+            uint16_t arr = read(Operand::var(o.id));
+            uint16_t idx = readAs(o.elemIndex(), TokenType::INT);
+            uint16_t r = scratch();
+            emit(Op::LOADE, r, arr, idx);
+            return r;
+        }
+        uint16_t r = regOf(o);
+        if (isRefParam(o)) {
+            uint16_t s = scratch();
+            emit(Op::LOADP, s, r);
+            return s;
+        }
+        return r;
+    }
+
+    uint16_t readAs(const Operand& o, TokenType to) {
+        if (o.isImm())
+            return constAs(o, to);
+        TokenType from = typeOf(o);
+        uint16_t r = read(o);
+        if (!needsConversion(from, to))
+            return r;
+        uint16_t s = scratch();
+        convert(s, r, from, to);
+        return s;
+    }
+
+    // дdst ͨĴҲתʱֱд
+    uint16_t target(const Operand& dst, TokenType produced) {
+        if (isPlain(dst) && !needsConversion(produced, typeOf(dst)))
+            return regOf(dst);
+        return scratch();
+    }
+
+    // ѼĴ r  produced ͵ֵ dst д dst
+    void finish(const Operand& dst, uint16_t r, TokenType produced) {
+        TokenType to = typeOf(dst);
+        if (isPlain(dst)) {
+            uint16_t d = regOf(dst);
+            if (needsConversion(produced, to))
+                convert(d, r, produced, to);
+            else if (d != r)
+                emit(Op::MOV, d, r);
+            return;
+        }
+        uint16_t v = r;
+        if (needsConversion(produced, to)) {
+            v = scratch();
+            convert(v, r, produced, to);
+        }
+        if (dst.kind == OperandKind::ELEM) {
+            uint16_t arr = read(Operand::var(dst.id));
+            uint16_t idx = readAs(dst.elemIndex(), TokenType::INT);
+            emit(Op::STOREE, arr, idx, v);
+        }
+        else if (isRefParam(dst))
+            emit(Op::STOREP, regOf(dst), v);
+        else
+            throw std::runtime_error("bytecode: cannot write to " + prog.str(dst));
+    }
+
+    // ref ʵεĵַ
+    uint16_t addressOf(const Operand& a) {
+        if (isRefParam(a))
+            return regOf(a);
+        uint16_t s;
+        if (a.kind == OperandKind::ELEM) {
+            uint16_t arr = read(Operand::var(a.id));
+            uint16_t idx = readAs(a.elemIndex(), TokenType::INT);
+            s = scratch();
+            emit(Op::ADDRE, s, arr, idx);
+        }
+        else if (a.isLocation()) {
+            s = scratch();
+            emit(Op::ADDR, s, regOf(a));
+        }
+        else
+            throw std::runtime_error("bytecode: ref argument is not a location");
+        return s;
+    }
+
+    // ---------- ָ ----------
+
+    static bool truthOfImm(const Operand& c) {
+        return c.kind == OperandKind::FLOAT ? c.f != 0 :
+            (c.kind == OperandKind::CHAR ? (int8_t)c.i : c.i) != 0;
+    }
+
+    // int ȽϺֻһεתϲɱȽתǷϲ
+    bool fuseCompare(const IRInstruction& cmp, const IRInstruction* next, uint16_t b, uint16_t c) {
+        if (!next || !cmp.result.isTemp() || tempUses[cmp.result.id] != 1)
+            return false;
+        if ((next->type != IRType::IF_TRUE_GOTO && next->type != IRType::IF_FALSE_GOTO) || next->op1 != cmp.result)
+            return false;
+        bool onTrue = next->type == IRType::IF_TRUE_GOTO;
+        Op op;
+        switch (cmp.type) {
+        case IRType::LESS:        op = onTrue ? Op::JLT_I : Op::JGE_I; break;
+        case IRType::GREATER:     op = onTrue ? Op::JGT_I : Op::JLE_I; break;
+        case IRType::EQUAL_EQUAL: op = onTrue ? Op::JEQ_I : Op::JNE_I; break;
+        default:                  op = onTrue ? Op::JNE_I : Op::JEQ_I; break;
+        }
+        emitJump(op, next->result.id, b, c);
+        return true;
+    }
+
+    // һ IR ָһϲʱ true
+    bool compile(const IRInstruction& instr, const IRInstruction* next) {
+        switch (instr.type) {
+        case IRType::ADD:
+        case IRType::SUB:
+        case IRType::MUL:
+        case IRType::DIV: {
+            bool fl = typeOf(instr.op1) == TokenType::FLOAT || typeOf(instr.op2) == TokenType::FLOAT;
+            TokenType t = fl ? TokenType::FLOAT : TokenType::INT;
+            uint16_t b = readAs(instr.op1, t), c = readAs(instr.op2, t);
+            static const Op intOps[] = { Op::ADD_I, Op::SUB_I, Op::MUL_I, Op::DIV_I };
+            static const Op floatOps[] = { Op::ADD_F, Op::SUB_F, Op::MUL_F, Op::DIV_F };
+            int k = (int)instr.type - (int)IRType::ADD;
+            uint16_t d = target(instr.result, t);
+            emit(fl ? floatOps[k] : intOps[k], d, b, c);
+            finish(instr.result, d, t);
+            return false;
+        }
+        case IRType::LESS:
+        case IRType::GREATER:
+        case IRType::EQUAL_EQUAL:
+        case IRType::NOT_EQUAL: {
+            bool fl = typeOf(instr.op1) == TokenType::FLOAT || typeOf(instr.op2) == TokenType::FLOAT;
+            TokenType t = fl ? TokenType::FLOAT : TokenType::INT;
+            uint16_t b = readAs(instr.op1, t), c = readAs(instr.op2, t);
+            if (!fl && fuseCompare(instr, next, b, c))
+                return true;
+            static const Op intOps[] = { Op::LT_I, Op::GT_I, Op::EQ_I, Op::NE_I };
+            static const Op floatOps[] = { Op::LT_F, Op::GT_F, Op::EQ_F, Op::NE_F };
+            int k = (int)instr.type - (int)IRType::LESS;
+            uint16_t d = target(instr.result, TokenType::BOOL);
+            emit(fl ? floatOps[k] : intOps[k], d, b, c);
+            finish(instr.result, d, TokenType::BOOL);
+            return false;
+        }
+        case IRType::AND:
+        case IRType::OR: {
+            uint16_t b = readAs(instr.op1, TokenType::BOOL), c = readAs(instr.op2, TokenType::BOOL);
+            uint16_t d = target(instr.result, TokenType::BOOL);
+            emit(instr.type == IRType::AND ? Op::AND : Op::OR, d, b, c);
+            finish(instr.result, d, TokenType::BOOL);
+            return false;
+        }
+        case IRType::ASSIGN:
+        case IRType::CONST_BOOL:
+            if (instr.op1.isImm()) {
+                TokenType t = typeOf(instr.result);
+                finish(instr.result, constAs(instr.op1, t), t);
+            }
+            else
+                finish(instr.result, read(instr.op1), typeOf(instr.op1));
+            return false;
+
+        case IRType::ALLOC_ARR: {
+            uint16_t n = readAs(instr.op1, TokenType::INT);
+            TokenType t = typeOf(instr.result);
+            uint16_t d = target(instr.result, t);
+            emit(Op::NEWARR, d, n);
+            finish(instr.result, d, t);
+            return false;
+        }
+        case IRType::LOAD_ARR: {
+            TokenType elem = elementOf(instr.op1, instr.resType);
+            uint16_t arr = read(instr.op1);
+            uint16_t idx = readAs(instr.op2, TokenType::INT);
+            uint16_t d = target(instr.result, elem);
+            emit(Op::LOADE, d, arr, idx);
+            finish(instr.result, d, elem);
+            return false;
+        }
+        case IRType::STORE_ARR: {
+            TokenType elem = elementOf(instr.result, instr.resType);
+            uint16_t v = readAs(instr.op2, elem);
+            uint16_t arr = read(instr.result);
+            uint16_t idx = readAs(instr.op1, TokenType::INT);
+            emit(Op::STOREE, arr, idx, v);
+            return false;
+        }
+
+        case IRType::CALL:
+            compileCall(instr);
+            return false;
+        case IRType::RETURN:
+            if (instr.op1.isNone())
+                emit(Op::RET_VOID);
+            else
+                emit(Op::RET, readAs(instr.op1, fn.retType));
+            return false;
+
+        case IRType::LABEL:
+            labels[instr.result.id] = (uint32_t)out.code.size();
+            return false;
+        case IRType::GOTO:
+            emitJump(Op::JMP, instr.result.id);
+            return false;
+        case IRType::IF_TRUE_GOTO:
+        case IRType::IF_FALSE_GOTO: {
+            bool onTrue = instr.type == IRType::IF_TRUE_GOTO;
+            const Operand& c = instr.op1;
+            if (c.isImm()) {
+                if (truthOfImm(c) == onTrue)
+                    emitJump(Op::JMP, instr.result.id);
+                return false;
+            }
+            uint16_t r = typeOf(c) == TokenType::FLOAT ? readAs(c, TokenType::BOOL) : read(c);
+            emitJump(onTrue ? Op::JT : Op::JF, instr.result.id, r);
+            return false;
+        }
+
+        case IRType::INPUT: {
+            TokenType t = typeOf(instr.result);
+            TokenType produced = t == TokenType::FLOAT || t == TokenType::CHAR ? t : TokenType::INT;
+            uint16_t d = target(instr.result, produced);
+            emit(t == TokenType::FLOAT ? Op::IN_F : t == TokenType::CHAR ? Op::IN_C : Op::IN_I, d);
+            finish(instr.result, d, produced);
+            return false;
+        }
+        case IRType::OUTPUT: {
+            TokenType t = typeOf(instr.op1);
+            uint16_t r = read(instr.op1);
+            emit(t == TokenType::FLOAT ? Op::OUT_F : t == TokenType::CHAR ? Op::OUT_C : Op::OUT_I, r);
+            return false;
+        }
+
+        case IRType::PARAM:
+        case IRType::FUNC_BEGIN:
+        case IRType::FUNC_END:
+            return false;
+        default:
+            throw std::runtime_error("bytecode: unsupported IR instruction");
+        }
+    }
+
+    void compileCall(const IRInstruction& instr) {
+        auto it = functionIndex.find(instr.op1.id);
+        if (it == functionIndex.end())
+            throw std::runtime_error("bytecode: call to undefined function " + prog.str(instr.op1));
+        const IRFunction& callee = prog.getFunctions()[it->second];
+        const Operand* args = prog.args(instr);
+
+        std::vector<uint16_t> argRegs;
+        for (uint32_t i = 0; i < instr.argCount; i++) {
+            const Param& p = callee.params[i];
+            argRegs.push_back(p.isRef ? addressOf(args[i]) : readAs(args[i], p.type));
+        }
+        uint16_t pool = (uint16_t)std::min<size_t>(out.argPool.size(), 0xFFFF);
+        out.argPool.push_back((uint16_t)argRegs.size());
+        out.argPool.insert(out.argPool.end(), argRegs.begin(), argRegs.end());
+
+        if (instr.result.isNone()) {
+            emit(Op::CALL, BcInstr::NO_REG, (uint16_t)it->second, pool);
+            return;
+        }
+        uint16_t d = target(instr.result, callee.retType);
+        emit(Op::CALL, d, (uint16_t)it->second, pool);
+        finish(instr.result, d, callee.retType);
+    }
+};
+
+}
+
+BcProgram compileBytecode(IRProgram& ir) {
+    const auto& functions = ir.getFunctions();
+    const auto& code = ir.getInstructions();
+
+    //  x86 һ£޴ִ
+    std::vector<char> inside(code.size(), 0);
+    for (const IRFunction& f : functions)
+        for (uint32_t i = f.begin; i <= f.end; i++)
+            inside[i] = 1;
+    for (size_t i = 0; i < code.size(); i++)
+        if (!inside[i])
+            throw std::runtime_error("bytecode: statements outside functions are not supported");
+    if (functions.size() > 0xFFFF)
+        throw std::runtime_error("bytecode: too many functions");
+
+    BcProgram bc;
+    std::unordered_map<SymId, uint32_t> functionIndex;
+    bool hasMain = false;
+    for (uint32_t k = 0; k < functions.size(); k++) {
+        functionIndex[functions[k].name] = k;
+        if (symName(functions[k].name) == "main") {
+            bc.mainIndex = k;
+            hasMain = true;
+        }
+    }
+    if (!hasMain)
+        throw std::runtime_error("bytecode: no main function");
+
+    bc.functions.resize(functions.size());
+    for (uint32_t k = 0; k < functions.size(); k++)
+        FunctionCompiler(ir, functions[k], functionIndex, bc.functions[k]).run();
+    return bc;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "IR.h"
+
+// еֵint / char / bool չ ifloat Ϊ double ref Ϊָ
+union Value {
+    int64_t i;
+    double f;
+    Value* p;
+};
+static_assert(sizeof(Value) == 8, "Value should stay one word");
+
+/*
+* ֽ
+*  a b c ΪĴţתĿָ꣨±꣩ c
+* _I Ϊ int 㣨 32 λƣ_F Ϊ double 㣻תɱʽ
+*/
+#define AYA_OPCODES(X) \
+    X(MOV)      /* a = b */ \
+    X(ADD_I) X(SUB_I) X(MUL_I) X(DIV_I) \
+    X(ADD_F) X(SUB_F) X(MUL_F) X(DIV_F) \
+    X(LT_I) X(GT_I) X(EQ_I) X(NE_I) \
+    X(LT_F) X(GT_F) X(EQ_F) X(NE_F) \
+    X(AND) X(OR)        /*  0/1 */ \
+    X(I2F) X(F2I) X(I2C) X(I2B) X(F2B) \
+    X(JMP)      /*  c */ \
+    X(JT) X(JF) /* a  0 / Ϊ 0 ʱ c */ \
+    X(JLT_I) X(JGE_I) X(JGT_I) X(JLE_I) X(JEQ_I) X(JNE_I)  /* Ƚ a b  c */ \
+    X(NEWARR)   /* a = new[b] */ \
+    X(LOADE)    /* a = b[c] */ \
+    X(STOREE)   /* a[b] = c */ \
+    X(ADDR)     /* a = &b */ \
+    X(ADDRE)    /* a = &b[c] */ \
+    X(LOADP)    /* a = *b */ \
+    X(STOREP)   /* *a = b */ \
+    X(CALL)     /* a =  bʵα argPool[c]ʵμĴ */ \
+    X(RET) X(RET_VOID) \
+    X(IN_I) X(IN_C) X(IN_F) \
+    X(OUT_I) X(OUT_C) X(OUT_F)
+
+enum class Op : uint16_t {
+#define AYA_OPCODE_ENUM(name) name,
+    AYA_OPCODES(AYA_OPCODE_ENUM)
+#undef AYA_OPCODE_ENUM
+};
+
+struct BcInstr {
+    static constexpr uint16_t NO_REG = 0xFFFF;     // CALL Ҫֵʱ a
+
+    Op op;
+    uint16_t a = 0, b = 0, c = 0;
+};
+static_assert(sizeof(BcInstr) == 8, "BcInstr should stay one word");
+
+/*
+* һֽ
+* Ĵ֣[0, params) βΣ֮ TEMP / VARָõʱĴ
+* ڵʱ֡һ𿽱 [constBase, constBase + consts.size())
+*/
+struct BcFunction {
+    std::string name;
+    TokenType retType = TokenType::VOID;
+    uint16_t params = 0;
+    uint16_t regs = 0;
+    uint16_t constBase = 0;
+    std::vector<Value> consts;
+    std::vector<BcInstr> code;
+    std::vector<uint16_t> argPool;
+};
+
+struct BcProgram {
+    std::vector<BcFunction> functions;
+    uint32_t mainIndex = 0;
+};
+
+/*
+* ֽ
+* 壺Ż IRProgram ɼĴʽֽ룬 VM ֱӽִ
+* Լ
+*	ÿ TEMP / VAR ռһĴŽĴ
+*	㰴 C++ Ĺѡ int  double 汾дʱĿͲת C++ ˡx86 һ£
+*	int ȽϺͬһʱתʱϲһȽת
+*	ref βεļĴָ룬д LOADP / STOREP
+*	ûпִеλãֱӱ
+*/
+BcProgram compileBytecode(IRProgram& ir);
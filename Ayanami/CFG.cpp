@@ -0,0 +1,729 @@
+#include "CFG.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+const IRInstruction* BasicBlock::terminator() const {
+    if (!code.empty() && isTerminator(code.back().type))
+        return &code.back();
+    return nullptr;
+}
+
+IRInstruction* BasicBlock::terminator() {
+    if (!code.empty() && isTerminator(code.back().type))
+        return &code.back();
+    return nullptr;
+}
+
+CFG::CFG(IRProgram& prog, const IRFunction& func) :prog(prog), func(func) {
+    labelToBlock.assign(prog.labelCount() + 1, NONE);
+    const auto& code = prog.getInstructions();
+
+    // ûתָıǩչĩβзֻ
+    std::vector<char> jumpedTo(prog.labelCount() + 1, 0);
+    for (uint32_t i = func.begin + 1; i < func.end; i++)
+        if (isTerminator(code[i].type) && code[i].type != IRType::RETURN)
+            jumpedTo[code[i].result.id] = 1;
+
+    uint32_t cur = newBlock();
+    for (uint32_t i = func.begin + 1; i < func.end; i++) {
+        const IRInstruction& instr = code[i];
+        if (instr.type == IRType::LABEL) {
+            if (!jumpedTo[instr.result.id])
+                continue;
+            // ǩ¿飻ǰûбǩֱӸ
+            if (!blocks[cur].code.empty() || blocks[cur].label != 0) {
+                uint32_t next = newBlock();
+                blocks[cur].fallthrough = next;
+                cur = next;
+            }
+            blocks[cur].label = instr.result.id;
+            labelToBlock[instr.result.id] = cur;
+            continue;
+        }
+        blocks[cur].code.push_back(instr);
+        if (isTerminator(instr.type) && i + 1 < func.end) {
+            uint32_t next = newBlock();
+            // GOTO / RETURN ֮󲻻˳ִ
+            if (instr.type == IRType::IF_FALSE_GOTO || instr.type == IRType::IF_TRUE_GOTO)
+                blocks[cur].fallthrough = next;
+            cur = next;
+        }
+    }
+    recomputeEdges();
+}
+
+uint32_t CFG::newBlock() {
+    blocks.emplace_back();
+    layout.push_back((uint32_t)blocks.size() - 1);
+    return (uint32_t)blocks.size() - 1;
+}
+
+uint32_t CFG::blockOfLabel(uint32_t label) const {
+    return label < labelToBlock.size() ? labelToBlock[label] : NONE;
+}
+
+uint32_t CFG::ensureLabel(uint32_t block) {
+    BasicBlock& b = blocks[block];
+    if (b.label == 0) {
+        b.label = prog.newLabel("bb").id;
+        if (labelToBlock.size() <= b.label)
+            labelToBlock.resize(b.label + 1, NONE);
+        labelToBlock[b.label] = block;
+    }
+    return b.label;
+}
+
+void CFG::recomputeEdges() {
+    // phi ǰ±ţǰȼ¾ɵǰ˳
+    std::vector<std::vector<uint32_t>> oldPreds(blocks.size());
+    for (uint32_t id = 0; id < blocks.size(); id++)
+        if (!blocks[id].phis.empty())
+            oldPreds[id] = blocks[id].preds;
+    for (auto& b : blocks) {
+        b.preds.clear();
+        b.succs.clear();
+    }
+    for (uint32_t id = 0; id < blocks.size(); id++) {
+        BasicBlock& b = blocks[id];
+        if (b.dead)
+            continue;
+        const IRInstruction* term = b.terminator();
+        if (term && term->type == IRType::RETURN)
+            continue;
+        if (term && term->type == IRType::GOTO) {
+            b.succs.push_back(blockOfLabel(term->result.id));
+            continue;
+        }
+        // תsuccs[0] Ϊ˳̣succs[1] ΪתĿ
+        if (b.fallthrough != NONE)
+            b.succs.push_back(b.fallthrough);
+        if (term)
+            b.succs.push_back(blockOfLabel(term->result.id));
+    }
+    for (uint32_t id = 0; id < blocks.size(); id++)
+        for (uint32_t s : blocks[id].succs)
+            blocks[s].preds.push_back(id);
+
+    // ǰ phi ³ֵǰΪ NONE
+    for (uint32_t id = 0; id < blocks.size(); id++) {
+        BasicBlock& b = blocks[id];
+        if (b.phis.empty())
+            continue;
+        const auto& old = oldPreds[id];
+        for (Phi& phi : b.phis) {
+            std::vector<Operand> args;
+            for (uint32_t p : b.preds) {
+                size_t k = std::find(old.begin(), old.end(), p) - old.begin();
+                args.push_back(k < old.size() ? phi.args[k] : Operand());
+            }
+            phi.args = args;
+        }
+    }
+}
+
+std::vector<uint32_t> CFG::reversePostorder() const {
+    std::vector<uint32_t> order;
+    std::vector<char> visited(blocks.size(), 0);
+    // ʽջĺ(, һҪĺ±)
+    std::vector<std::pair<uint32_t, size_t>> stack;
+    stack.push_back({ entry, 0 });
+    visited[entry] = 1;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        const BasicBlock& b = blocks[top.first];
+        if (top.second < b.succs.size()) {
+            uint32_t s = b.succs[top.second++];
+            if (!visited[s]) {
+                visited[s] = 1;
+                stack.push_back({ s, 0 });
+            }
+        }
+        else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+uint32_t CFG::intersect(uint32_t a, uint32_t b) const {
+    while (a != b) {
+        while (rpoIndex[a] > rpoIndex[b]) a = blocks[a].idom;
+        while (rpoIndex[b] > rpoIndex[a]) b = blocks[b].idom;
+    }
+    return a;
+}
+
+void CFG::computeDominators() {
+    std::vector<uint32_t> rpo = reversePostorder();
+    rpoIndex.assign(blocks.size(), NONE);
+    for (uint32_t i = 0; i < rpo.size(); i++)
+        rpoIndex[rpo[i]] = i;
+    for (auto& b : blocks) {
+        b.idom = NONE;
+        b.domChildren.clear();
+    }
+    blocks[entry].idom = entry;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            uint32_t b = rpo[i];
+            uint32_t newIdom = NONE;
+            for (uint32_t p : blocks[b].preds) {
+                if (blocks[p].idom == NONE)
+                    continue;
+                newIdom = newIdom == NONE ? p : intersect(p, newIdom);
+            }
+            if (blocks[b].idom != newIdom) {
+                blocks[b].idom = newIdom;
+                changed = true;
+            }
+        }
+    }
+    for (uint32_t b : rpo)
+        if (b != entry)
+            blocks[blocks[b].idom].domChildren.push_back(b);
+}
+
+bool CFG::dominates(uint32_t a, uint32_t b) const {
+    if (blocks[b].idom == NONE)
+        return false;
+    while (true) {
+        if (a == b) return true;
+        if (b == entry) return false;
+        b = blocks[b].idom;
+    }
+}
+
+void CFG::computeFrontiers() {
+    for (auto& b : blocks)
+        b.frontier.clear();
+    for (uint32_t id = 0; id < blocks.size(); id++) {
+        const BasicBlock& b = blocks[id];
+        if (b.idom == NONE || b.preds.size() < 2)
+            continue;
+        for (uint32_t p : b.preds) {
+            uint32_t runner = p;
+            while (runner != NONE && blocks[runner].idom != NONE && runner != b.idom) {
+                auto& df = blocks[runner].frontier;
+                if (std::find(df.begin(), df.end(), id) == df.end())
+                    df.push_back(id);
+                runner = blocks[runner].idom;
+            }
+        }
+    }
+}
+
+size_t CFG::removeUnreachable() {
+    std::vector<char> reachable(blocks.size(), 0);
+    for (uint32_t b : reversePostorder())
+        reachable[b] = 1;
+    size_t removed = 0;
+    for (uint32_t id = 0; id < blocks.size(); id++) {
+        if (blocks[id].dead || reachable[id])
+            continue;
+        blocks[id].dead = true;
+        blocks[id].code.clear();
+        blocks[id].phis.clear();
+        if (blocks[id].label)
+            labelToBlock[blocks[id].label] = NONE;
+        removed++;
+    }
+    if (removed) {
+        layout.erase(std::remove_if(layout.begin(), layout.end(),
+            [&](uint32_t b) { return blocks[b].dead; }), layout.end());
+        recomputeEdges();
+    }
+    return removed;
+}
+
+size_t CFG::removeUnusedLabels() {
+    std::vector<char> used(labelToBlock.size(), 0);
+    for (uint32_t b : layout) {
+        const IRInstruction* term = blocks[b].terminator();
+        if (term && term->type != IRType::RETURN && term->result.id < used.size())
+            used[term->result.id] = 1;
+    }
+    size_t removed = 0;
+    for (uint32_t b : layout) {
+        BasicBlock& blk = blocks[b];
+        if (blk.label == 0 || used[blk.label])
+            continue;
+        labelToBlock[blk.label] = NONE;
+        blk.label = 0;
+        removed++;
+    }
+    return removed;
+}
+
+void CFG::retarget(IRInstruction& term, uint32_t fromBlock, uint32_t toBlock) {
+    if (term.type != IRType::RETURN && blockOfLabel(term.result.id) == fromBlock)
+        term.result = Operand::label(ensureLabel(toBlock));
+}
+
+uint32_t CFG::splitEdge(uint32_t from, uint32_t to) {
+    uint32_t mid = newBlock();
+    // ¿ from ֮˳ִ
+    layout.pop_back();
+    auto pos = std::find(layout.begin(), layout.end(), from);
+    layout.insert(pos == layout.end() ? pos : pos + 1, mid);
+
+    blocks[mid].fallthrough = to;
+    BasicBlock& f = blocks[from];
+    if (f.fallthrough == to)
+        f.fallthrough = mid;
+    if (IRInstruction* term = f.terminator())
+        retarget(*term, to, mid);
+
+    //  from  phi  mid ṩ
+    BasicBlock& t = blocks[to];
+    std::vector<uint32_t> oldPreds = t.preds;
+    std::vector<Operand> fromArgs;
+    size_t k = std::find(oldPreds.begin(), oldPreds.end(), from) - oldPreds.begin();
+    for (const Phi& phi : t.phis)
+        fromArgs.push_back(phi.args[k]);
+    recomputeEdges();
+    size_t m = std::find(t.preds.begin(), t.preds.end(), mid) - t.preds.begin();
+    for (size_t i = 0; i < t.phis.size(); i++)
+        t.phis[i].args[m] = fromArgs[i];
+    return mid;
+}
+
+uint32_t CFG::splitPreds(uint32_t to, const std::vector<uint32_t>& froms) {
+    uint32_t mid = newBlock();
+    // ¿ to ֮ǰ˳ִǰҪת
+    layout.pop_back();
+    layout.insert(std::find(layout.begin(), layout.end(), to), mid);
+    blocks[mid].fallthrough = to;
+
+    // ÿ phi  froms Ĳ
+    std::vector<uint32_t> oldPreds = blocks[to].preds;
+    std::vector<std::vector<Operand>> fromArgs(blocks[to].phis.size());
+    for (uint32_t f : froms) {
+        size_t k = std::find(oldPreds.begin(), oldPreds.end(), f) - oldPreds.begin();
+        for (size_t i = 0; i < blocks[to].phis.size(); i++)
+            fromArgs[i].push_back(k < oldPreds.size() ? blocks[to].phis[i].args[k] : Operand());
+    }
+
+    for (uint32_t f : froms) {
+        if (blocks[f].fallthrough == to)
+            blocks[f].fallthrough = mid;
+        if (IRInstruction* term = blocks[f].terminator())
+            retarget(*term, to, mid);
+    }
+    if (to == entry)
+        entry = mid;
+    recomputeEdges();
+
+    // ǰֱֵͬӴȥ¿ phi
+    BasicBlock& m = blocks[mid];
+    BasicBlock& t = blocks[to];
+    size_t slot = std::find(t.preds.begin(), t.preds.end(), mid) - t.preds.begin();
+    for (size_t i = 0; i < t.phis.size(); i++) {
+        const std::vector<Operand>& args = fromArgs[i];
+        bool same = std::all_of(args.begin(), args.end(), [&](const Operand& a) { return a == args[0]; });
+        if (args.empty() || same) {
+            t.phis[i].args[slot] = args.empty() ? Operand() : args[0];
+            continue;
+        }
+        Phi phi;
+        phi.var = t.phis[i].var;
+        phi.type = t.phis[i].type;
+        phi.dst = prog.newTemp(phi.type);
+        for (uint32_t p : m.preds) {
+            size_t k = std::find(froms.begin(), froms.end(), p) - froms.begin();
+            phi.args.push_back(k < froms.size() ? args[k] : Operand());
+        }
+        t.phis[i].args[slot] = phi.dst;
+        m.phis.push_back(phi);
+    }
+    return mid;
+}
+
+std::vector<Loop> CFG::findLoops() {
+    recomputeEdges();
+    computeDominators();
+    std::vector<Loop> loops;
+    std::vector<uint32_t> loopOfHeader(blocks.size(), NONE);
+    for (uint32_t b : layout) {
+        if (blocks[b].idom == NONE)
+            continue;
+        for (uint32_t s : blocks[b].succs) {
+            if (!dominates(s, b))
+                continue;
+            if (loopOfHeader[s] == NONE) {
+                loopOfHeader[s] = (uint32_t)loops.size();
+                loops.emplace_back();
+                loops.back().header = s;
+            }
+            loops[loopOfHeader[s]].latches.push_back(b);
+        }
+    }
+
+    //  latch űߵ header Ϊֹ
+    for (Loop& loop : loops) {
+        loop.inLoop.assign(blocks.size(), 0);
+        loop.inLoop[loop.header] = 1;
+        loop.blocks.push_back(loop.header);
+        std::vector<uint32_t> work = loop.latches;
+        while (!work.empty()) {
+            uint32_t b = work.back();
+            work.pop_back();
+            if (loop.inLoop[b] || blocks[b].idom == NONE)
+                continue;
+            loop.inLoop[b] = 1;
+            loop.blocks.push_back(b);
+            for (uint32_t p : blocks[b].preds)
+                work.push_back(p);
+        }
+    }
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) {
+        return a.blocks.size() < b.blocks.size();
+    });
+    return loops;
+}
+
+uint32_t CFG::ensurePreheader(Loop& loop) {
+    std::vector<uint32_t> outside;
+    for (uint32_t p : blocks[loop.header].preds)
+        if (!loop.contains(p))
+            outside.push_back(p);
+    if (outside.size() == 1 && blocks[outside[0]].succs.size() == 1) {
+        loop.preheader = outside[0];
+        return loop.preheader;
+    }
+    loop.preheader = splitPreds(loop.header, outside);
+    // ¿ĩβκѭ֧Ҫ
+    computeDominators();
+    return loop.preheader;
+}
+
+// ---------- SSA ----------
+
+void CFG::toSSA() {
+    removeUnreachable();
+    // ڿѭͷʱʼûжӦǰ phi Ȳһյڿ
+    if (!blocks[entry].preds.empty()) {
+        uint32_t b = newBlock();
+        layout.pop_back();
+        layout.insert(layout.begin(), b);
+        blocks[b].fallthrough = entry;
+        entry = b;
+        recomputeEdges();
+    }
+    computeDominators();
+    computeFrontiers();
+
+    // 1. ҳıų ref  ref ıԪص
+    std::unordered_map<uint64_t, uint32_t> varIndex;
+    std::vector<Operand> vars;
+    std::vector<TokenType> varTypes;
+    std::unordered_set<uint64_t> excluded;
+    for (const Param& p : func.params)
+        if (p.isRef)
+            excluded.insert(operandKey(Operand::var(p.name)));
+
+    auto addVar = [&](const Operand& o, TokenType type) {
+        uint64_t key = operandKey(o);
+        auto it = varIndex.find(key);
+        if (it == varIndex.end()) {
+            varIndex.emplace(key, (uint32_t)vars.size());
+            vars.push_back(Operand::make(o.kind, o.id));
+            varTypes.push_back(type);
+        }
+        else if (varTypes[it->second] == TokenType::UNKNOWN)
+            varTypes[it->second] = type;
+    };
+    for (const Param& p : func.params)
+        addVar(Operand::var(p.name), p.type);
+
+    for (uint32_t b : layout) {
+        for (IRInstruction& instr : blocks[b].code) {
+            auto mark = [&](const Operand& o) {
+                if (o.kind == OperandKind::ELEM)
+                    excluded.insert(operandKey(Operand::var(o.id)));
+                if (isRefArg(o) && o.isLocation())
+                    excluded.insert(operandKey(o));
+            };
+            mark(instr.result);
+            mark(instr.op1);
+            mark(instr.op2);
+            if (instr.type == IRType::CALL) {
+                const Operand* a = prog.args(instr);
+                for (uint32_t i = 0; i < instr.argCount; i++)
+                    mark(a[i]);
+            }
+            if (Operand* d = defOf(instr))
+                addVar(*d, d->isTemp() ? prog.tempType(d->id) : instr.resType);
+            forEachUse(prog, instr, [&](Operand& o) {
+                addVar(o, o.isTemp() ? prog.tempType(o.id) : TokenType::UNKNOWN);
+            });
+        }
+    }
+    auto promoted = [&](const Operand& o) -> int64_t {
+        if (!o.isLocation()) return -1;
+        uint64_t key = operandKey(o);
+        if (excluded.count(key)) return -1;
+        auto it = varIndex.find(key);
+        return it == varIndex.end() ? -1 : (int64_t)it->second;
+    };
+
+    // 2. ֻ֦ΪԾıĳú壩 phi
+    size_t n = vars.size();
+    std::vector<std::vector<uint32_t>> defBlocks(n);
+    std::vector<char> global(n, 0);
+    for (uint32_t b : layout) {
+        std::vector<char> killed(n, 0);
+        for (IRInstruction& instr : blocks[b].code) {
+            forEachUse(prog, instr, [&](Operand& o) {
+                int64_t v = promoted(o);
+                if (v >= 0 && !killed[v]) global[v] = 1;
+            });
+            if (Operand* d = defOf(instr)) {
+                int64_t v = promoted(*d);
+                if (v >= 0) {
+                    killed[v] = 1;
+                    if (defBlocks[v].empty() || defBlocks[v].back() != b)
+                        defBlocks[v].push_back(b);
+                }
+            }
+        }
+    }
+    for (const Param& p : func.params) {
+        int64_t v = promoted(Operand::var(p.name));
+        if (v >= 0)
+            defBlocks[v].push_back(entry);
+    }
+
+    for (size_t v = 0; v < n; v++) {
+        if (!global[v] || excluded.count(operandKey(vars[v])))
+            continue;
+        std::vector<char> hasPhi(blocks.size(), 0), queued(blocks.size(), 0);
+        std::vector<uint32_t> work = defBlocks[v];
+        for (uint32_t b : work) queued[b] = 1;
+        while (!work.empty()) {
+            uint32_t b = work.back();
+            work.pop_back();
+            for (uint32_t d : blocks[b].frontier) {
+                if (hasPhi[d]) continue;
+                hasPhi[d] = 1;
+                Phi phi;
+                phi.var = vars[v];
+                phi.type = varTypes[v];
+                phi.args.assign(blocks[d].preds.size(), Operand());
+                blocks[d].phis.push_back(phi);
+                if (!queued[d]) {
+                    queued[d] = 1;
+                    work.push_back(d);
+                }
+            }
+        }
+    }
+
+    // 3. ֧ÿõһµʱ
+    std::vector<std::vector<Operand>> stacks(n);
+    for (const Param& p : func.params) {
+        int64_t v = promoted(Operand::var(p.name));
+        if (v >= 0)
+            stacks[v].push_back(Operand::var(p.name));
+    }
+    auto top = [&](size_t v) {
+        return stacks[v].empty() ? Operand() : stacks[v].back();
+    };
+
+    std::function<void(uint32_t)> rename = [&](uint32_t b) {
+        std::vector<size_t> pushed;
+        for (Phi& phi : blocks[b].phis) {
+            size_t v = varIndex[operandKey(phi.var)];
+            phi.dst = prog.newTemp(phi.type);
+            stacks[v].push_back(phi.dst);
+            pushed.push_back(v);
+        }
+        for (IRInstruction& instr : blocks[b].code) {
+            forEachUse(prog, instr, [&](Operand& o) {
+                int64_t v = promoted(o);
+                // δֵԭ
+                if (v >= 0 && !stacks[v].empty()) {
+                    uint8_t flags = o.flags;
+                    o = stacks[v].back();
+                    o.flags = flags;
+                }
+            });
+            if (Operand* d = defOf(instr)) {
+                int64_t v = promoted(*d);
+                if (v >= 0) {
+                    *d = prog.newTemp(varTypes[v]);
+                    stacks[v].push_back(*d);
+                    pushed.push_back((size_t)v);
+                }
+            }
+        }
+        for (uint32_t s : blocks[b].succs) {
+            BasicBlock& succ = blocks[s];
+            for (size_t j = 0; j < succ.preds.size(); j++) {
+                if (succ.preds[j] != b) continue;
+                for (Phi& phi : succ.phis)
+                    phi.args[j] = top(varIndex[operandKey(phi.var)]);
+            }
+        }
+        for (uint32_t c : blocks[b].domChildren)
+            rename(c);
+        for (size_t v : pushed)
+            stacks[v].pop_back();
+    };
+    rename(entry);
+    ssa = true;
+}
+
+// һ鲢и dst_i <- src_i ų˳ ASSIGNҪʱʱƻ
+static void sequentializeCopies(IRProgram& prog, std::vector<std::pair<Operand, Operand>> copies,
+    const std::vector<TokenType>& types, std::vector<IRInstruction>& out) {
+    std::vector<TokenType> ty = types;
+    while (!copies.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < copies.size(); i++) {
+            const Operand& dst = copies[i].first;
+            bool blocked = false;
+            for (size_t j = 0; j < copies.size(); j++)
+                if (j != i && copies[j].second == dst) { blocked = true; break; }
+            if (blocked) continue;
+            out.emplace_back(IRType::ASSIGN, copies[i].first, copies[i].second, Operand(), ty[i]);
+            copies.erase(copies.begin() + i);
+            ty.erase(ty.begin() + i);
+            progress = true;
+            break;
+        }
+        if (!progress) {
+            // ֻʣȰһĿľֵ
+            Operand saved = prog.newTemp(ty[0]);
+            out.emplace_back(IRType::ASSIGN, saved, copies[0].first, Operand(), ty[0]);
+            for (auto& c : copies)
+                if (c.second == copies[0].first)
+                    c.second = saved;
+        }
+    }
+}
+
+void CFG::fromSSA() {
+    if (!ssa)
+        return;
+    // пָ phi תߣƲеط
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        if (blocks[b].dead || blocks[b].phis.empty())
+            continue;
+        std::vector<uint32_t> preds = blocks[b].preds;
+        std::sort(preds.begin(), preds.end());
+        preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+        for (uint32_t p : preds) {
+            const IRInstruction* term = blocks[p].terminator();
+            if (term && (term->type == IRType::IF_FALSE_GOTO || term->type == IRType::IF_TRUE_GOTO))
+                splitEdge(p, b);
+        }
+    }
+
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        BasicBlock& blk = blocks[b];
+        if (blk.dead || blk.phis.empty())
+            continue;
+        std::vector<uint32_t> done;
+        for (size_t j = 0; j < blk.preds.size(); j++) {
+            uint32_t p = blk.preds[j];
+            if (std::find(done.begin(), done.end(), p) != done.end())
+                continue;
+            done.push_back(p);
+
+            std::vector<std::pair<Operand, Operand>> copies;
+            std::vector<TokenType> types;
+            for (const Phi& phi : blk.phis) {
+                const Operand& src = phi.args[j];
+                if (src.isNone() || src == phi.dst)
+                    continue;
+                copies.push_back({ phi.dst, src });
+                types.push_back(phi.type);
+            }
+            if (copies.empty())
+                continue;
+
+            std::vector<IRInstruction> seq;
+            sequentializeCopies(prog, copies, types, seq);
+            auto& code = blocks[p].code;
+            auto at = code.end();
+            if (blocks[p].terminator())
+                at = code.end() - 1;
+            code.insert(at, seq.begin(), seq.end());
+        }
+    }
+    for (auto& blk : blocks)
+        blk.phis.clear();
+    ssa = false;
+}
+
+size_t CFG::instructionCount() const {
+    size_t n = 0;
+    for (uint32_t b : layout)
+        n += blocks[b].code.size() + blocks[b].phis.size() + (blocks[b].label ? 1 : 0);
+    return n;
+}
+
+void CFG::emit(std::vector<IRInstruction>& out) {
+    out.emplace_back(IRType::FUNC_BEGIN, Operand::func(func.name), Operand(), Operand(), func.retType);
+    uint32_t firstOut = (uint32_t)out.size() - 1;
+
+    uint32_t exitLabel = 0;
+    for (size_t k = 0; k < layout.size(); k++) {
+        BasicBlock& b = blocks[layout[k]];
+        if (b.label)
+            out.emplace_back(IRType::LABEL, Operand::label(b.label));
+        out.insert(out.end(), b.code.begin(), b.code.end());
+
+        // ˳̲һĿʱһ GOTO
+        const IRInstruction* term = b.terminator();
+        bool fallsThrough = !term || term->type == IRType::IF_FALSE_GOTO || term->type == IRType::IF_TRUE_GOTO;
+        if (!fallsThrough)
+            continue;
+        uint32_t next = k + 1 < layout.size() ? layout[k + 1] : NONE;
+        if (b.fallthrough == next)
+            continue;
+        if (b.fallthrough == NONE) {
+            if (!exitLabel)
+                exitLabel = prog.newLabel("exit").id;
+            out.emplace_back(IRType::GOTO, Operand::label(exitLabel));
+        }
+        else
+            out.emplace_back(IRType::GOTO, Operand::label(ensureLabel(b.fallthrough)));
+    }
+    if (exitLabel)
+        out.emplace_back(IRType::LABEL, Operand::label(exitLabel));
+    out.emplace_back(IRType::FUNC_END, Operand::func(func.name));
+
+    func.begin = firstOut;
+    func.end = (uint32_t)out.size() - 1;
+}
+
+void transformFunctions(IRProgram& prog, const std::function<void(CFG&)>& f) {
+    // CFG ʱ prog ȡԭָȫ滻
+    const std::vector<IRInstruction>& old = prog.getInstructions();
+    std::vector<IRFunction>& funcs = prog.getFunctions();
+    std::vector<IRInstruction> out;
+    out.reserve(old.size());
+
+    size_t next = 0;
+    for (uint32_t i = 0; i < old.size(); i++) {
+        if (next < funcs.size() && i == funcs[next].begin) {
+            CFG cfg(prog, funcs[next]);
+            f(cfg);
+            cfg.fromSSA();
+            cfg.emit(out);
+            i = funcs[next].end;
+            funcs[next] = cfg.func;
+            next++;
+            continue;
+        }
+        out.push_back(old[i]);
+    }
+    prog.getInstructions() = std::move(out);
+}
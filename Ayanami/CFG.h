@@ -0,0 +1,192 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "IR.h"
+
+/*
+* SSA  phi ڵ
+* 壺ڴǰѡֵargs[i] Ӧ BasicBlock::preds[i]
+* ֵδǰӦĲΪ NONE 
+*/
+struct Phi {
+    Operand dst;
+    Operand var;        // ԭʼ
+    TokenType type;
+    std::vector<Operand> args;
+};
+
+/*
+* 
+* 壺ֻڿͷ롢ֻĩβ뿪һָ
+* ãŻ pass ڿϹֱɨƽָ
+* ˵
+*	鿪ͷ LABEL Ž codeǼ label 
+*	code һ GOTO / IF_xxx_GOTO / RETURNսָ
+*	fallthrough Ϊ˳ִеĿ飬NONE ʾ䵽ĩβ
+*/
+struct BasicBlock {
+    uint32_t label = 0;                 // ڱǩţ0 ʾû
+    std::vector<IRInstruction> code;
+    std::vector<Phi> phis;
+    uint32_t fallthrough = UINT32_MAX;
+
+    std::vector<uint32_t> preds;
+    std::vector<uint32_t> succs;
+    uint32_t idom = UINT32_MAX;         // ֱ֧ߣΪɴΪ NONE
+    std::vector<uint32_t> domChildren;
+    std::vector<uint32_t> frontier;     // ֧߽
+    bool dead = false;                  // ѱɾ
+
+    const IRInstruction* terminator() const;
+    IRInstruction* terminator();
+};
+
+/*
+* Ȼѭ
+* 壺ر latch -> headerheader ֧ latchΧɵĿ鼯ϣѭͷĻرߺϲΪһѭ
+* ˵preheader ΪѭΨһ header Ŀ飬 CFG::ensurePreheader 
+*/
+struct Loop {
+    uint32_t header = 0;
+    uint32_t preheader = UINT32_MAX;
+    std::vector<uint32_t> blocks;       //  header
+    std::vector<uint32_t> latches;
+    std::vector<char> inLoop;           // ±Ϊ
+
+    bool contains(uint32_t b) const { return b < inLoop.size() && inLoop[b]; }
+};
+
+/*
+* Ŀͼ
+* 壺 IRProgram  [FUNC_BEGIN, FUNC_END] ָ֮гɻ
+* ã
+*	ṩǰ̡֧֧߽
+*	toSSA  phi  SSA ʽfromSSA ȥ phi صͨ IR
+*	emit ѿ鰴 layout ˳ԻΪ LABEL/GOTO ʽ
+*/
+class CFG {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    IRProgram& prog;
+    IRFunction func;
+    std::vector<BasicBlock> blocks;     // ż±꣬ɾĿֻ
+    std::vector<uint32_t> layout;       // ˳
+    uint32_t entry = 0;
+
+    CFG(IRProgram& prog, const IRFunction& func);
+
+    // սָ fallthrough ¼ǰ̣phi ǰһ
+    void recomputeEdges();
+
+    // ڿɴ
+    std::vector<uint32_t> reversePostorder() const;
+
+    // Cooper-Harvey-Kennedy 㷨ͬʱд domChildren
+    void computeDominators();
+    bool dominates(uint32_t a, uint32_t b) const;
+    void computeFrontiers();
+
+    // ɾڲɴĿ飬ɾĿ
+    size_t removeUnreachable();
+
+    // ȥûתָĿǩȥĸ
+    size_t removeUnusedLabels();
+
+    //  from -> to бϲһ¿飬¿
+    uint32_t splitEdge(uint32_t from, uint32_t to);
+
+    //  froms  to ı߸ĵһ¿飬¿˳ִе to¿
+    // SSA ʽ to  phi ¿кϲǰֵͬʱ¿ phi
+    uint32_t splitPreds(uint32_t to, const std::vector<uint32_t>& froms);
+
+    // ҳȻѭڲǰ¼֧
+    std::vector<Loop> findLoops();
+
+    // ֤ѭ preheaderΨһѭǰֻ header һ
+    uint32_t ensurePreheader(Loop& loop);
+
+    // ǩ -> 
+    uint32_t blockOfLabel(uint32_t label) const;
+    uint32_t ensureLabel(uint32_t block);
+
+    //  / ȥ SSA
+    void toSSA();
+    void fromSSA();
+    bool inSSA() const { return ssa; }
+
+    size_t instructionCount() const;
+
+    // Իд out FUNC_BEGIN / FUNC_END
+    void emit(std::vector<IRInstruction>& out);
+
+private:
+    std::vector<uint32_t> labelToBlock;   // ±Ϊǩ
+    std::vector<uint32_t> rpoIndex;
+    bool ssa = false;
+
+    uint32_t newBlock();
+    uint32_t intersect(uint32_t a, uint32_t b) const;
+    void retarget(IRInstruction& term, uint32_t fromBlock, uint32_t toBlock);
+};
+
+// ---------- ָĶдλ ----------
+
+// ܸдʵΣref ʵΣ
+inline bool isRefArg(const Operand& o) {
+    return (o.flags & Operand::REF) != 0;
+}
+
+/*
+* ָȡÿ TEMP / VAR  f(Operand&)Ծ͵ظд
+* ELEM ֻ±굱ȡ鱾㣨
+*/
+template<typename F>
+void forEachUse(IRProgram& prog, IRInstruction& instr, F&& f) {
+    auto visit = [&](Operand& o) {
+        if (o.kind == OperandKind::TEMP || o.kind == OperandKind::VAR) {
+            f(o);
+        }
+        else if (o.kind == OperandKind::ELEM &&
+            (o.indexKind == OperandKind::TEMP || o.indexKind == OperandKind::VAR)) {
+            Operand idx = o.elemIndex();
+            f(idx);
+            uint8_t flags = o.flags;
+            o = Operand::elem(o.id, idx);
+            o.flags = flags;
+        }
+    };
+    if (!instr.definesResult() || instr.result.kind == OperandKind::ELEM)
+        visit(instr.result);
+    visit(instr.op1);
+    visit(instr.op2);
+    if (instr.type == IRType::CALL) {
+        Operand* a = prog.args(instr);
+        for (uint32_t i = 0; i < instr.argCount; i++)
+            visit(a[i]);
+    }
+}
+
+// ָд TEMP / VARû򷵻 nullptrref ʵ isRefArg
+inline Operand* defOf(IRInstruction& instr) {
+    if (instr.definesResult() && instr.result.isLocation())
+        return &instr.result;
+    return nullptr;
+}
+
+inline bool isTerminator(IRType t) {
+    return t == IRType::GOTO || t == IRType::IF_TRUE_GOTO ||
+        t == IRType::IF_FALSE_GOTO || t == IRType::RETURN;
+}
+
+// ڱеļ
+inline uint64_t operandKey(const Operand& o) {
+    return ((uint64_t)o.kind << 32) | o.id;
+}
+
+/*
+* Գеÿ CFG f 任ٰкԻд prog
+* ָԭ
+*/
+void transformFunctions(IRProgram& prog, const std::function<void(CFG&)>& f);
@@ -1,35 +1,115 @@
 #pragma once
 #pragma once
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <unordered_set>
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
 #include "IR.h" // ֮ǰ IRProgram  IRInstruction
 
+/*
+* C++ 
+* 壺 IRProgram  C++ɿִļ
+* Լ
+*	Ĭ g++Ż profile CXX / CXXFLAGS ԸǱ׷Ӳ
+*	ɵĴ뾭 -pipe ӱ׼뽻-x c++ -дʱļkeepSource ʱдһݵ filename
+*	 GCC Уg++ / clang++
+*/
 class CodeGen {
 public:
-    void generateAndCompile(IRProgram& ir, const std::string& filename, const std::string& outputExe) {
-        out.open(filename);
-        if (!out.is_open()) {
-            throw std::runtime_error("Cannot open output file");
+    // Żλdebug Ϊ -O0 -grelease Ϊ -O2native  -O3 -march=native
+    std::string profile = "release";
+    bool keepSource = false;
+
+    static const char* profileFlags(const std::string& name) {
+        if (name == "debug")   return "-O0 -g";
+        if (name == "release") return "-O2";
+        if (name == "native")  return "-O3 -march=native";
+        throw std::runtime_error("Unknown host compiler profile '" + name + "' (expected debug, release or native)");
+    }
+
+    static std::string compilerName() {
+        const char* cxx = std::getenv("CXX");
+        return cxx && *cxx ? cxx : "g++";
+    }
+
+    // ļͬʱ뻺ѡ
+    std::string compileCommand() const {
+        const char* extra = std::getenv("CXXFLAGS");
+        std::string cmd = compilerName();
+        cmd += " ";
+        cmd += profileFlags(profile);
+        if (extra && *extra) {
+            cmd += " ";
+            cmd += extra;
         }
+        return cmd + " -pipe -x c++ -";
+    }
+
+    //  --version Ž뻺ļ g++ / clang ɵĲ֮ʧЧ
+    static std::string compilerVersion() {
+        std::string cmd = compilerName() + " --version 2>&1";
+#ifdef _WIN32
+        FILE* pipe = _popen(cmd.c_str(), "rb");
+#else
+        FILE* pipe = popen(cmd.c_str(), "r");
+#endif
+        if (!pipe)
+            return "";
+        std::string version;
+        char buf[256];
+        size_t n;
+        while ((n = std::fread(buf, 1, sizeof buf, pipe)) > 0)
+            version.append(buf, n);
+#ifdef _WIN32
+        _pclose(pipe);
+#else
+        pclose(pipe);
+#endif
+        return version;
+    }
 
+    void generateAndCompile(IRProgram& ir, const std::string& filename, const std::string& outputExe) {
+        out.str("");
         out << "#include <iostream>\n";
         out << "using namespace std;\n\n";
 
-        // ¼ͣĬ double
-        currentFunc = "";
-        tempVars.clear();
-
-        for (const auto& instr : ir.getInstructions()) {
-            genInstruction(instr);
+        prog = &ir;
+        const auto& code = ir.getInstructions();
+        size_t nextFunc = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (code[i].type == IRType::FUNC_BEGIN)
+                genFunctionHeader(ir.getFunctions()[nextFunc++]);
+            else
+                genInstruction(code[i]);
         }
 
-        out.close();
+        std::string source = out.str();
+        if (keepSource) {
+            std::ofstream file(filename);
+            if (!file.is_open())
+                throw std::runtime_error("Cannot open output file");
+            file << source;
+        }
 
-        std::string cmd = "g++ " + filename + " -o " + outputExe;
-        int ret = system(cmd.c_str());
+        std::string cmd = compileCommand() + " -o \"" + outputExe + "\"";
+#ifdef _WIN32
+        FILE* pipe = _popen(cmd.c_str(), "wb");
+#else
+        FILE* pipe = popen(cmd.c_str(), "w");
+#endif
+        if (!pipe)
+            throw std::runtime_error("Cannot start host compiler: " + cmd);
+        std::fwrite(source.data(), 1, source.size(), pipe);
+#ifdef _WIN32
+        int ret = _pclose(pipe);
+#else
+        int ret = pclose(pipe);
+#endif
         if (ret != 0) {
             throw std::runtime_error("Compilation failed");
         }
@@ -38,96 +118,77 @@ public:
     }
 
 private:
-    std::ofstream out;
-    std::string currentFunc;
-    std::unordered_map<std::string, bool> tempVars; // ʱ
-
-    void declareVar(const std::string& name,const TokenType type) {
-        if (tempVars.find(name) == tempVars.end()) {
-            if (type == TokenType::FLOAT)
-                out << "double ";
-            else if (type == TokenType::INT)
-                out << "int ";
-            else if (type == TokenType::BOOL)
-                out << "bool ";
-            else if (type == TokenType::CHAR)
-                out << "char ";
-            else if (type == TokenType::ARR_INT)
-                out << "int* ";
-            else if (type == TokenType::ARR_FLOAT)
-                out << "float* ";
-            else if (type == TokenType::ARR_BOOL)
-                out << "bool* ";
-            else if (type == TokenType::ARR_CHAR)
-                out << "char* ";
-            out << name << ";\n";
-            tempVars[name] = true;
+    std::ostringstream out;
+    const IRProgram* prog = nullptr;
+
+    static const char* cType(TokenType type) {
+        switch (type) {
+        case TokenType::FLOAT:     return "double";
+        case TokenType::INT:       return "int";
+        case TokenType::BOOL:      return "bool";
+        case TokenType::CHAR:      return "char";
+        case TokenType::ARR_INT:   return "int*";
+        case TokenType::ARR_FLOAT: return "double*";
+        case TokenType::ARR_BOOL:  return "bool*";
+        case TokenType::ARR_CHAR:  return "char*";
+        default:                   return "void";
         }
     }
 
-    void genInstruction(const IRInstruction& instr) {
-        switch (instr.type) {
-        case IRType::FUNC_BEGIN:
-            currentFunc = instr.result;
-            tempVars.clear();
-            if (instr.result == "main")
-                out << "int ";
-            else if (instr.resType == TokenType::FLOAT)
-                out << "double ";
-            else if (instr.resType == TokenType::INT)
-                out << "int ";
-            else if (instr.resType == TokenType::BOOL)
-                out << "bool ";
-            else if (instr.resType == TokenType::CHAR)
-                out << "char ";
-            else if (instr.resType == TokenType::ARR_INT)
-                out << "int* ";
-            else if (instr.resType == TokenType::ARR_FLOAT)
-                out << "float* ";
-            else if (instr.resType == TokenType::ARR_BOOL)
-                out << "bool* ";
-            else if (instr.resType == TokenType::ARR_CHAR)
-                out << "char* ";
-            else
-                out << "void ";
-            out << currentFunc << "(";
-
-            for (int i = 0; i < instr.params.size(); i++) {
-                std::string s = instr.params[i];
-                std::string from = " Ref";
-                std::string to = "&";
-
-                size_t pos = 0;
-                while ((pos = s.find(from, pos)) != std::string::npos) {
-                    s.replace(pos, from.length(), to);
-                    pos += to.length(); // ƶ滻ַĩβѭ
-                }
-
-                if (s.substr(0,3)=="ARR") {
-                    s = s.substr(4, s.size());
-                    for (int k = 0; k < s.size(); k++) {
-                        if (s[k] == ' ') {
-                            //i--;
-                            s.insert(k, "*");
-                            break;
-                        }
-                    }
-                }
-
-                out << s;
-                if (i != instr.params.size() - 1)
-                    out << ",";
+    std::string str(const Operand& o) const {
+        return prog->str(o);
+    }
 
-                pos = s.rfind(' ', pos);
-                s = s.substr(pos + 1, 10000);
-                tempVars[s] = true;
-            }
-            out << ") {\n";
-            break;
+    // ͷѺдıʱͳһڿͷ
+    //  goto ǩҲԳκλ
+    void genFunctionHeader(const IRFunction& fn) {
+        const std::string& name = symName(fn.name);
+        out << (name == "main" ? "int" : cType(fn.retType)) << " " << name << "(";
+
+        std::unordered_set<SymId> declared;
+        for (size_t i = 0; i < fn.params.size(); i++) {
+            const Param& p = fn.params[i];
+            out << cType(p.type) << (p.isRef ? "& " : " ") << symName(p.name);
+            if (i + 1 != fn.params.size())
+                out << ",";
+            declared.insert(p.name);
+        }
+        out << ") {\n";
+
+        const auto& code = prog->getInstructions();
+        std::unordered_set<uint32_t> temps;
+        for (uint32_t i = fn.begin + 1; i < fn.end; i++) {
+            const IRInstruction& instr = code[i];
+            if (!instr.definesResult())
+                continue;
+            const Operand& r = instr.result;
+            if (r.isTemp() && temps.insert(r.id).second)
+                out << cType(prog->tempType(r.id)) << " " << str(r) << ";\n";
+            else if (r.isVar() && declared.insert(r.id).second)
+                out << cType(instr.resType) << " " << str(r) << ";\n";
+        }
+    }
 
+    static const char* binaryOp(IRType type) {
+        switch (type) {
+        case IRType::ADD:         return " + ";
+        case IRType::SUB:         return " - ";
+        case IRType::MUL:         return " * ";
+        case IRType::DIV:         return " / ";
+        case IRType::LESS:        return " < ";
+        case IRType::GREATER:     return " > ";
+        case IRType::EQUAL_EQUAL: return " == ";
+        case IRType::NOT_EQUAL:   return " != ";
+        case IRType::AND:         return " && ";
+        case IRType::OR:          return " || ";
+        default:                  return nullptr;
+        }
+    }
+
+    void genInstruction(const IRInstruction& instr) {
+        switch (instr.type) {
         case IRType::FUNC_END:
             out << "}\n\n";
-            currentFunc = "";
             break;
 
         case IRType::ADD:
@@ -137,83 +198,70 @@ private:
         case IRType::LESS:
         case IRType::GREATER:
         case IRType::EQUAL_EQUAL:
+        case IRType::NOT_EQUAL:
         case IRType::AND:
         case IRType::OR:
-            declareVar(instr.result,instr.resType);
-            out << instr.result << " = " << instr.op1;
-            if (instr.type == IRType::ADD) out << " + ";
-            if (instr.type == IRType::SUB) out << " - ";
-            if (instr.type == IRType::MUL) out << " * ";
-            if (instr.type == IRType::DIV) out << " / ";
-            if (instr.type == IRType::LESS) out << " < ";
-            if (instr.type == IRType::GREATER) out << " > ";
-            if (instr.type == IRType::EQUAL_EQUAL) out << " == ";
-            if (instr.type == IRType::AND) out << " && ";
-            if (instr.type == IRType::OR) out << " || ";
-            out << instr.op2 << ";\n";
+            out << str(instr.result) << " = " << str(instr.op1) << binaryOp(instr.type) << str(instr.op2) << ";\n";
             break;
 
         case IRType::ASSIGN:
-            declareVar(instr.result,instr.resType);
-            out << instr.result << " = " << instr.op1 << ";\n";
+            out << str(instr.result) << " = " << str(instr.op1) << ";\n";
             break;
 
         case IRType::RETURN:
-            out << "return " << instr.op1 << ";\n";
+            out << "return " << str(instr.op1) << ";\n";
             break;
 
         case IRType::PARAM:
-            // ֻʱռ
-            //  call ʱ
+            // ʵ CALL һ
             break;
 
-        case IRType::CALL:
-            if (instr.resType==TokenType::VOID)
-                out << instr.op1 << "(";
-            else {
-                declareVar(instr.result, instr.resType);
-                out << instr.result << " = " << instr.op1 << "(";
-            }
-            for (int i = 0; i < instr.params.size(); i++) {
-                out << instr.params[i];
-                if (i != instr.params.size() - 1)
+        case IRType::CALL: {
+            if (!instr.result.isNone())
+                out << str(instr.result) << " = ";
+            out << str(instr.op1) << "(";
+            const Operand* args = prog->args(instr);
+            for (uint32_t i = 0; i < instr.argCount; i++) {
+                out << str(args[i]);
+                if (i + 1 != instr.argCount)
                     out << ",";
             }
             out << ");\n";
             break;
-        case IRType::ALLOC_ARR:
-            out << instr.op1.substr(4, 10) << "* " << instr.result << " = new "
-                << instr.op1.substr(4, 10) << "[" << instr.op2 << "];\n";
+        }
+        case IRType::ALLOC_ARR: {
+            std::string elemType = cType(instr.resType);
+            elemType.pop_back(); // ȥ '*'
+            out << str(instr.result) << " = new " << elemType << "[" << str(instr.op1) << "];\n";
             break;
+        }
         case IRType::STORE_ARR:
-            out << instr.op1 << "[" << instr.op2 << "] = " << instr.result << ";\n";
+            out << str(instr.result) << "[" << str(instr.op1) << "] = " << str(instr.op2) << ";\n";
             break;
-#if 0
         case IRType::LOAD_ARR:
-            declareVar(instr.result, instr.resType);
-            out << instr.result <<" = " << instr.op1 << "[" << instr.op2 << "]" << ";\n";
+            out << str(instr.result) << " = " << str(instr.op1) << "[" << str(instr.op2) << "];\n";
             break;
-#endif
         case IRType::LABEL:
-            out << instr.result << ":\n";
+            // ñǩԳڿβ
+            out << str(instr.result) << ": ;\n";
             break;
 
         case IRType::GOTO:
-            out << "goto " << instr.result << ";\n";
+            out << "goto " << str(instr.result) << ";\n";
             break;
 
         case IRType::IF_TRUE_GOTO:
-            out << "if(" << instr.op1 << ") goto " << instr.result << ";\n";
+            out << "if(" << str(instr.op1) << ") goto " << str(instr.result) << ";\n";
             break;
 
         case IRType::IF_FALSE_GOTO:
-            out << "if(!(" << instr.op1 << ")) goto " << instr.result << ";\n";
+            out << "if(!(" << str(instr.op1) << ")) goto " << str(instr.result) << ";\n";
             break;
         case IRType::INPUT:
-            out << "std::cin>>" << instr.result << ";\n";
+            out << "std::cin>>" << str(instr.result) << ";\n";
             break;
         case IRType::OUTPUT:
-            out << "std::cout<<" << instr.result << ";\n";
+            out << "std::cout<<" << str(instr.op1) << ";\n";
             break;
         default:
             std::cerr << "Unsupported IRType\n";
@@ -0,0 +1,208 @@
+#include "CompileCache.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/*
+* · FNV-1aƫƻͬ 128 λ
+* ÿ֮ٻĳȣ("ab", "c")  ("a", "bc") õͬļ
+*/
+class Hasher {
+public:
+    void update(std::string_view s) {
+        for (unsigned char c : s)
+            mix(c);
+        uint64_t n = s.size();
+        for (int k = 0; k < 8; k++)
+            mix((unsigned char)(n >> (8 * k)));
+    }
+
+    std::string hex() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string s;
+        for (uint64_t v : { a, b })
+            for (int k = 15; k >= 0; k--)
+                s += digits[(v >> (4 * k)) & 15];
+        return s;
+    }
+
+private:
+    static constexpr uint64_t PRIME = 0x100000001b3ULL;
+    uint64_t a = 0xcbf29ce484222325ULL;
+    uint64_t b = 0x84222325cbf29ce4ULL;
+
+    void mix(unsigned char c) {
+        a = (a ^ c) * PRIME;
+        b = (b ^ (unsigned char)(c + 0x5b)) * PRIME;
+    }
+};
+
+std::string env(const char* name) {
+    const char* v = std::getenv(name);
+    return v ? v : "";
+}
+
+// еĿִļȡʱΪ
+std::string executablePath() {
+#ifdef _WIN32
+    char buf[MAX_PATH];
+    DWORD n = GetModuleFileNameA(nullptr, buf, MAX_PATH);
+    return n > 0 && n < MAX_PATH ? std::string(buf, n) : "";
+#elif defined(__APPLE__)
+    char buf[4096];
+    uint32_t size = sizeof buf;
+    return _NSGetExecutablePath(buf, &size) == 0 ? buf : "";
+#else
+    return "/proc/self/exe";     // ֱӴӱļ滻еһ
+#endif
+}
+
+/*
+* ĹʶִļݵĹϣ
+* κһ뵥ԪŻ passˡĶӣɵĻ涼ʧЧ
+* ʱ˻رļıʱ
+*/
+const std::string& buildId() {
+    static const std::string id = [] {
+        std::ifstream in(executablePath(), std::ios::binary);
+        if (!in)
+            return std::string(__DATE__ " " __TIME__);
+        Hasher h;
+        char buf[1 << 16];
+        while (in.read(buf, sizeof buf) || in.gcount() > 0)
+            h.update(std::string_view(buf, (size_t)in.gcount()));
+        return h.hex();
+    }();
+    return id;
+}
+
+// ʱļĺ׺ͬһĿ¼²д뻥
+std::string uniqueSuffix() {
+    static std::random_device rd;
+    return ".tmp" + std::to_string((unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count())
+        + "-" + std::to_string(rd());
+}
+
+// дʱļٸֻῴɵĻµ
+void replaceFile(const fs::path& target, const std::string& content) {
+    std::error_code ec;
+    fs::path temp = target;
+    temp += uniqueSuffix();
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!(out << content))
+            ec = std::make_error_code(std::errc::io_error);
+    }
+    if (!ec)
+        fs::rename(temp, target, ec);
+    if (ec)
+        fs::remove(temp, ec);
+}
+
+}
+
+CompileCache::CompileCache(std::string directory) :dir(std::move(directory)) {
+    loadStats();
+}
+
+std::string CompileCache::defaultDirectory() {
+    std::string d = env("AYANAMI_CACHE_DIR");
+    if (!d.empty())
+        return d;
+#ifdef _WIN32
+    d = env("LOCALAPPDATA");
+    if (!d.empty())
+        return (fs::path(d) / "ayanami").string();
+#else
+    d = env("XDG_CACHE_HOME");
+    if (!d.empty())
+        return (fs::path(d) / "ayanami").string();
+    d = env("HOME");
+    if (!d.empty())
+        return (fs::path(d) / ".cache" / "ayanami").string();
+#endif
+    return (fs::temp_directory_path() / "ayanami-cache").string();
+}
+
+std::string CompileCache::key(std::string_view source, std::string_view flags) {
+    Hasher h;
+    h.update(source);
+    h.update(flags);
+    h.update(buildId());
+    return h.hex();
+}
+
+// ǰλĿ¼ⵥĿ¼ļ
+std::string CompileCache::pathOf(const std::string& key) const {
+    return (fs::path(dir) / key.substr(0, 2) / key).string();
+}
+
+bool CompileCache::fetch(const std::string& key, const std::string& output) {
+    std::error_code ec;
+    fs::path cached = pathOf(key);
+    bool hit = fs::is_regular_file(cached, ec);
+    if (hit) {
+        fs::copy_file(cached, output, fs::copy_options::overwrite_existing, ec);
+        if (!ec)
+            fs::permissions(output, fs::status(cached, ec).permissions(), ec);
+        hit = !ec;
+    }
+    // ̿ڱ̹֮¹ͳƣȶµۼ
+    loadStats();
+    if (hit)
+        hits++;
+    else
+        misses++;
+    saveStats();
+    return hit;
+}
+
+void CompileCache::store(const std::string& key, const std::string& artifact) {
+    std::error_code ec;
+    fs::path target = pathOf(key);
+    fs::create_directories(target.parent_path(), ec);
+    if (ec)
+        return;
+    fs::path temp = target;
+    temp += uniqueSuffix();
+    fs::copy_file(artifact, temp, fs::copy_options::overwrite_existing, ec);
+    if (!ec)
+        fs::rename(temp, target, ec);
+    if (ec)
+        fs::remove(temp, ec);
+}
+
+void CompileCache::loadStats() {
+    std::ifstream in(fs::path(dir) / "stats");
+    if (!(in >> hits >> misses))
+        hits = misses = 0;
+}
+
+void CompileCache::saveStats() const {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    replaceFile(fs::path(dir) / "stats", std::to_string(hits) + ' ' + std::to_string(misses) + '\n');
+}
+
+void CompileCache::printStats(std::ostream& os) const {
+    uint64_t total = hits + misses;
+    os << "compile cache: " << hits << " hits, " << misses << " misses";
+    if (total)
+        os << " (" << (hits * 100 / total) << "% hit rate)";
+    os << ", " << dir << "\n";
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <cstdint>
+
+/*
+* 뻺
+* 壺ѰַķʽɵĿִļڴϣԴ롢ѡûʱֱȡ
+*	ʷ﷨Żⲿ g++ / as / ld
+* Լ
+*	Ϊ 128 λϣ· FNV-1aʮƴԴֽڡѡͱִļĹϣ
+*	Ŀ¼ȡ AYANAMI_CACHE_DIR XDG_CACHE_HOME/ayanami~/.cache/ayanamiWindows Ϊ %LOCALAPPDATA%\ayanami
+*	д䵽ʱļٸα벻дһļ
+*	Ŀ¼ʱֻǲУӰ뱾
+*	δеۼƴĿ¼µ stats ļУͬ滻ʱټһΣȱļ
+*/
+class CompileCache {
+public:
+    explicit CompileCache(std::string directory = defaultDirectory());
+
+    static std::string defaultDirectory();
+
+    // flags ӦӰѡˡŻⲿȣ
+    static std::string key(std::string_view source, std::string_view flags);
+
+    // ʱѻĲ︴Ƶ output  trueͬʱͳ
+    bool fetch(const std::string& key, const std::string& output);
+
+    // ɹ뻺
+    void store(const std::string& key, const std::string& artifact);
+
+    // ۼƵ / δд뻺Ŀ¼
+    void printStats(std::ostream& os) const;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+private:
+    std::string dir;
+
+    std::string pathOf(const std::string& key) const;
+    void loadStats();
+    void saveStats() const;
+};
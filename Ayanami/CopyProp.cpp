@@ -0,0 +1,245 @@
+#include "Optimizer.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+//  TEMP / VAR ĶʹôǷ ref 
+struct OperandCounts {
+    std::unordered_map<uint64_t, uint32_t> defs, uses;
+    std::unordered_set<uint64_t> refs;
+
+    explicit OperandCounts(CFG& cfg) {
+        for (uint32_t b : cfg.layout) {
+            BasicBlock& blk = cfg.blocks[b];
+            for (Phi& phi : blk.phis) {
+                defs[operandKey(phi.dst)]++;
+                for (const Operand& a : phi.args)
+                    if (a.isLocation())
+                        uses[operandKey(a)]++;
+            }
+            for (IRInstruction& instr : blk.code) {
+                if (Operand* d = defOf(instr))
+                    defs[operandKey(*d)]++;
+                forEachUse(cfg.prog, instr, [&](Operand& o) {
+                    uses[operandKey(o)]++;
+                    if (isRefArg(o))
+                        refs.insert(operandKey(o));
+                });
+            }
+        }
+    }
+
+    uint32_t defCount(const Operand& o) const {
+        auto it = defs.find(operandKey(o));
+        return it == defs.end() ? 0 : it->second;
+    }
+    uint32_t useCount(const Operand& o) const {
+        auto it = uses.find(operandKey(o));
+        return it == uses.end() ? 0 : it->second;
+    }
+};
+
+class CopyPropagation {
+public:
+    CopyPropagation(CFG& cfg) :cfg(cfg), prog(cfg.prog), counts(cfg) {
+        for (const Param& p : cfg.func.params)
+            paramTypes[operandKey(Operand::var(p.name))] = p.isRef ? TokenType::UNKNOWN : p.type;
+    }
+
+    size_t run() {
+        size_t propagated = 0;
+        // ƽ phi ܲµƽ phi
+        while (true) {
+            findCopies();
+            if (replace.empty())
+                return propagated;
+            propagated += replace.size();
+            rewrite();
+            counts = OperandCounts(cfg);
+        }
+    }
+
+private:
+    CFG& cfg;
+    IRProgram& prog;
+    OperandCounts counts;
+    std::unordered_map<uint64_t, TokenType> paramTypes;
+    std::unordered_map<uint64_t, Operand> replace;      // 滻ʱ -> Դ
+
+    // ֵв䣺ֻһεʱӲдֵ
+    bool isStable(const Operand& o, TokenType& type) const {
+        if (counts.refs.count(operandKey(o)))
+            return false;
+        if (o.isTemp()) {
+            type = prog.tempType(o.id);
+            return counts.defCount(o) == 1;
+        }
+        if (o.isVar()) {
+            auto it = paramTypes.find(operandKey(o));
+            if (it == paramTypes.end() || it->second == TokenType::UNKNOWN)
+                return false;
+            type = it->second;
+            return counts.defCount(o) == 0;
+        }
+        return false;
+    }
+
+    void addCopy(const Operand& dst, const Operand& src) {
+        TokenType dt, st;
+        if (!dst.isTemp() || !isStable(dst, dt) || !isStable(src, st) || dt != st)
+            return;
+        replace[operandKey(dst)] = src;
+    }
+
+    void findCopies() {
+        replace.clear();
+        for (uint32_t b : cfg.layout) {
+            BasicBlock& blk = cfg.blocks[b];
+            for (Phi& phi : blk.phis) {
+                // жĲͬ
+                Operand same;
+                bool trivial = true;
+                for (const Operand& a : phi.args) {
+                    if (a.isNone() || a == phi.dst)
+                        continue;
+                    if (!same.isNone() && !(a == same)) {
+                        trivial = false;
+                        break;
+                    }
+                    same = a;
+                }
+                if (trivial && same.isLocation())
+                    addCopy(phi.dst, same);
+            }
+            for (IRInstruction& instr : blk.code)
+                if (instr.type == IRType::ASSIGN && instr.op1.isLocation())
+                    addCopy(instr.result, instr.op1);
+        }
+    }
+
+    Operand resolve(Operand o) const {
+        // ظҵԴϲɻΪÿԴΨһ
+        for (size_t steps = 0; steps <= replace.size(); steps++) {
+            auto it = replace.find(operandKey(o));
+            if (it == replace.end())
+                break;
+            o = it->second;
+        }
+        return o;
+    }
+
+    void rewrite() {
+        for (uint32_t b : cfg.layout) {
+            BasicBlock& blk = cfg.blocks[b];
+            std::vector<Phi> phis;
+            for (Phi& phi : blk.phis) {
+                if (replace.count(operandKey(phi.dst)))
+                    continue;
+                for (Operand& a : phi.args)
+                    if (a.isLocation())
+                        a = resolve(a);
+                phis.push_back(phi);
+            }
+            blk.phis = phis;
+
+            std::vector<IRInstruction> code;
+            for (IRInstruction& instr : blk.code) {
+                Operand* d = defOf(instr);
+                if (d && instr.type == IRType::ASSIGN && replace.count(operandKey(*d)))
+                    continue;
+                forEachUse(prog, instr, [&](Operand& o) {
+                    uint8_t flags = o.flags;
+                    o = resolve(o);
+                    o.flags = flags;
+                });
+                code.push_back(instr);
+            }
+            blk.code = code;
+        }
+    }
+};
+
+bool isRefParam(const CFG& cfg, const Operand& o) {
+    if (!o.isVar())
+        return false;
+    for (const Param& p : cfg.func.params)
+        if (p.isRef && p.name == o.id)
+            return true;
+    return false;
+}
+
+// instr Ƿд x x ΪԪز
+bool touches(IRProgram& prog, IRInstruction& instr, const Operand& x) {
+    bool hit = false;
+    if (Operand* d = defOf(instr))
+        hit = *d == x;
+    forEachUse(prog, instr, [&](Operand& o) { hit |= o.kind == x.kind && o.id == x.id; });
+    auto isElemOf = [&](const Operand& o) {
+        return x.isVar() && o.kind == OperandKind::ELEM && o.id == x.id;
+    };
+    hit |= isElemOf(instr.result) || isElemOf(instr.op1) || isElemOf(instr.op2);
+    return hit;
+}
+
+// һһԺϲ tɹ true
+bool coalesceOnce(CFG& cfg, BasicBlock& blk, const OperandCounts& counts) {
+    IRProgram& prog = cfg.prog;
+    for (size_t i = 0; i < blk.code.size(); i++) {
+        Operand* d = defOf(blk.code[i]);
+        if (!d || !d->isTemp() || counts.defCount(*d) != 1 || counts.useCount(*d) != 1 ||
+            counts.refs.count(operandKey(*d)))
+            continue;
+        Operand t = *d;
+        for (size_t j = i + 1; j < blk.code.size(); j++) {
+            IRInstruction& use = blk.code[j];
+            if (!(use.type == IRType::ASSIGN && use.op1 == t)) {
+                if (touches(prog, use, t))
+                    break;      // ΨһʹòǸ
+                continue;
+            }
+            const Operand& x = use.result;
+            TokenType xType = x.isTemp() ? prog.tempType(x.id) : use.resType;
+            if (xType != prog.tempType(t.id) || isRefParam(cfg, x))
+                break;
+            bool clobbered = false;
+            for (size_t k = i + 1; k < j && !clobbered; k++)
+                clobbered = touches(prog, blk.code[k], x);
+            if (clobbered)
+                break;
+            blk.code[i].result = x;
+            blk.code[i].resType = use.resType;
+            blk.code.erase(blk.code.begin() + j);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+CopyStats propagateCopies(CFG& cfg) {
+    if (!cfg.inSSA())
+        cfg.toSSA();
+    CopyStats stats;
+    stats.propagated = CopyPropagation(cfg).run();
+    return stats;
+}
+
+CopyStats coalesceTemps(CFG& cfg) {
+    cfg.fromSSA();
+    CopyStats stats;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        OperandCounts counts(cfg);
+        for (uint32_t b : cfg.layout) {
+            // ϲ t ٳ֣ʱļӰ
+            while (coalesceOnce(cfg, cfg.blocks[b], counts)) {
+                stats.coalesced++;
+                changed = true;
+            }
+        }
+    }
+    return stats;
+}
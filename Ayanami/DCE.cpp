@@ -0,0 +1,202 @@
+#include "Optimizer.h"
+#include "BitSet.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+/*
+* 鼶Ծ
+* ڴֻ ref ǻԾģֲں
+*/
+class Liveness {
+public:
+    std::unordered_map<uint64_t, uint32_t> index;   // operandKey -> λ±
+    std::vector<BitSet> liveOut;
+
+    explicit Liveness(CFG& cfg) :cfg(cfg) {
+        for (uint32_t b : cfg.layout)
+            for (IRInstruction& instr : cfg.blocks[b].code) {
+                forEachUse(cfg.prog, instr, [&](Operand& o) { indexOf(o); });
+                if (Operand* d = defOf(instr))
+                    indexOf(*d);
+            }
+        for (const Param& p : cfg.func.params)
+            if (p.isRef)
+                refParams.push_back(indexOf(Operand::var(p.name)));
+        solve();
+    }
+
+    uint32_t indexOf(const Operand& o) {
+        return index.emplace(operandKey(o), (uint32_t)index.size()).first->second;
+    }
+
+    BitSet exitSet() const {
+        BitSet s(index.size());
+        for (uint32_t v : refParams)
+            s.set(v);
+        return s;
+    }
+
+private:
+    CFG& cfg;
+    std::vector<uint32_t> refParams;
+
+    void solve() {
+        size_t n = cfg.blocks.size();
+        std::vector<BitSet> gen(n, BitSet(index.size())), kill(n, BitSet(index.size()));
+        for (uint32_t b : cfg.layout) {
+            for (IRInstruction& instr : cfg.blocks[b].code) {
+                forEachUse(cfg.prog, instr, [&](Operand& o) {
+                    uint32_t v = index[operandKey(o)];
+                    if (!kill[b].test(v))
+                        gen[b].set(v);
+                });
+                if (Operand* d = defOf(instr))
+                    kill[b].set(index[operandKey(*d)]);
+            }
+        }
+
+        liveOut.assign(n, BitSet(index.size()));
+        std::vector<BitSet> liveIn(n, BitSet(index.size()));
+        BitSet exit = exitSet();
+        std::vector<uint32_t> order = cfg.reversePostorder();
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            // 򵹹ߣ̴ǰ
+            for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                uint32_t b = *it;
+                BitSet out = cfg.blocks[b].succs.empty() ? exit : BitSet(index.size());
+                for (uint32_t s : cfg.blocks[b].succs)
+                    out.merge(liveIn[s]);
+                BitSet in = out;
+                in.transfer(gen[b], kill[b]);
+                if (!(in == liveIn[b]) || !(out == liveOut[b])) {
+                    liveIn[b] = in;
+                    liveOut[b] = out;
+                    changed = true;
+                }
+            }
+        }
+    }
+};
+
+// ʹʱɾָ
+bool isRemovable(IRType t) {
+    return t != IRType::CALL && t != IRType::INPUT;
+}
+
+// ɾָɾ
+size_t sweep(CFG& cfg) {
+    Liveness live(cfg);
+    size_t removed = 0;
+    for (uint32_t b : cfg.layout) {
+        BasicBlock& blk = cfg.blocks[b];
+        BitSet cur = live.liveOut[b];
+        std::vector<IRInstruction> kept;
+        kept.reserve(blk.code.size());
+        for (size_t i = blk.code.size(); i-- > 0;) {
+            IRInstruction& instr = blk.code[i];
+            if (Operand* d = defOf(instr)) {
+                uint32_t v = live.index[operandKey(*d)];
+                if (!cur.test(v)) {
+                    if (isRemovable(instr.type)) {
+                        removed++;
+                        continue;
+                    }
+                    if (instr.type == IRType::CALL)
+                        instr.result = Operand();   // ֻñ
+                }
+                if (!instr.result.isNone())
+                    cur.reset(v);
+            }
+            forEachUse(cfg.prog, instr, [&](Operand& o) {
+                cur.set(live.index[operandKey(o)]);
+            });
+            kept.push_back(instr);
+        }
+        blk.code.assign(kept.rbegin(), kept.rend());
+    }
+    return removed;
+}
+
+// ֻ GOTO յĿ飬ҵĿ
+uint32_t finalTarget(CFG& cfg, uint32_t t) {
+    for (size_t steps = 0; steps < cfg.blocks.size(); steps++) {
+        const BasicBlock& blk = cfg.blocks[t];
+        uint32_t next;
+        if (blk.code.empty())
+            next = blk.fallthrough;
+        else if (blk.code.size() == 1 && blk.code[0].type == IRType::GOTO)
+            next = cfg.blockOfLabel(blk.code[0].result.id);
+        else
+            break;
+        if (next == CFG::NONE)
+            break;
+        t = next;
+    }
+    return t;
+}
+
+// ת͸տ飬ɾһת
+void simplifyJumps(CFG& cfg) {
+    for (size_t k = 0; k < cfg.layout.size(); k++) {
+        uint32_t b = cfg.layout[k];
+        BasicBlock& blk = cfg.blocks[b];
+        IRInstruction* term = blk.terminator();
+        if (!term || term->type == IRType::RETURN)
+            continue;
+        uint32_t target = cfg.blockOfLabel(term->result.id);
+        uint32_t t = finalTarget(cfg, target);
+        if (t != target)
+            term->result = Operand::label(cfg.ensureLabel(t));
+
+        uint32_t next = k + 1 < cfg.layout.size() ? cfg.layout[k + 1] : CFG::NONE;
+        if (term->type == IRType::GOTO && t == next) {
+            blk.code.pop_back();
+            blk.fallthrough = next;
+        }
+        else if (term->type != IRType::GOTO && t == blk.fallthrough)
+            blk.code.pop_back();    // ͬҪ
+    }
+    cfg.recomputeEdges();
+}
+
+void collectTemps(CFG& cfg, std::unordered_set<uint32_t>& temps) {
+    for (uint32_t b : cfg.layout)
+        for (IRInstruction& instr : cfg.blocks[b].code) {
+            forEachUse(cfg.prog, instr, [&](Operand& o) {
+                if (o.isTemp()) temps.insert(o.id);
+            });
+            if (Operand* d = defOf(instr))
+                if (d->isTemp()) temps.insert(d->id);
+        }
+}
+
+}
+
+DCEStats eliminateDeadCode(CFG& cfg) {
+    DCEStats stats;
+    cfg.fromSSA();
+    stats.blocks = cfg.removeUnreachable();
+
+    std::unordered_set<uint32_t> before, after;
+    collectTemps(cfg, before);
+    size_t count = cfg.instructionCount();
+
+    // ɾתֵɾָֿÿգ
+    size_t last;
+    do {
+        last = cfg.instructionCount();
+        sweep(cfg);
+        simplifyJumps(cfg);
+        stats.blocks += cfg.removeUnreachable();
+    } while (cfg.instructionCount() != last);
+    cfg.removeUnusedLabels();
+
+    collectTemps(cfg, after);
+    stats.instructions = count - cfg.instructionCount();
+    stats.temps = before.size() - after.size();
+    return stats;
+}
@@ -2,6 +2,9 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #ifndef ASTNODE_H
 #include"ASTNode.h"
 #define ASTNODE_H
@@ -17,8 +20,8 @@
 #endif
 
 // 
-enum class IRType {
-    ADD, SUB, MUL, DIV, ASSIGN,LESS,GREATER,EQUAL_EQUAL,AND,OR,
+enum class IRType : uint8_t {
+    ADD, SUB, MUL, DIV, ASSIGN,LESS,GREATER,EQUAL_EQUAL,NOT_EQUAL,AND,OR,
     LABEL,      // ǩת
     GOTO,       // ת
     IF_TRUE_GOTO, // תΪ棩
@@ -37,383 +40,572 @@ enum class IRType {
     // չ
 };
 
-// мʾĻָ
+// 
+enum class OperandKind : uint8_t {
+    NONE,
+    TEMP,   // ʱĴid Ϊ
+    VAR,    // Դеľid Ϊ SymId
+    INT,    // ֵ i
+    FLOAT,  // ֵ f
+    CHAR,   // ַ i
+    LABEL,  // תǩid Ϊǩ
+    FUNC,   // id Ϊ͵ĺ SymId
+    ELEM,   // Ԫ arr[index]id Ϊ SymId± indexKindֵ index
+};
+
+/*
+* 
+* 壺ǩ̶ֵ 16 ֽڣֵ
+* ã pass ֱӱȽͱţƴӡַ
+*/
+struct Operand {
+    static constexpr uint8_t REF = 1;   //  ref βεʵΣܸд
+
+    OperandKind kind = OperandKind::NONE;
+    OperandKind indexKind = OperandKind::NONE;  //  ELEM ʹãTEMP / VAR / INT
+    uint8_t flags = 0;
+    uint32_t id = 0;
+    union {
+        int64_t i = 0;
+        double f;
+        uint32_t index;     // ELEM ±꣺TEMP šVAR  SymId ֵ
+    };
+
+    static Operand make(OperandKind k, uint32_t id) {
+        Operand o;
+        o.kind = k;
+        o.id = id;
+        return o;
+    }
+    static Operand temp(uint32_t n) { return make(OperandKind::TEMP, n); }
+    static Operand var(SymId name) { return make(OperandKind::VAR, name); }
+    static Operand label(uint32_t n) { return make(OperandKind::LABEL, n); }
+    static Operand func(SymId name) { return make(OperandKind::FUNC, name); }
+    static Operand imm(int64_t v) {
+        Operand o = make(OperandKind::INT, 0);
+        o.i = v;
+        return o;
+    }
+    static Operand immFloat(double v) {
+        Operand o = make(OperandKind::FLOAT, 0);
+        o.f = v;
+        return o;
+    }
+    static Operand immChar(int64_t c) {
+        Operand o = make(OperandKind::CHAR, 0);
+        o.i = c;
+        return o;
+    }
+    // idx  TEMPVAR  INT
+    static Operand elem(SymId arr, const Operand& idx) {
+        Operand o = make(OperandKind::ELEM, arr);
+        o.indexKind = idx.kind;
+        o.i = 0;
+        o.index = idx.kind == OperandKind::INT ? (uint32_t)(int32_t)idx.i : idx.id;
+        return o;
+    }
+
+    // ȡ ELEM ±
+    Operand elemIndex() const {
+        if (indexKind == OperandKind::INT)
+            return imm((int32_t)index);
+        return make(indexKind, index);
+    }
+
+    bool isNone() const { return kind == OperandKind::NONE; }
+    bool isTemp() const { return kind == OperandKind::TEMP; }
+    bool isVar() const { return kind == OperandKind::VAR; }
+    bool isImm() const { return kind == OperandKind::INT || kind == OperandKind::FLOAT || kind == OperandKind::CHAR; }
+    // ֵܱλãʱ
+    bool isLocation() const { return kind == OperandKind::TEMP || kind == OperandKind::VAR; }
+
+    bool operator==(const Operand& o) const {
+        if (kind != o.kind) return false;
+        switch (kind) {
+        case OperandKind::NONE:  return true;
+        case OperandKind::INT:
+        case OperandKind::CHAR:  return i == o.i;
+        case OperandKind::FLOAT: return f == o.f;
+        case OperandKind::ELEM:  return id == o.id && indexKind == o.indexKind && index == o.index;
+        default:                 return id == o.id;
+        }
+    }
+    bool operator!=(const Operand& o) const { return !(*this == o); }
+};
+static_assert(sizeof(Operand) == 16, "Operand should stay two words");
+
+/*
+* мʾĻָ
+* Լ
+*	result Ϊдλãop1/op2 Ϊȡֵ
+*	STORE_ARR ⣺result Ϊ顢op1 Ϊ±ꡢop2 Ϊдֵ߶ֻ
+*	LABEL/GOTO/IF_xxx_GOTO Ŀǩ result op1
+*	CALL  op1 Ϊʵ IRProgram ʵγ [argBegin, argBegin + argCount)
+*	FUNC_BEGIN/FUNC_END  result Ϊ IRProgram::getFunctions()
+*/
 class IRInstruction {
 public:
     IRType type;  // ͣӷȣ
     TokenType resType;
-    std::string result;  // 
-    std::string op1;  // һ
-    std::string op2;  // ڶеĻ
-    std::vector<std::string> params; // б
-
-    IRInstruction(IRType type, const std::string& result, const std::string& op1, const std::string& op2 = "", 
-        const std::vector<std::string>& params={}, const TokenType resType = TokenType::UNKNOWN)
-        : type(type), resType(resType),result(result), op1(op1), op2(op2), params(params){
+    Operand result;  // 
+    Operand op1;  // һ
+    Operand op2;  // ڶеĻ
+    uint32_t argBegin = 0;
+    uint32_t argCount = 0;
+
+    IRInstruction(IRType type, const Operand& result, const Operand& op1 = Operand(), const Operand& op2 = Operand(),
+        const TokenType resType = TokenType::UNKNOWN)
+        : type(type), resType(resType), result(result), op1(op1), op2(op2) {
     }
 
-    void print() const {
+    // result Ƿ񱻱ָд
+    bool definesResult() const {
         switch (type) {
-        case IRType::ADD:       std::cout << result << " = " << op1 << " + " << op2; break;
-        case IRType::SUB:       std::cout << result << " = " << op1 << " - " << op2; break;
-        case IRType::MUL:       std::cout << result << " = " << op1 << " * " << op2; break;
-        case IRType::DIV:       std::cout << result << " = " << op1 << " / " << op2; break;
-        case IRType::ASSIGN:    std::cout << result << " = " << op1; break;
-        case IRType::LABEL:     std::cout << result << ":"; break;
-        case IRType::GOTO:      std::cout << "goto " << result; break;
-        case IRType::IF_TRUE_GOTO:  std::cout << "if " << op1 << " goto " << result; break;
-        case IRType::IF_FALSE_GOTO: std::cout << "ifFalse " << op1 << " goto " << result; break;
-        case IRType::RETURN:    std::cout << "return " << op1; break;
-        case IRType::CALL:      std::cout << result << " = " << op1<<" ";
-            for (int i = 0; i < params.size(); i++) {
-                std::cout << params[i];
-                if (i != params.size() - 1)
-                    std::cout << ",";
-            }
-            break;
-        case IRType::PARAM:     std::cout << "param " << op1; break;
-        case IRType::FUNC_BEGIN:std::cout << "func " << valueTypeToString(resType)<<" " << result << " ";
-            for (int i = 0; i < params.size(); i++) {
-                std::cout << params[i];
-                if (i != params.size() - 1)
-                    std::cout << ",";
-            }
-            std::cout << " begin"; break;
-        case IRType::FUNC_END:  std::cout << "func " << result << " end"; break;
-
-            // ====  ====
-        case IRType::ALLOC_ARR:
-            std::cout << op1 <<" " << result << " = alloc " << op1 << " " << op2; // arr = alloc size
-            break;
-        case IRType::LOAD_ARR:
-            std::cout << result << " = " << op1 << "[" << op2 << "]"; // t = arr[i]
-            break;
-        case IRType::STORE_ARR:
-            std::cout << op1 << "[" << op2 << "] = " << result; // arr[i] = t
-            break;
+        case IRType::ADD: case IRType::SUB: case IRType::MUL: case IRType::DIV:
+        case IRType::ASSIGN: case IRType::LESS: case IRType::GREATER:
+        case IRType::EQUAL_EQUAL: case IRType::NOT_EQUAL: case IRType::AND: case IRType::OR:
+        case IRType::ALLOC_ARR: case IRType::LOAD_ARR: case IRType::CONST_BOOL:
+        case IRType::INPUT: case IRType::CALL:
+            return !result.isNone();
+        default:
+            return false;
         }
-        std::cout << std::endl;
     }
+};
 
+// FUNC_BEGIN Ĳͷ
+struct IRFunction {
+    SymId name;                 // ͵ĺ
+    TokenType retType;
+    std::vector<Param> params;
+    uint32_t begin = 0;         // FUNC_BEGIN ָ±
+    uint32_t end = 0;           // FUNC_END ָ±
 };
 
 // IR 
-class IRProgram {
+class IRProgram : public ASTVisitor<IRProgram, Operand> {
+    friend class ASTVisitor<IRProgram, Operand>;
 private:
-    int tempCount = 0;
-
-    SemanticAnalyzer st;
+    std::vector<IRInstruction> instructions;  // 洢 IR ָ
+    std::vector<Operand> callArgs;            //  CALL ʵ
+    std::vector<TokenType> tempTypes;         // ʱ - 1 -> 
+    std::vector<std::string> labelNames;      // ǩ - 1 -> ֣
+    std::vector<IRFunction> functions;
 
-    std::string inferType(CallExpr* node) {
-        for (int i = 0; i < st.historySymTable.size(); i++) {
-            st.current = st.historySymTable[i];
-            try {
-                st.inferType(node);
-
-                std::string res;
-                for (int i = 0; i < node->args.size(); i++) {
-                    auto t = st.inferType(node->args[i]);
-                    res += valueTypeToString(t);
-                }
-                return res;
-            }
-            catch (const std::exception& ex) {
-                continue;
-            }
-        }
-
-        return "";
+    // ָ
+    void addInstruction(const IRInstruction& instr) {
+        instructions.push_back(instr);
     }
 
-    std::string inferType(ExprNode* node) {
-        for (int i = 0; i < st.historySymTable.size(); i++) {
-            st.current = st.historySymTable[i];
-            try {
-                return valueTypeToString(st.inferType(node));
-            }
-            catch (const std::exception& ex) {
-                continue;
-            }
-        }
-
-        return "";
+    void emit(IRType type, const Operand& result, const Operand& op1 = Operand(), const Operand& op2 = Operand(),
+        const TokenType resType = TokenType::UNKNOWN) {
+        instructions.emplace_back(type, result, op1, op2, resType);
     }
 
-    std::string newTemp() {
-        return "t" + std::to_string(++tempCount);
+    Operand genExpr(ExprNode* expr) {
+        return dispatchExpr(expr);
     }
 
-    std::vector<IRInstruction> instructions;  // 洢 IR ָ
-
-    // ָ
-    void addInstruction(const IRInstruction& instr) {
-        instructions.push_back(instr);
+    // ɿɱдλãԪ
+    Operand genLValue(ExprNode* expr) {
+        if (auto elem = node_cast<ArrayElemExpr>(expr)) {
+            Operand idx = genExpr(elem->index);
+            if (idx.kind != OperandKind::TEMP && idx.kind != OperandKind::VAR && idx.kind != OperandKind::INT)
+                idx = materialize(idx, TokenType::INT);
+            return Operand::elem(elem->name, idx);
+        }
+        if (node_cast<VarExpr>(expr))
+            return Operand::var(expr->name);
+        // ɸֵıʽ㵽ʱ
+        return materialize(genExpr(expr), expr->type);
     }
 
-    void emit(IRType type, const std::string& result, const std::string& op1, const std::string& op2 = "",
-        const std::vector<std::string>& params = {}, const TokenType resType = TokenType::UNKNOWN) {
-        instructions.emplace_back(type, result, op1, op2, params, resType);
+    Operand materialize(const Operand& value, TokenType type) {
+        Operand t = newTemp(type);
+        emit(IRType::ASSIGN, t, value, Operand(), type);
+        return t;
     }
 
+    //  value д targetԪأ
+    void genStore(const Operand& target, const Operand& value, TokenType type) {
+        if (target.kind == OperandKind::ELEM)
+            emit(IRType::STORE_ARR, Operand::var(target.id), target.elemIndex(), value, type);
+        else
+            emit(IRType::ASSIGN, target, value, Operand(), type);
+    }
 
-    std::string visitArrayLiteral(ArrayExpr* expr)  {
+    Operand visitArray(ArrayExpr* expr)  {
         size_t n = expr->elem.size();
-        std::string arrTemp = newTemp();
-        emit(IRType::ALLOC_ARR, arrTemp, valueTypeToString(expr->type), std::to_string(n), {}, expr->type);
+        Operand arrTemp = newTemp(expr->type);
+        emit(IRType::ALLOC_ARR, arrTemp, Operand::imm((int64_t)n), Operand(), expr->type);
 
         for (size_t i = 0; i < n; ++i) {
-            std::string elemTemp = genExpr(expr->elem[i]);
-            emit(IRType::STORE_ARR, elemTemp, arrTemp, std::to_string(i), {}, expr->type);
+            Operand elemTemp = genExpr(expr->elem[i]);
+            emit(IRType::STORE_ARR, arrTemp, Operand::imm((int64_t)i), elemTemp, expr->elem[i]->type);
         }
 
         return arrTemp;
     }
 
-    std::string visitArrayAccess(ArrayElemExpr* expr) {
-        std::string arrName = uint32tsToString(expr->name);
-        std::string indexTemp = genExpr(expr->index);
-        //std::string result = newTemp();
+    Operand visitArrayElem(ArrayElemExpr* expr) {
+        Operand indexTemp = genExpr(expr->index);
+        Operand result = newTemp(expr->type);
 
-        emit(IRType::LOAD_ARR, arrName, indexTemp, "", {}, stringTovalueType(inferType(expr)));
-        return arrName + "[" + indexTemp + "]";
+        emit(IRType::LOAD_ARR, result, Operand::var(expr->name), indexTemp, expr->type);
+        return result;
     }
 
-    std::string genExpr(ExprNode* expr) {
-        if (auto num = dynamic_cast<NumberExpr*>(expr)) {
-            return std::to_string(num->value);
-        }
-        if (auto c = dynamic_cast<CharExpr*>(expr)) {
-            return "\'"+c->value+"\'";
-        }
-        if (auto var = dynamic_cast<VarExpr*>(expr)) {
-            return uint32tsToString(var->name);
-        }
-        if (auto ae = dynamic_cast<ArrayExpr*>(expr)) {
-            return visitArrayLiteral(ae);
-        }
-        if (auto aee = dynamic_cast<ArrayElemExpr*>(expr)) {
-            return visitArrayAccess(aee);
-        }
-        if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
-            std::string left = genExpr(bin->left);
-            std::string right = genExpr(bin->right);
-            std::string result = newTemp();
-
-            std::string op = uint32tsToString(bin->op);
-            if (op == "+")
-                emit(IRType::ADD, result, left, right, {}, stringTovalueType(inferType(bin->right)));
-            else if (op == "-")
-                emit(IRType::SUB, result, left, right, {}, stringTovalueType(inferType(bin->right)));
-            else if (op == "*")
-                emit(IRType::MUL, result, left, right, {}, stringTovalueType(inferType(bin->right)));
-            else if (op == "/")
-                emit(IRType::DIV, result, left, right, {}, stringTovalueType(inferType(bin->right)));
-            else if (op == "=") 
-                emit(IRType::ASSIGN, left, right, "", {}, stringTovalueType(inferType(bin->right)));
-            else if (op == "<") 
-                emit(IRType::LESS, result, left, right, {}, TokenType::BOOL);
-            else if (op == ">")
-                emit(IRType::GREATER, result, left, right, {}, TokenType::BOOL);
-            else if (op == "==")
-                emit(IRType::EQUAL_EQUAL, result, left, right, {}, TokenType::BOOL);
-            else if (op == "&&")
-                emit(IRType::AND, result, left, right, {}, TokenType::BOOL);
-            else if (op == "||")
-                emit(IRType::OR, result, left, right, {}, TokenType::BOOL);
-
-            
-
-            return result;
-        }
-        if (auto call = dynamic_cast<CallExpr*>(expr)) {
-            std::string funcName = uint32tsToString(call->callee);
-            funcName += inferType(call);
-
-            std::vector<std::string>paramNames;
-            for (auto arg : call->args) {
-                std::string val = genExpr(arg);
-                paramNames.push_back(val);
-            }
-            TokenType tret = stringTovalueType(inferType((ExprNode * )call));
-            std::string ret = newTemp();
-            emit(IRType::CALL, ret, funcName, "", paramNames, tret);
-            //addInstruction(IRInstruction(IRType::CALL, ret, fn, std::to_string(call->args.size())));
-            return ret;
-        }
+    Operand visitNumber(NumberExpr* num) {
+        if (num->type == TokenType::INT)
+            return Operand::imm((int64_t)num->value);
+        return Operand::immFloat(num->value);
+    }
 
-        return ""; // ʽԺչ
+    Operand visitChar(CharExpr* c) {
+        const std::string& text = symName(c->value);
+        if (text.empty())
+            return Operand::immChar(0);
+        auto it = text.begin();
+        return Operand::immChar(utf8::unchecked::next(it));
     }
 
-    int labelCount = 0;
+    Operand visitBool(BoolExpr* b) {
+        return Operand::imm(b->value ? 1 : 0);
+    }
 
-    std::string newLabel(const std::string& prefix = "L") {
-        return prefix + std::to_string(++labelCount);
+    Operand visitVar(VarExpr* var) {
+        return Operand::var(var->name);
     }
 
+    Operand visitBinary(BinaryExpr* bin) {
+        const std::string& op = symName(bin->op);
+        if (op == "=") {
+            Operand target = genLValue(bin->left);
+            Operand value = genExpr(bin->right);
+            genStore(target, value, bin->right->type);
+            return target;
+        }
 
-    void visitFunction(FunctionDef* func) {
+        Operand left = genExpr(bin->left);
+        Operand right = genExpr(bin->right);
+
+        IRType type;
+        if (op == "+") type = IRType::ADD;
+        else if (op == "-") type = IRType::SUB;
+        else if (op == "*") type = IRType::MUL;
+        else if (op == "/") type = IRType::DIV;
+        else if (op == "<") type = IRType::LESS;
+        else if (op == ">") type = IRType::GREATER;
+        else if (op == "==") type = IRType::EQUAL_EQUAL;
+        else if (op == "!=") type = IRType::NOT_EQUAL;
+        else if (op == "&&") type = IRType::AND;
+        else if (op == "||") type = IRType::OR;
+        else throw std::runtime_error("Unsupported operator '" + op + "' in IR generation");
+
+        Operand result = newTemp(bin->type);
+        emit(type, result, left, right, bin->type);
+        return result;
+    }
 
-        std::string funcName = uint32tsToString(func->name);
-        for (int i = 0; i < func->params.size(); i++) {
-            funcName += valueTypeToString(func->params[i].type);
-        }
-        std::vector<std::string>paramNames;
-        for (auto& i : func->params) {
-            std::string s;
-            if (i.isRef)
-                s = valueTypeToString(i.type) + " Ref " + uint32tsToString(i.name);
+    Operand visitCall(CallExpr* call) {
+        // ʱ
+        const Symbol* fn = call->fn;
+
+        std::vector<Operand> args;
+        for (size_t i = 0; i < call->args.size(); i++) {
+            if (i < fn->paramRefs.size() && fn->paramRefs[i]) {
+                Operand arg = genLValue(call->args[i]);
+                arg.flags |= Operand::REF;
+                args.push_back(arg);
+            }
             else
-                s = valueTypeToString(i.type) + " " + uint32tsToString(i.name);
-             paramNames.push_back(s);
+                args.push_back(genExpr(call->args[i]));
         }
-        emit(IRType::FUNC_BEGIN, funcName, "", "", paramNames, func->retType);
+        // ݹôƶʱδȷԺϵսΪ׼
+        TokenType tret = fn->funcReturnType;
+        Operand ret = tret == TokenType::VOID ? Operand() : newTemp(tret);
+        emit(IRType::CALL, ret, Operand::func(fn->name), Operand(), tret);
+        setCallArgs(instructions.back(), args);
+        return ret;
+    }
+
+    void visitFunctionDef(FunctionDef* func) {
+        IRFunction f;
+        f.name = func->symbol->name;
+        f.retType = func->retType;
+        f.params.assign(func->params.begin(), func->params.end());
+        f.begin = (uint32_t)instructions.size();
+        functions.push_back(f);
+        size_t index = functions.size() - 1;
+
+        emit(IRType::FUNC_BEGIN, Operand::func(f.name), Operand(), Operand(), func->retType);
 
         // 
         for (auto stmt : func->body)
             visitStatement(stmt);
-        addInstruction(IRInstruction(IRType::FUNC_END, funcName, ""));
+        emit(IRType::FUNC_END, Operand::func(f.name));
+        functions[index].end = (uint32_t)instructions.size() - 1;
     }
 
     void visitReturn(ReturnStmt* stmt) {
-        std::string value = stmt->value ? genExpr(stmt->value) : "";
-        //addInstruction(IRInstruction(IRType::RETURN, value, ""));
-        emit(IRType::RETURN, value, value);
+        Operand value = stmt->value ? genExpr(stmt->value) : Operand();
+        emit(IRType::RETURN, Operand(), value, Operand(), stmt->value ? stmt->value->type : TokenType::VOID);
     }
 
     void visitWhile(WhileStmt* stmt) {
-        std::string startLabel = newLabel("while_start");
-        std::string endLabel = newLabel("while_end");
+        Operand startLabel = newLabel("while_start");
+        Operand endLabel = newLabel("while_end");
 
-        emit(IRType::LABEL, startLabel, "", "");
+        emit(IRType::LABEL, startLabel);
 
-        if (auto boolExpr = dynamic_cast<BoolExpr*>(stmt->condition)) {
+        if (auto boolExpr = node_cast<BoolExpr>(stmt->condition)) {
             if (!boolExpr->value) {
                 // while(false) ֱ end
-                emit(IRType::GOTO, endLabel, "", "");
-                emit(IRType::LABEL, endLabel, "", "");
+                emit(IRType::GOTO, endLabel);
+                emit(IRType::LABEL, endLabel);
                 return;
             }
             // while(true) ж
         }
         else {
             // ͨ
-            std::string condTemp = genExpr(stmt->condition);
-            emit(IRType::IF_FALSE_GOTO, endLabel, condTemp, "");
+            Operand condTemp = genExpr(stmt->condition);
+            emit(IRType::IF_FALSE_GOTO, endLabel, condTemp);
         }
 
         for (auto& substmt : stmt->body)
             visitStatement(substmt);
 
-        emit(IRType::GOTO, startLabel, "", "");
-        emit(IRType::LABEL, endLabel, "", "");
+        emit(IRType::GOTO, startLabel);
+        emit(IRType::LABEL, endLabel);
     }
 
     void visitFor(ForStmt* stmt) {
-        std::string iter = uint32tsToString(stmt->param->name);
-        std::string start = stmt->startExpr ? genExpr(stmt->startExpr) : "0";
-        std::string end = stmt->endExpr ? genExpr(stmt->endExpr) : "0";
-        std::string step = stmt->stepExpr ? genExpr(stmt->stepExpr) : "1";
+        Operand iter = Operand::var(stmt->param->name);
+        Operand start = stmt->startExpr ? genExpr(stmt->startExpr) : Operand::imm(0);
+        Operand end = stmt->endExpr ? genExpr(stmt->endExpr) : Operand::imm(0);
+        Operand step = stmt->stepExpr ? genExpr(stmt->stepExpr) : Operand::imm(1);
+        TokenType type = stmt->param->type;
 
-        std::string loopVar = newTemp();
-        emit(IRType::ASSIGN, loopVar, start, "", {}, stringTovalueType(inferType(stmt->param)));
+        Operand loopVar = newTemp(type);
+        emit(IRType::ASSIGN, loopVar, start, Operand(), type);
 
-        std::string loopStart = newLabel("for_start");
-        std::string loopEnd = newLabel("for_end");
+        Operand loopStart = newLabel("for_start");
+        Operand loopEnd = newLabel("for_end");
 
-        addInstruction(IRInstruction(IRType::LABEL, loopStart, ""));
-        std::string condTemp = newTemp();
-        //addInstruction(IRInstruction(IRType::SUB, condTemp, end, loopVar));
-        emit(IRType::SUB, condTemp, end, loopVar, {}, stringTovalueType(inferType(stmt->endExpr)));
-        addInstruction(IRInstruction(IRType::IF_FALSE_GOTO, loopEnd, condTemp));
+        emit(IRType::LABEL, loopStart);
+        Operand condTemp = newTemp(TokenType::INT);
+        emit(IRType::SUB, condTemp, end, loopVar, TokenType::INT);
+        emit(IRType::IF_FALSE_GOTO, loopEnd, condTemp);
 
-        //addInstruction(IRInstruction(IRType::ASSIGN, iter, loopVar));
-        emit(IRType::ASSIGN, iter, loopVar, "", {}, stringTovalueType(inferType(stmt->param)));
+        emit(IRType::ASSIGN, iter, loopVar, Operand(), type);
         for (auto& substmt : stmt->body)
             visitStatement(substmt);
-        std::string incTemp = newTemp();
-        //addInstruction(IRInstruction(IRType::ADD, incTemp, loopVar, step));
-        emit(IRType::ADD, incTemp, loopVar, step, {}, stringTovalueType(inferType(stmt->stepExpr)));
-        //addInstruction(IRInstruction(IRType::ASSIGN, loopVar, incTemp));
-        emit(IRType::ASSIGN, loopVar, incTemp, "", {}, stringTovalueType(inferType(stmt->param)));
-        addInstruction(IRInstruction(IRType::GOTO, loopStart, ""));
-        addInstruction(IRInstruction(IRType::LABEL, loopEnd, ""));
+        Operand incTemp = newTemp(type);
+        emit(IRType::ADD, incTemp, loopVar, step, type);
+        emit(IRType::ASSIGN, loopVar, incTemp, Operand(), type);
+        emit(IRType::GOTO, loopStart);
+        emit(IRType::LABEL, loopEnd);
     }
 
     void visitIf(IfStmt* stmt) {
-        std::string startLabel = newLabel("if_start");
-        std::string endLabel = newLabel("if_end");
+        Operand startLabel = newLabel("if_start");
+        Operand endLabel = newLabel("if_end");
 
-        emit(IRType::LABEL, startLabel, "", "");
+        emit(IRType::LABEL, startLabel);
 
-        if (auto boolExpr = dynamic_cast<BoolExpr*>(stmt->condition)) {
+        if (auto boolExpr = node_cast<BoolExpr>(stmt->condition)) {
             if (!boolExpr->value) {
-                // while(false) ֱ end
-                emit(IRType::GOTO, endLabel, "", "");
-                emit(IRType::LABEL, endLabel, "", "");
+                // if(false) ֱ end
+                emit(IRType::GOTO, endLabel);
+                emit(IRType::LABEL, endLabel);
                 return;
             }
-            // while(true) ж
+            // if(true) ж
         }
         else {
             // ͨ
-            std::string condTemp = genExpr(stmt->condition);
-            emit(IRType::IF_FALSE_GOTO, endLabel, condTemp, "");
+            Operand condTemp = genExpr(stmt->condition);
+            emit(IRType::IF_FALSE_GOTO, endLabel, condTemp);
         }
 
         for (auto& substmt : stmt->body)
             visitStatement(substmt);
 
-        //emit(IRType::GOTO, startLabel, "", "");
-        emit(IRType::LABEL, endLabel, "", "");
+        emit(IRType::LABEL, endLabel);
     }
-public:
 
-    IRProgram(const SemanticAnalyzer& st) {
-        this->st = st;
+    void visitAssign(AssignStmt* assign) {
+        Operand value = genExpr(assign->value);
+        emit(IRType::ASSIGN, Operand::var(assign->varName), value, Operand(), assign->value->type);
     }
 
+    void visitExpr(ExprStmt* expr) {
+        genExpr(expr->expr); // ֻǼ㣬洢
+    }
+
+    void visitInput(InputStmt* p) {
+        Operand target = genLValue(p->expr); // Ŀλ
+        emit(IRType::INPUT, target, Operand(), Operand(), p->expr->type);
+    }
+
+    void visitOutput(OutputStmt* p) {
+        Operand value = genExpr(p->expr);
+        emit(IRType::OUTPUT, Operand(), value, Operand(), p->expr->type);
+    }
+public:
+
+    // д AST Ű󶨣ڷ֮
+    IRProgram() = default;
+
     void visitStatement(Statement* s) {
-        if (auto assign = dynamic_cast<AssignStmt*>(s)) {
-            std::string target = uint32tsToString(assign->varName);
-            std::string value = genExpr(assign->value);
-            addInstruction(IRInstruction(IRType::ASSIGN, target, value));
-        }
-        else if (auto block = dynamic_cast<IfStmt*>(s)) {
-            visitIf(block);
-        }
-        else if (auto expr = dynamic_cast<ExprStmt*>(s)) {
-            genExpr(expr->expr); // ֻǼ㣬洢
-        }
-        else if (auto rt = dynamic_cast<ReturnStmt*>(s)) {
-            visitReturn(rt);
-        }
-        else if (auto fd = dynamic_cast<FunctionDef*>(s)) {
-            visitFunction(fd);
-        }
-        else if (auto ws = dynamic_cast<WhileStmt*>(s)) {
-            visitWhile(ws);
-        }
-        else if (auto fs = dynamic_cast<ForStmt*>(s)) {
-            visitFor(fs);
-        }
-        else if (auto p = dynamic_cast<InputStmt*>(s)) {
-            std::string temp = genExpr(p->expr); // ɱʽֵʱ
-            emit(IRType::INPUT, temp,"");
-        }
-        else if (auto p = dynamic_cast<OutputStmt*>(s)) {
-            std::string temp = genExpr(p->expr); // ɱʽֵʱ
-            emit(IRType::OUTPUT, temp, "");
-        }
+        dispatchStmt(s);
     }
 
     std::vector<IRInstruction>& getInstructions() {
         return instructions;
     }
 
-    // ӡָ
-    void print() const {
+    const std::vector<IRInstruction>& getInstructions() const {
+        return instructions;
+    }
+
+    std::vector<IRFunction>& getFunctions() {
+        return functions;
+    }
+
+    const std::vector<IRFunction>& getFunctions() const {
+        return functions;
+    }
+
+    // ½ʱ / ǩŴ 1 ʼ IR  pass ʹ
+    Operand newTemp(TokenType type) {
+        tempTypes.push_back(type);
+        return Operand::temp((uint32_t)tempTypes.size());
+    }
+
+    Operand newLabel(const std::string& prefix = "L") {
+        labelNames.push_back(prefix + std::to_string(labelNames.size() + 1));
+        return Operand::label((uint32_t)labelNames.size());
+    }
+
+    size_t tempCount() const {
+        return tempTypes.size();
+    }
+
+    TokenType tempType(uint32_t n) const {
+        return tempTypes[n - 1];
+    }
+
+    size_t labelCount() const {
+        return labelNames.size();
+    }
+
+    const std::string& labelName(uint32_t n) const {
+        return labelNames[n - 1];
+    }
+
+    // CALL ʵ
+    const Operand* args(const IRInstruction& instr) const {
+        return callArgs.data() + instr.argBegin;
+    }
+
+    Operand* args(const IRInstruction& instr) {
+        return callArgs.data() + instr.argBegin;
+    }
+
+    void setCallArgs(IRInstruction& instr, const std::vector<Operand>& args) {
+        instr.argBegin = (uint32_t)callArgs.size();
+        instr.argCount = (uint32_t)args.size();
+        callArgs.insert(callArgs.end(), args.begin(), args.end());
+    }
+
+    // ıʽC ﷨ C++ ˹
+    std::string str(const Operand& o) const {
+        switch (o.kind) {
+        case OperandKind::TEMP:  return "t" + std::to_string(o.id);
+        case OperandKind::VAR:
+        case OperandKind::FUNC:  return symName(o.id);
+        case OperandKind::LABEL: return labelName(o.id);
+        case OperandKind::INT:   return std::to_string(o.i);
+        case OperandKind::FLOAT: return floatLiteral(o.f);
+        case OperandKind::CHAR:  return charLiteral(o.i);
+        case OperandKind::ELEM:  return symName(o.id) + "[" + str(o.elemIndex()) + "]";
+        default:                 return "";
+        }
+    }
+
+    static std::string floatLiteral(double v) {
+        // ȡܾȷԭд֤С
+        char buf[32];
+        for (int prec = 1; prec <= 17; prec++) {
+            snprintf(buf, sizeof(buf), "%.*g", prec, v);
+            if (std::strtod(buf, nullptr) == v)
+                break;
+        }
+        std::string s = buf;
+        if (s.find_first_of(".eEni") == std::string::npos)
+            s += ".0";
+        return s;
+    }
+
+    static std::string charLiteral(int64_t c) {
+        if (c >= 0x20 && c < 0x7f && c != '\'' && c != '\\')
+            return std::string("'") + (char)c + "'";
+        return "(char)" + std::to_string(c);
+    }
+
+    // ӡָ
+    void dump(std::ostream& os) const {
         for (const auto& instr : instructions) {
-            instr.print();
+            const std::string r = str(instr.result), a = str(instr.op1), b = str(instr.op2);
+            switch (instr.type) {
+            case IRType::ADD:       os << r << " = " << a << " + " << b; break;
+            case IRType::SUB:       os << r << " = " << a << " - " << b; break;
+            case IRType::MUL:       os << r << " = " << a << " * " << b; break;
+            case IRType::DIV:       os << r << " = " << a << " / " << b; break;
+            case IRType::LESS:      os << r << " = " << a << " < " << b; break;
+            case IRType::GREATER:   os << r << " = " << a << " > " << b; break;
+            case IRType::EQUAL_EQUAL: os << r << " = " << a << " == " << b; break;
+            case IRType::NOT_EQUAL: os << r << " = " << a << " != " << b; break;
+            case IRType::AND:       os << r << " = " << a << " && " << b; break;
+            case IRType::OR:        os << r << " = " << a << " || " << b; break;
+            case IRType::ASSIGN:    os << r << " = " << a; break;
+            case IRType::LABEL:     os << r << ":"; break;
+            case IRType::GOTO:      os << "goto " << r; break;
+            case IRType::IF_TRUE_GOTO:  os << "if " << a << " goto " << r; break;
+            case IRType::IF_FALSE_GOTO: os << "ifFalse " << a << " goto " << r; break;
+            case IRType::RETURN:    os << "return " << a; break;
+            case IRType::CALL: {
+                if (!instr.result.isNone())
+                    os << r << " = ";
+                os << a << "(";
+                const Operand* p = args(instr);
+                for (uint32_t i = 0; i < instr.argCount; i++) {
+                    if (p[i].flags & Operand::REF)
+                        os << "ref ";
+                    os << str(p[i]);
+                    if (i + 1 != instr.argCount)
+                        os << ",";
+                }
+                os << ")";
+                break;
+            }
+            case IRType::FUNC_BEGIN: os << "func " << valueTypeToString(instr.resType) << " " << r << " begin"; break;
+            case IRType::FUNC_END:  os << "func " << r << " end"; break;
+            case IRType::ALLOC_ARR: os << r << " = alloc " << valueTypeToString(instr.resType) << " " << a; break;
+            case IRType::LOAD_ARR:  os << r << " = " << a << "[" << b << "]"; break;
+            case IRType::STORE_ARR: os << r << "[" << a << "] = " << b; break;
+            case IRType::INPUT:     os << "input " << r; break;
+            case IRType::OUTPUT:    os << "output " << a; break;
+            default:                os << "<op " << (int)instr.type << ">"; break;
+            }
+            os << std::endl;
         }
     }
+
+    // ӡָ
+    void print() const {
+        dump(std::cout);
+    }
 };
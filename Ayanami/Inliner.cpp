@@ -0,0 +1,364 @@
+#include "Optimizer.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// ref βΰ󶨵Ԫأʱõ±
+struct ElemRef {
+    SymId array;
+    Operand index;
+    TokenType type;
+};
+
+class Inliner {
+public:
+    Inliner(IRProgram& prog, const InlineOptions& options)
+        :prog(prog), options(options), code(prog.getInstructions()), funcs(prog.getFunctions()) {
+        for (size_t i = 0; i < funcs.size(); i++)
+            funcIndex[funcs[i].name] = i;
+    }
+
+    InlineStats run() {
+        std::vector<IRInstruction> out;
+        out.reserve(code.size());
+        std::vector<IRFunction> result = funcs;
+        size_t next = 0;
+        for (uint32_t i = 0; i < code.size(); i++) {
+            if (next < funcs.size() && i == funcs[next].begin) {
+                const IRFunction& f = funcs[next];
+                scopeTypes.clear();
+                for (const Param& p : f.params)
+                    scopeTypes[p.name] = p.type;
+                for (uint32_t k = f.begin + 1; k < f.end; k++)
+                    if (code[k].definesResult() && code[k].result.isVar())
+                        scopeTypes.emplace(code[k].result.id, code[k].resType);
+
+                result[next].begin = (uint32_t)out.size();
+                out.push_back(code[f.begin]);
+                size_t start = out.size();
+                std::vector<IRInstruction> body(code.begin() + f.begin + 1, code.begin() + f.end);
+                std::vector<SymId> chain = { f.name };
+                expand(body, chain, false, start, out);
+                result[next].end = (uint32_t)out.size();
+                out.push_back(code[f.end]);
+                i = f.end;
+                next++;
+                continue;
+            }
+            out.push_back(code[i]);
+        }
+        stats.instructions = out.size() > code.size() ? out.size() - code.size() : 0;
+        prog.getInstructions() = std::move(out);
+        prog.getFunctions() = std::move(result);
+        return stats;
+    }
+
+private:
+    IRProgram& prog;
+    InlineOptions options;
+    const std::vector<IRInstruction> code;  // ǰĳ򣬱Ǵȡ
+    const std::vector<IRFunction> funcs;
+    std::unordered_map<SymId, size_t> funcIndex;
+    std::unordered_map<SymId, TokenType> scopeTypes;    // ǰб
+    InlineStats stats;
+    size_t counter = 0;
+
+    static size_t bodySize(const std::vector<IRInstruction>& code, const IRFunction& f) {
+        size_t n = 0;
+        for (uint32_t k = f.begin + 1; k < f.end; k++)
+            n += code[k].type != IRType::LABEL;
+        return n;
+    }
+
+    // תΧɵΪѭ
+    static std::vector<char> loopMask(const std::vector<IRInstruction>& body) {
+        std::unordered_map<uint32_t, size_t> labelPos;
+        for (size_t i = 0; i < body.size(); i++)
+            if (body[i].type == IRType::LABEL)
+                labelPos[body[i].result.id] = i;
+        std::vector<char> mask(body.size(), 0);
+        for (size_t j = 0; j < body.size(); j++) {
+            IRType t = body[j].type;
+            if (t != IRType::GOTO && t != IRType::IF_FALSE_GOTO && t != IRType::IF_TRUE_GOTO)
+                continue;
+            auto it = labelPos.find(body[j].result.id);
+            if (it != labelPos.end() && it->second <= j)
+                std::fill(mask.begin() + it->second, mask.begin() + j + 1, 1);
+        }
+        return mask;
+    }
+
+    // funcStart Ϊǰ out е㣬ڿ
+    void expand(const std::vector<IRInstruction>& body, std::vector<SymId>& chain, bool hot,
+        size_t funcStart, std::vector<IRInstruction>& out) {
+        std::vector<char> inLoop = loopMask(body);
+        for (size_t i = 0; i < body.size(); i++) {
+            const IRInstruction& instr = body[i];
+            if (instr.type == IRType::CALL && shouldInline(instr, chain, hot || inLoop[i], out.size() - funcStart))
+                inlineCall(instr, chain, hot || inLoop[i], funcStart, out);
+            else
+                out.push_back(instr);
+        }
+    }
+
+    bool shouldInline(const IRInstruction& call, const std::vector<SymId>& chain, bool hot, size_t callerSize) {
+        auto it = funcIndex.find(call.op1.id);
+        if (it == funcIndex.end() || symName(call.op1.id) == "main")
+            return false;
+        const IRFunction& f = funcs[it->second];
+        // ʡʵδñֵһִ
+        size_t size = bodySize(code, f);
+        size_t saved = call.argCount + 1;
+        size_t cost = size > saved ? size - saved : 0;
+        if (cost > (hot ? options.maxHotSize : options.maxSize))
+            return false;
+        if ((size_t)std::count(chain.begin(), chain.end(), f.name) >= options.maxRecursion)
+            return false;
+        if (callerSize + size > options.maxFunctionSize)
+            return false;
+        return canInline(call, f);
+    }
+
+    // ΪԪػַı滻Ǿ
+    bool canInline(const IRInstruction& call, const IRFunction& f) {
+        const Operand* args = prog.args(call);
+        for (uint32_t k = f.begin + 1; k < f.end; k++) {
+            const IRInstruction& instr = code[k];
+            const Operand* ops[] = { &instr.result, &instr.op1, &instr.op2 };
+            std::vector<const Operand*> all(ops, ops + 3);
+            if (instr.type == IRType::CALL)
+                for (uint32_t a = 0; a < instr.argCount; a++)
+                    all.push_back(prog.args(instr) + a);
+            for (const Operand* o : all) {
+                if (o->kind != OperandKind::ELEM)
+                    continue;
+                for (size_t p = 0; p < f.params.size(); p++)
+                    if (f.params[p].name == o->id && (p >= call.argCount || !args[p].isVar()))
+                        return false;
+            }
+        }
+        return true;
+    }
+
+    bool writesVar(const IRFunction& f, SymId name) const {
+        for (uint32_t k = f.begin + 1; k < f.end; k++) {
+            const IRInstruction& instr = code[k];
+            if (instr.definesResult() && instr.result.isVar() && instr.result.id == name)
+                return true;
+            if (instr.type == IRType::CALL) {
+                const Operand* a = prog.args(instr);
+                for (uint32_t i = 0; i < instr.argCount; i++)
+                    if (isRefArg(a[i]) && a[i].isVar() && a[i].id == name)
+                        return true;
+            }
+        }
+        return false;
+    }
+
+    TokenType typeOf(const Operand& o) const {
+        switch (o.kind) {
+        case OperandKind::INT:   return TokenType::INT;
+        case OperandKind::FLOAT: return TokenType::FLOAT;
+        case OperandKind::CHAR:  return TokenType::CHAR;
+        case OperandKind::TEMP:  return prog.tempType(o.id);
+        case OperandKind::VAR: {
+            auto it = scopeTypes.find(o.id);
+            return it == scopeTypes.end() ? TokenType::UNKNOWN : it->second;
+        }
+        default:                 return TokenType::UNKNOWN;
+        }
+    }
+
+    // һչбֵ滻
+    struct Renaming {
+        std::unordered_map<uint32_t, Operand> temps, labels;
+        std::unordered_map<SymId, Operand> vars;
+        std::unordered_map<SymId, ElemRef> elems;
+    };
+
+    Operand renameLocation(Renaming& r, const Operand& o, const IRFunction& f) {
+        if (o.isTemp()) {
+            auto it = r.temps.find(o.id);
+            if (it == r.temps.end())
+                it = r.temps.emplace(o.id, prog.newTemp(prog.tempType(o.id))).first;
+            return it->second;
+        }
+        auto it = r.vars.find(o.id);
+        if (it == r.vars.end()) {
+            // ľֲ
+            SymId fresh = intern("_inl" + std::to_string(counter) + "_" + symName(o.id));
+            for (uint32_t k = f.begin + 1; k < f.end; k++)
+                if (code[k].definesResult() && code[k].result.isVar() && code[k].result.id == o.id) {
+                    scopeTypes.emplace(fresh, code[k].resType);
+                    break;
+                }
+            it = r.vars.emplace(o.id, Operand::var(fresh)).first;
+        }
+        return it->second;
+    }
+
+    Operand rename(Renaming& r, const Operand& o, const IRFunction& f) {
+        Operand res;
+        switch (o.kind) {
+        case OperandKind::TEMP:
+        case OperandKind::VAR:
+            res = renameLocation(r, o, f);
+            break;
+        case OperandKind::LABEL: {
+            auto it = r.labels.find(o.id);
+            if (it == r.labels.end())
+                it = r.labels.emplace(o.id, prog.newLabel("inl")).first;
+            res = it->second;
+            break;
+        }
+        case OperandKind::ELEM: {
+            Operand idx = o.elemIndex();
+            if (idx.isLocation())
+                idx = renameLocation(r, idx, f);
+            res = Operand::elem(renameLocation(r, Operand::var(o.id), f).id, idx);
+            break;
+        }
+        default:
+            return o;
+        }
+        res.flags = o.flags;
+        return res;
+    }
+
+    bool isElemRef(const Renaming& r, const Operand& o) const {
+        return o.isVar() && r.elems.count(o.id);
+    }
+
+    Operand elemOperand(const ElemRef& e) const {
+        return Operand::elem(e.array, e.index);
+    }
+
+    //  ref Ԫأ뵽ʱ
+    Operand loadElem(const ElemRef& e, std::vector<IRInstruction>& body) {
+        Operand t = prog.newTemp(e.type);
+        body.emplace_back(IRType::LOAD_ARR, t, Operand::var(e.array), e.index, e.type);
+        return t;
+    }
+
+    void inlineCall(const IRInstruction& call, std::vector<SymId>& chain, bool hot,
+        size_t funcStart, std::vector<IRInstruction>& out) {
+        const IRFunction& f = funcs[funcIndex[call.op1.id]];
+        std::vector<Operand> args(prog.args(call), prog.args(call) + call.argCount);
+        counter++;
+        stats.inlined++;
+
+        Renaming r;
+        for (size_t p = 0; p < f.params.size() && p < args.size(); p++) {
+            const Param& param = f.params[p];
+            Operand a = args[p];
+            a.flags = 0;
+            if (param.isRef) {
+                if (a.kind == OperandKind::ELEM) {
+                    // ±ڵʱֵ֮ٱ仯
+                    Operand idx = a.elemIndex();
+                    if (idx.isLocation()) {
+                        Operand t = prog.newTemp(TokenType::INT);
+                        out.emplace_back(IRType::ASSIGN, t, idx, Operand(), TokenType::INT);
+                        idx = t;
+                    }
+                    r.elems[param.name] = { a.id, idx, param.type };
+                }
+                else
+                    r.vars[param.name] = a;
+                continue;
+            }
+            // ʵοͬʱ ref 룬дֵܸű
+            bool aliased = false;
+            for (size_t q = 0; q < args.size(); q++)
+                aliased |= q != p && isRefArg(args[q]) && args[q].isVar() && a.isVar() && args[q].id == a.id;
+            if (a.kind != OperandKind::ELEM && !aliased && typeOf(a) == param.type && !writesVar(f, param.name)) {
+                r.vars[param.name] = a;
+                continue;
+            }
+            SymId fresh = intern("_inl" + std::to_string(counter) + "_" + symName(param.name));
+            scopeTypes[fresh] = param.type;
+            r.vars[param.name] = Operand::var(fresh);
+            out.emplace_back(IRType::ASSIGN, Operand::var(fresh), a, Operand(), param.type);
+        }
+
+        Operand endLabel = prog.newLabel("inl_end");
+        std::vector<IRInstruction> body;
+        for (uint32_t k = f.begin + 1; k < f.end; k++)
+            renameInstruction(r, code[k], f, call, endLabel, body);
+        body.emplace_back(IRType::LABEL, endLabel);
+
+        chain.push_back(f.name);
+        expand(body, chain, hot, funcStart, out);
+        chain.pop_back();
+    }
+
+    void renameInstruction(Renaming& r, const IRInstruction& src, const IRFunction& f,
+        const IRInstruction& call, const Operand& endLabel, std::vector<IRInstruction>& body) {
+        IRInstruction instr = src;
+        if (instr.type == IRType::RETURN) {
+            if (!call.result.isNone() && !instr.op1.isNone()) {
+                Operand v = isElemRef(r, instr.op1) ? loadElem(r.elems[instr.op1.id], body) : rename(r, instr.op1, f);
+                body.emplace_back(IRType::ASSIGN, call.result, v, Operand(), call.resType);
+            }
+            body.emplace_back(IRType::GOTO, endLabel);
+            return;
+        }
+
+        // ȡ󶨵Ԫص ref β
+        auto read = [&](Operand& o) {
+            if (isElemRef(r, o))
+                o = loadElem(r.elems[o.id], body);
+            else
+                o = rename(r, o, f);
+        };
+        bool writesResult = instr.definesResult() && instr.result.isLocation();
+        if (!writesResult && instr.type != IRType::LABEL && instr.type != IRType::GOTO &&
+            instr.type != IRType::IF_FALSE_GOTO && instr.type != IRType::IF_TRUE_GOTO)
+            read(instr.result);
+        else if (!(writesResult && isElemRef(r, instr.result)))
+            instr.result = rename(r, instr.result, f);
+        read(instr.op1);
+        read(instr.op2);
+
+        if (instr.type == IRType::CALL) {
+            const Operand* a = prog.args(src);
+            std::vector<Operand> renamed;
+            for (uint32_t i = 0; i < src.argCount; i++) {
+                Operand o = a[i];
+                if (isRefArg(o) && isElemRef(r, o)) {
+                    o = elemOperand(r.elems[o.id]);
+                    o.flags = Operand::REF;
+                }
+                else
+                    read(o);
+                renamed.push_back(o);
+            }
+            prog.setCallArgs(instr, renamed);
+        }
+
+        if (writesResult && isElemRef(r, src.result)) {
+            const ElemRef& e = r.elems[src.result.id];
+            if (instr.type == IRType::INPUT) {
+                instr.result = elemOperand(e);
+                body.push_back(instr);
+                return;
+            }
+            // д ref Ԫأдʱٴ
+            Operand t = prog.newTemp(e.type);
+            instr.result = t;
+            body.push_back(instr);
+            body.emplace_back(IRType::STORE_ARR, Operand::var(e.array), e.index, t, e.type);
+            return;
+        }
+        body.push_back(instr);
+    }
+};
+
+}
+
+InlineStats inlineFunctions(IRProgram& prog, const InlineOptions& options) {
+    return Inliner(prog, options).run();
+}
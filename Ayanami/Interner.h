@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// פַţͬݵַͬ0 ̶ʾմ
+using SymId = uint32_t;
+
+/*
+* ַפ
+* 壺Ϊÿͬıʶ/ıΨһ 32 λ
+* ã
+*	TokenAST ڵűֻţȽ˻ΪȽ
+*	ıֻһݣΪÿ token һ vector
+*/
+class Interner {
+public:
+	static Interner& global() {
+		static Interner instance;
+		return instance;
+	}
+
+	SymId intern(std::string_view text) {
+		auto it = ids.find(text);
+		if (it != ids.end())
+			return it->second;
+
+		// deque ݲƶԪأ string_view ʼЧ
+		strings.emplace_back(text);
+		SymId id = (SymId)(strings.size() - 1);
+		ids.emplace(strings.back(), id);
+		return id;
+	}
+
+	const std::string& str(SymId id) const {
+		return strings[id];
+	}
+
+	size_t size() const {
+		return strings.size();
+	}
+
+private:
+	Interner() {
+		intern("");
+	}
+
+	std::deque<std::string> strings;
+	std::unordered_map<std::string_view, SymId> ids;
+};
+
+inline SymId intern(std::string_view text) {
+	return Interner::global().intern(text);
+}
+
+inline const std::string& symName(SymId id) {
+	return Interner::global().str(id);
+}
@@ -0,0 +1,571 @@
+#include "Jit.h"
+#include <cstring>
+#include <initializer_list>
+
+#if AYA_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// 루Jcc / SETcc ĵ 4 λ
+enum Cond : uint8_t { CC_B = 2, CC_AE = 3, CC_E = 4, CC_NE = 5, CC_BE = 6, CC_A = 7, CC_P = 10, CC_NP = 11,
+    CC_L = 12, CC_GE = 13, CC_LE = 14, CC_G = 15 };
+
+// ڴ [base + index * 8 + disp]index Ϊ NO_INDEX ʱûбַ
+struct Mem {
+    static constexpr uint8_t NO_INDEX = 0xFF;
+    uint8_t base;
+    uint8_t index = NO_INDEX;
+    int32_t disp = 0;
+};
+
+Mem mem(uint8_t base, int32_t disp = 0) {
+    return { base, Mem::NO_INDEX, disp };
+}
+
+// ֽĴ r ֡еλ
+Mem slot(uint32_t r) {
+    return mem(RBX, (int32_t)(8 * r));
+}
+
+/*
+* x86-64 
+* ֻǼʱõָʽתһ rel32ǩ finish ʱ
+*/
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    int newLabel() {
+        labels.push_back(-1);
+        return (int)labels.size() - 1;
+    }
+    void bind(int label) {
+        labels[label] = (int32_t)code.size();
+    }
+    int32_t offsetOf(int label) const {
+        return labels[label];
+    }
+
+    void byte(uint8_t b) {
+        code.push_back(b);
+    }
+    void dword(uint32_t v) {
+        for (int k = 0; k < 4; k++)
+            byte((uint8_t)(v >> (8 * k)));
+    }
+    void qword(uint64_t v) {
+        for (int k = 0; k < 8; k++)
+            byte((uint8_t)(v >> (8 * k)));
+    }
+
+    // ڴָѡǰ׺F2 / 66 / F3REX.W1~2 ֽڲ룬reg Ϊ ModRM  reg ֶ
+    void rm(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, uint8_t reg, const Mem& m) {
+        bool indexed = m.index != Mem::NO_INDEX;
+        if (prefix)
+            byte(prefix);
+        uint8_t rex = 0x40 | (w ? 8 : 0) | (reg & 8 ? 4 : 0) | (indexed && (m.index & 8) ? 2 : 0) | (m.base & 8 ? 1 : 0);
+        if (rex != 0x40)
+            byte(rex);
+        for (uint8_t b : opcode)
+            byte(b);
+        uint8_t mod = m.disp == 0 && (m.base & 7) != RBP ? 0 : (m.disp >= -128 && m.disp <= 127 ? 1 : 2);
+        if (indexed || (m.base & 7) == RSP) {
+            byte((uint8_t)(mod << 6 | (reg & 7) << 3 | 4));
+            byte((uint8_t)((indexed ? 3 : 0) << 6 | (indexed ? m.index & 7 : 4) << 3 | (m.base & 7)));
+        }
+        else
+            byte((uint8_t)(mod << 6 | (reg & 7) << 3 | (m.base & 7)));
+        if (mod == 1)
+            byte((uint8_t)(int8_t)m.disp);
+        else if (mod == 2)
+            dword((uint32_t)m.disp);
+    }
+
+    // ĴָrmReg  ModRM  r/m ֶ
+    void rr(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rmReg) {
+        if (prefix)
+            byte(prefix);
+        uint8_t rex = 0x40 | (w ? 8 : 0) | (reg & 8 ? 4 : 0) | (rmReg & 8 ? 1 : 0);
+        if (rex != 0x40)
+            byte(rex);
+        for (uint8_t b : opcode)
+            byte(b);
+        byte((uint8_t)(0xC0 | (reg & 7) << 3 | (rmReg & 7)));
+    }
+
+    // ---------- ָ ----------
+
+    void load(uint8_t r, const Mem& m) { rm(0, true, { 0x8B }, r, m); }        // mov r64, m
+    void store(const Mem& m, uint8_t r) { rm(0, true, { 0x89 }, r, m); }       // mov m, r64
+    void load32(uint8_t r, const Mem& m) { rm(0, false, { 0x8B }, r, m); }     // mov r32, m
+    void lea(uint8_t r, const Mem& m) { rm(0, true, { 0x8D }, r, m); }
+    void movRR(uint8_t dst, uint8_t src) { rr(0, true, { 0x89 }, src, dst); }
+    void movImm64(uint8_t r, uint64_t v) {
+        byte((uint8_t)(0x48 | (r & 8 ? 1 : 0)));
+        byte((uint8_t)(0xB8 + (r & 7)));
+        qword(v);
+    }
+    void movImm32(uint8_t r, uint32_t v) {
+        if (r & 8)
+            byte(0x41);
+        byte((uint8_t)(0xB8 + (r & 7)));
+        dword(v);
+    }
+    void movImm64(uint8_t r, const void* p) { movImm64(r, (uint64_t)(uintptr_t)p); }
+    void cmp(uint8_t r, const Mem& m) { rm(0, true, { 0x3B }, r, m); }       // cmp r64, m
+    void cmpZero(const Mem& m) { rm(0, true, { 0x83 }, 7, m); byte(0); }       // cmp qword m, 0
+    void test(uint8_t r) { rr(0, true, { 0x85 }, r, r); }
+    void test32(uint8_t r) { rr(0, false, { 0x85 }, r, r); }
+    void zero32(uint8_t r) { rr(0, false, { 0x31 }, r, r); }
+    void sxd(uint8_t r) { rr(0, true, { 0x63 }, r, r); }                        // movsxd r64, r32
+    void setcc(Cond cc, uint8_t r) { rr(0, false, { 0x0F, (uint8_t)(0x90 + cc) }, 0, r); }
+    void zxb(uint8_t r) { rr(0, false, { 0x0F, 0xB6 }, r, r); }                 // movzx r32, r8
+    void push(uint8_t r) {
+        if (r & 8)
+            byte(0x41);
+        byte((uint8_t)(0x50 + (r & 7)));
+    }
+    void pop(uint8_t r) {
+        if (r & 8)
+            byte(0x41);
+        byte((uint8_t)(0x58 + (r & 7)));
+    }
+    void callReg(uint8_t r) { rr(0, false, { 0xFF }, 2, r); }
+    void jmpReg(uint8_t r) { rr(0, false, { 0xFF }, 4, r); }
+    void call(const void* fn) {
+        movImm64(RAX, fn);
+        callReg(RAX);
+    }
+    void ret() { byte(0xC3); }
+
+    void jmp(int label) {
+        byte(0xE9);
+        rel32(label);
+    }
+    void jcc(Cond cc, int label) {
+        byte(0x0F);
+        byte((uint8_t)(0x80 + cc));
+        rel32(label);
+    }
+
+    // ת
+    void finish() {
+        for (auto& f : fixups) {
+            int32_t rel = labels[f.second] - (int32_t)(f.first + 4);
+            std::memcpy(&code[f.first], &rel, 4);
+        }
+    }
+
+private:
+    std::vector<int32_t> labels;
+    std::vector<std::pair<size_t, int>> fixups;
+
+    void rel32(int label) {
+        fixups.push_back({ code.size(), label });
+        dword(0);
+    }
+};
+
+/*
+* һķ
+* ջ֡ѹ rbx r12 r13  3 ͬصַʹ rsp  16 ֽڶ룩ڲٶ rsp
+* rbx = ֡r12 = ctxr13 = nativesrax rcx rdx rsi rdi xmm0 ֻһֽڲʹ
+*/
+class FunctionJit {
+public:
+    FunctionJit(const JitRuntime& rt, const BcFunction& fn) :rt(rt), fn(fn) {
+    }
+
+    Assembler& run() {
+        for (size_t k = 0; k < fn.code.size(); k++)
+            a.newLabel();
+        exitLabel = a.newLabel();
+        failLabel = a.newLabel();
+        divideLabel = a.newLabel();
+        boundsLabel = a.newLabel();
+        stackLabel = a.newLabel();
+
+        prologue();
+        for (size_t k = 0; k < fn.code.size(); k++) {
+            a.bind((int)k);
+            instruction(fn.code[k]);
+        }
+
+        a.bind(failLabel);
+        a.zero32(RAX);
+        a.bind(exitLabel);
+        a.pop(R13);
+        a.pop(R12);
+        a.pop(RBX);
+        a.ret();
+
+        a.bind(divideLabel);
+        a.movRR(RDI, R12);
+        a.call((const void*)rt.divideError);
+        a.jmp(failLabel);
+
+        // Խʱ rax Ϊ飬rcx Ϊ±
+        a.bind(boundsLabel);
+        a.load(RDX, mem(RAX, -8));
+        a.movRR(RSI, RCX);
+        a.movRR(RDI, R12);
+        a.call((const void*)rt.boundsError);
+        a.jmp(failLabel);
+
+        a.bind(stackLabel);
+        a.movRR(RDI, R12);
+        a.call((const void*)rt.stackError);
+        a.jmp(failLabel);
+
+        a.finish();
+        return a;
+    }
+
+private:
+    const JitRuntime& rt;
+    const BcFunction& fn;
+    Assembler a;
+    int exitLabel = 0, failLabel = 0, divideLabel = 0, boundsLabel = 0, stackLabel = 0;
+
+    //  VM::enter ֵͬջֲĴװ볣resume ǿʱ֡Ѿֱȥ
+    void prologue() {
+        a.push(RBX);
+        a.push(R12);
+        a.push(R13);
+        a.movRR(R12, RDI);
+        a.movRR(RBX, RSI);
+        a.movImm64(R13, (const void*)rt.natives);
+
+        a.movImm64(RAX, (const void*)rt.stackLimit);
+        a.cmp(RSP, mem(RAX));
+        a.jcc(CC_B, stackLabel);
+
+        int init = a.newLabel();
+        a.test(RDX);
+        a.jcc(CC_E, init);
+        a.jmpReg(RDX);
+        a.bind(init);
+
+        a.lea(RAX, slot(fn.regs));
+        a.movImm64(RCX, (const void*)rt.stackEnd);
+        a.cmp(RAX, mem(RCX));
+        a.jcc(CC_A, stackLabel);
+        if (fn.constBase > fn.params) {
+            a.lea(RDI, slot(fn.params));
+            a.movImm32(RCX, fn.constBase - fn.params);
+            a.zero32(RAX);
+            a.byte(0xF3); a.byte(0x48); a.byte(0xAB);       // rep stosq
+        }
+        if (!fn.consts.empty()) {
+            a.lea(RDI, slot(fn.constBase));
+            a.movImm64(RSI, (const void*)fn.consts.data());
+            a.movImm32(RCX, (uint32_t)fn.consts.size());
+            a.byte(0xF3); a.byte(0x48); a.byte(0xA5);       // rep movsq
+        }
+    }
+
+    // rax = b[c]Խ boundsLabelԪصڴ
+    Mem element(uint16_t arr, uint16_t idx) {
+        a.load(RAX, slot(arr));
+        a.load(RCX, slot(idx));
+        a.cmp(RCX, mem(RAX, -8));               // ޷űȽϣ±ͬԽ
+        a.jcc(CC_AE, boundsLabel);
+        return { RAX, RCX, 0 };
+    }
+
+    void intArith(const BcInstr& in, std::initializer_list<uint8_t> opcode) {
+        a.load32(RAX, slot(in.b));
+        a.rm(0, false, opcode, RAX, slot(in.c));
+        a.sxd(RAX);
+        a.store(slot(in.a), RAX);
+    }
+
+    void floatArith(const BcInstr& in, uint8_t op) {
+        a.rm(0xF2, false, { 0x0F, 0x10 }, 0, slot(in.b));
+        a.rm(0xF2, false, { 0x0F, op }, 0, slot(in.c));
+        a.rm(0xF2, false, { 0x0F, 0x11 }, 0, slot(in.a));
+    }
+
+    // al е 0/1 д int64
+    void storeFlag(uint16_t dst) {
+        a.zxb(RAX);
+        a.store(slot(dst), RAX);
+    }
+
+    void intCompare(const BcInstr& in, Cond cc) {
+        a.load(RAX, slot(in.b));
+        a.cmp(RAX, slot(in.c));
+        a.setcc(cc, RAX);
+        storeFlag(in.a);
+    }
+
+    // ucomisd xmm0, m
+    void ucomisd(const Mem& m) {
+        a.rm(0x66, false, { 0x0F, 0x2E }, 0, m);
+    }
+    void movsdLoad(const Mem& m) {
+        a.rm(0xF2, false, { 0x0F, 0x10 }, 0, m);
+    }
+
+    // NaNʱ == Ϊ١!= Ϊ
+    void floatEquality(bool equal) {
+        a.setcc(equal ? CC_E : CC_NE, RAX);
+        a.setcc(equal ? CC_NP : CC_P, RCX);
+        a.rr(0, false, { (uint8_t)(equal ? 0x20 : 0x08) }, RCX, RAX);   // and / or al, cl
+    }
+
+    void compareJump(const BcInstr& in, Cond cc) {
+        a.load(RAX, slot(in.a));
+        a.cmp(RAX, slot(in.b));
+        a.jcc(cc, in.c);
+    }
+
+    // ʱ 0 ʱת
+    void checkStatus() {
+        a.test32(RAX);
+        a.jcc(CC_E, failLabel);
+    }
+
+    void instruction(const BcInstr& in) {
+        switch (in.op) {
+        case Op::MOV:
+            a.load(RAX, slot(in.b));
+            a.store(slot(in.a), RAX);
+            break;
+
+        case Op::ADD_I: intArith(in, { 0x03 }); break;
+        case Op::SUB_I: intArith(in, { 0x2B }); break;
+        case Op::MUL_I: intArith(in, { 0x0F, 0xAF }); break;
+        case Op::DIV_I:
+            //  VM һ 64 λINT_MIN / -1 ضϺΪ INT_MIN
+            a.load(RCX, slot(in.c));
+            a.test(RCX);
+            a.jcc(CC_E, divideLabel);
+            a.load(RAX, slot(in.b));
+            a.byte(0x48); a.byte(0x99);                     // cqo
+            a.rr(0, true, { 0xF7 }, 7, RCX);                // idiv rcx
+            a.sxd(RAX);
+            a.store(slot(in.a), RAX);
+            break;
+        case Op::ADD_F: floatArith(in, 0x58); break;
+        case Op::SUB_F: floatArith(in, 0x5C); break;
+        case Op::MUL_F: floatArith(in, 0x59); break;
+        case Op::DIV_F: floatArith(in, 0x5E); break;
+
+        case Op::LT_I: intCompare(in, CC_L); break;
+        case Op::GT_I: intCompare(in, CC_G); break;
+        case Op::EQ_I: intCompare(in, CC_E); break;
+        case Op::NE_I: intCompare(in, CC_NE); break;
+        case Op::LT_F:
+            movsdLoad(slot(in.c));
+            ucomisd(slot(in.b));
+            a.setcc(CC_A, RAX);
+            storeFlag(in.a);
+            break;
+        case Op::GT_F:
+            movsdLoad(slot(in.b));
+            ucomisd(slot(in.c));
+            a.setcc(CC_A, RAX);
+            storeFlag(in.a);
+            break;
+        case Op::EQ_F:
+        case Op::NE_F:
+            movsdLoad(slot(in.b));
+            ucomisd(slot(in.c));
+            floatEquality(in.op == Op::EQ_F);
+            storeFlag(in.a);
+            break;
+        case Op::AND:
+        case Op::OR:
+            a.load(RAX, slot(in.b));
+            a.rm(0, true, { (uint8_t)(in.op == Op::AND ? 0x23 : 0x0B) }, RAX, slot(in.c));
+            a.store(slot(in.a), RAX);
+            break;
+
+        case Op::I2F:
+            a.rm(0xF2, true, { 0x0F, 0x2A }, 0, slot(in.b));        // cvtsi2sd xmm0, qword
+            a.rm(0xF2, false, { 0x0F, 0x11 }, 0, slot(in.a));
+            break;
+        case Op::F2I:
+            a.rm(0xF2, false, { 0x0F, 0x2C }, RAX, slot(in.b));     // cvttsd2si eaxԽ INT_MIN
+            a.sxd(RAX);
+            a.store(slot(in.a), RAX);
+            break;
+        case Op::I2C:
+            a.rm(0, true, { 0x0F, 0xBE }, RAX, slot(in.b));         // movsx rax, byte
+            a.store(slot(in.a), RAX);
+            break;
+        case Op::I2B:
+            a.cmpZero(slot(in.b));
+            a.setcc(CC_NE, RAX);
+            storeFlag(in.a);
+            break;
+        case Op::F2B:
+            a.rr(0x66, false, { 0x0F, 0x57 }, 0, 0);                // xorpd xmm0, xmm0
+            ucomisd(slot(in.b));
+            floatEquality(false);
+            storeFlag(in.a);
+            break;
+
+        case Op::JMP:
+            a.jmp(in.c);
+            break;
+        case Op::JT:
+        case Op::JF:
+            a.cmpZero(slot(in.a));
+            a.jcc(in.op == Op::JT ? CC_NE : CC_E, in.c);
+            break;
+        case Op::JLT_I: compareJump(in, CC_L); break;
+        case Op::JGE_I: compareJump(in, CC_GE); break;
+        case Op::JGT_I: compareJump(in, CC_G); break;
+        case Op::JLE_I: compareJump(in, CC_LE); break;
+        case Op::JEQ_I: compareJump(in, CC_E); break;
+        case Op::JNE_I: compareJump(in, CC_NE); break;
+
+        case Op::NEWARR:
+            a.movRR(RDI, R12);
+            a.lea(RSI, slot(in.a));
+            a.load(RDX, slot(in.b));
+            a.call((const void*)rt.newArray);
+            checkStatus();
+            break;
+        case Op::LOADE:
+            a.load(RDX, element(in.b, in.c));
+            a.store(slot(in.a), RDX);
+            break;
+        case Op::STOREE: {
+            Mem m = element(in.a, in.b);
+            a.load(RDX, slot(in.c));
+            a.store(m, RDX);
+            break;
+        }
+        case Op::ADDR:
+            a.lea(RAX, slot(in.b));
+            a.store(slot(in.a), RAX);
+            break;
+        case Op::ADDRE:
+            a.lea(RAX, element(in.b, in.c));
+            a.store(slot(in.a), RAX);
+            break;
+        case Op::LOADP:
+            a.load(RAX, slot(in.b));
+            a.load(RAX, mem(RAX));
+            a.store(slot(in.a), RAX);
+            break;
+        case Op::STOREP:
+            a.load(RAX, slot(in.a));
+            a.load(RCX, slot(in.b));
+            a.store(mem(RAX), RCX);
+            break;
+
+        case Op::CALL:
+            call(in);
+            break;
+        case Op::RET:
+            a.load(RAX, slot(in.a));
+            a.store(slot(0), RAX);
+            a.movImm32(RAX, 1);
+            a.jmp(exitLabel);
+            break;
+        case Op::RET_VOID:
+            a.movImm32(RAX, 1);
+            a.jmp(exitLabel);
+            break;
+
+        case Op::IN_I:
+        case Op::IN_C:
+        case Op::IN_F:
+            a.movRR(RDI, R12);
+            a.lea(RSI, slot(in.a));
+            a.movImm32(RDX, (uint32_t)in.op);
+            a.call((const void*)rt.input);
+            checkStatus();
+            break;
+        case Op::OUT_I:
+        case Op::OUT_C:
+        case Op::OUT_F:
+            a.movRR(RDI, R12);
+            a.load(RSI, slot(in.a));
+            a.movImm32(RDX, (uint32_t)in.op);
+            a.call((const void*)rt.output);
+            checkStatus();
+            break;
+        }
+    }
+
+    // ֡ڱ֮֡ѱֱӵã򽻸ʱ
+    void call(const BcInstr& in) {
+        const uint16_t* args = fn.argPool.data() + in.c;
+        for (uint16_t k = 0; k < args[0]; k++) {
+            a.load(RAX, slot(args[k + 1]));
+            a.store(slot(fn.regs + k), RAX);
+        }
+        int slow = a.newLabel(), done = a.newLabel();
+        a.lea(RSI, slot(fn.regs));
+        a.load(RAX, mem(R13, 8 * (int32_t)in.b));
+        a.test(RAX);
+        a.jcc(CC_E, slow);
+        a.movRR(RDI, R12);
+        a.zero32(RDX);
+        a.callReg(RAX);
+        a.jmp(done);
+        a.bind(slow);
+        a.movRR(RDI, R12);
+        a.movImm32(RDX, in.b);
+        a.call((const void*)rt.call);
+        a.bind(done);
+        checkStatus();
+        if (in.a != BcInstr::NO_REG) {
+            a.load(RAX, slot(fn.regs));
+            a.store(slot(in.a), RAX);
+        }
+    }
+};
+
+}
+
+JitCompiler::~JitCompiler() {
+    for (auto& p : pages)
+        munmap(p.first, p.second);
+}
+
+bool JitCompiler::compile(const BcFunction& fn, NativeCode& out) {
+    FunctionJit jit(rt, fn);
+    Assembler& a = jit.run();
+
+    // ȿдط룬ٸΪִֻ
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (a.code.size() + page - 1) / page * page;
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return false;
+    std::memcpy(p, a.code.data(), a.code.size());
+    if (mprotect(p, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(p, size);
+        return false;
+    }
+    pages.push_back({ p, size });
+    codeBytes += a.code.size();
+
+    const uint8_t* base = (const uint8_t*)p;
+    out.entry = (NativeFunction)p;
+    out.pcAddress.resize(fn.code.size());
+    for (size_t k = 0; k < fn.code.size(); k++)
+        out.pcAddress[k] = base + a.offsetOf((int)k);
+    return true;
+}
+
+#else
+
+JitCompiler::~JitCompiler() {
+}
+
+bool JitCompiler::compile(const BcFunction&, NativeCode&) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Bytecode.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define AYA_JIT 1
+#else
+#define AYA_JIT 0
+#endif
+
+/*
+* ش
+* frame ΪļĴ֡ʵдãresume ΪʱͷִУ resume ִ֡е״̬
+*  1 ʾأֵ frame[0] 0 ʾϢʱ¼
+*/
+using NativeFunction = int (*)(void* ctx, Value* frame, const void* resume);
+
+/*
+* شʱ
+* ָڱʱֱд룬ָݿ֮ٱ䣨 natives кĺ
+* ʱ 0 ʾ
+*/
+struct JitRuntime {
+    void* ctx = nullptr;                        // ԭʱ
+    NativeFunction const* natives = nullptr;    // ±ΪţδΪ
+    char* const* stackLimit = nullptr;          // rsp ջ
+    Value* const* stackEnd = nullptr;           // ֵջĩβ
+    int (*call)(void* ctx, Value* frame, uint32_t fn) = nullptr;    // δĺ
+    int (*newArray)(void* ctx, Value* dst, int64_t n) = nullptr;
+    int (*input)(void* ctx, Value* dst, uint32_t op) = nullptr;     // op Ϊ IN_I / IN_C / IN_F
+    int (*output)(void* ctx, int64_t bits, uint32_t op) = nullptr;  // op Ϊ OUT_I / OUT_C / OUT_F
+    void (*divideError)(void* ctx) = nullptr;
+    void (*boundsError)(void* ctx, int64_t index, int64_t length) = nullptr;
+    void (*stackError)(void* ctx) = nullptr;
+};
+
+struct NativeCode {
+    NativeFunction entry = nullptr;
+    std::vector<const void*> pcAddress;         // ÿֽӦıصַݴѭ;л
+};
+
+/*
+* x86-64 ʱ
+* 壺һ BcFunction ɻ룬Ž mmap ĿִҳдΪִֻУ
+* Լ
+*	System V Լrbx Ϊ֡r12 Ϊ ctxֽĴ֡Уָ֮䲻
+*	 VM ȫһ£int  32 λƣ 0Խ硢ջʱ¼󷵻 0
+*	ѱĺֱӾ natives ӵã JitRuntime::call ص
+*	ƽ̨ supported() Ϊ falseVM ִֻ
+*/
+class JitCompiler {
+public:
+    explicit JitCompiler(const JitRuntime& rt) :rt(rt) {}
+    ~JitCompiler();
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    static bool supported() { return AYA_JIT != 0; }
+
+    // ʧܣƽ̨֧֡벻ִڴ棩ʱ false
+    bool compile(const BcFunction& fn, NativeCode& out);
+
+    size_t codeBytes = 0;                       // ɵĻֽ
+
+private:
+    JitRuntime rt;
+    std::vector<std::pair<void*, size_t>> pages;
+};
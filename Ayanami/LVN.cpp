@@ -0,0 +1,255 @@
+#include "Optimizer.h"
+#include <array>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+bool isCommutative(IRType t) {
+    return t == IRType::ADD || t == IRType::MUL || t == IRType::EQUAL_EQUAL ||
+        t == IRType::NOT_EQUAL || t == IRType::AND || t == IRType::OR;
+}
+
+bool isPure(IRType t) {
+    switch (t) {
+    case IRType::ADD: case IRType::SUB: case IRType::MUL: case IRType::DIV:
+    case IRType::LESS: case IRType::GREATER: case IRType::EQUAL_EQUAL:
+    case IRType::NOT_EQUAL: case IRType::AND: case IRType::OR:
+    case IRType::LOAD_ARR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// ͣΪ UNKNOWN
+TokenType immType(const Operand& o) {
+    switch (o.kind) {
+    case OperandKind::INT:   return TokenType::INT;
+    case OperandKind::FLOAT: return TokenType::FLOAT;
+    case OperandKind::CHAR:  return TokenType::CHAR;
+    default:                 return TokenType::UNKNOWN;
+    }
+}
+
+/*
+* ֵ
+*  SSA ʱSSA ʱ֧
+* ֻһεıʽڱ֧Ŀмã֧ȫֵţ
+*/
+class ValueNumbering {
+public:
+    ValueNumbering(CFG& cfg) :cfg(cfg), prog(cfg.prog) {
+        for (const Param& p : cfg.func.params)
+            if (p.isRef)
+                refParams.push_back(Operand::var(p.name));
+        if (cfg.inSSA())
+            findStable();
+    }
+
+    LVNStats run() {
+        if (cfg.inSSA()) {
+            cfg.computeDominators();
+            visitDominatorTree(cfg.entry);
+        }
+        else
+            for (uint32_t b : cfg.layout)
+                visitBlock(cfg.blocks[b]);
+        return stats;
+    }
+
+private:
+    // (, ,  2, ڴ汾)
+    using ExprKey = std::array<uint32_t, 5>;
+
+    // ĳʽǰĸλñ棬Լʱֵ
+    struct Available {
+        Operand holder;
+        uint32_t value;
+    };
+
+    CFG& cfg;
+    IRProgram& prog;
+    std::vector<Operand> refParams;
+    std::unordered_set<uint64_t> stable;    // ֵλ
+    LVNStats stats;
+
+    uint32_t nextValue = 0;
+    uint32_t memory = 0;        // ÿοдʱһ
+    std::map<std::pair<uint8_t, uint64_t>, uint32_t> constValue;
+    std::unordered_map<uint64_t, uint32_t> stableValue;
+    std::unordered_map<uint64_t, uint32_t> localValue;  // λãֻڵǰЧ
+    std::map<ExprKey, Available> scoped;                // ֧̳
+    std::map<ExprKey, Available> local;
+
+    // SSA ֻһҲ ref ʱԼӲдֵ
+    void findStable() {
+        std::unordered_map<uint64_t, uint32_t> defs;
+        std::unordered_set<uint64_t> refs;
+        for (uint32_t b : cfg.layout) {
+            for (Phi& phi : cfg.blocks[b].phis)
+                defs[operandKey(phi.dst)]++;
+            for (IRInstruction& instr : cfg.blocks[b].code) {
+                if (Operand* d = defOf(instr))
+                    defs[operandKey(*d)]++;
+                forEachUse(prog, instr, [&](Operand& o) {
+                    if (isRefArg(o))
+                        refs.insert(operandKey(o));
+                });
+            }
+        }
+        for (auto& d : defs)
+            if (d.second == 1 && (d.first >> 32) == (uint64_t)OperandKind::TEMP && !refs.count(d.first))
+                stable.insert(d.first);
+        for (const Param& p : cfg.func.params) {
+            uint64_t key = operandKey(Operand::var(p.name));
+            if (!p.isRef && !defs.count(key) && !refs.count(key))
+                stable.insert(key);
+        }
+    }
+
+    bool isStable(const Operand& o) const {
+        return o.isImm() || (o.isLocation() && stable.count(operandKey(o)));
+    }
+
+    uint32_t valueOf(const Operand& o) {
+        if (o.isImm()) {
+            uint64_t bits;
+            std::memcpy(&bits, &o.i, sizeof bits);
+            auto it = constValue.emplace(std::make_pair((uint8_t)o.kind, bits), nextValue);
+            if (it.second)
+                nextValue++;
+            return it.first->second;
+        }
+        auto& table = isStable(o) ? stableValue : localValue;
+        auto it = table.emplace(operandKey(o), nextValue);
+        if (it.second)
+            nextValue++;
+        return it.first->second;
+    }
+
+    void setValue(const Operand& o, uint32_t v) {
+        (isStable(o) ? stableValue : localValue)[operandKey(o)] = v;
+    }
+
+    // λñд룺µֵ
+    void clobber(const Operand& o) {
+        setValue(o, nextValue++);
+        // ref βܻ֮Ϊ
+        for (const Operand& p : refParams)
+            if (o.isVar() && p.id == o.id) {
+                for (const Operand& q : refParams)
+                    setValue(q, nextValue++);
+                break;
+            }
+    }
+
+    TokenType typeOf(const Operand& o, TokenType fallback) const {
+        if (o.isTemp())
+            return prog.tempType(o.id);
+        if (o.isImm())
+            return immType(o);
+        return fallback;
+    }
+
+    void visitDominatorTree(uint32_t b) {
+        std::vector<ExprKey> added;
+        visitBlock(cfg.blocks[b], &added);
+        for (uint32_t c : cfg.blocks[b].domChildren)
+            visitDominatorTree(c);
+        for (const ExprKey& k : added)
+            scoped.erase(k);
+    }
+
+    const Available* lookup(const ExprKey& key) {
+        auto it = scoped.find(key);
+        if (it != scoped.end())
+            return &it->second;
+        it = local.find(key);
+        if (it != local.end() && valueOf(it->second.holder) == it->second.value)
+            return &it->second;
+        return nullptr;
+    }
+
+    void visitBlock(BasicBlock& blk, std::vector<ExprKey>* added = nullptr) {
+        localValue.clear();
+        local.clear();
+        memory = 0;
+        for (IRInstruction& instr : blk.code) {
+            if (instr.type == IRType::STORE_ARR) {
+                memory++;
+                continue;
+            }
+            if (instr.type == IRType::CALL) {
+                // д ref ʵ
+                memory++;
+                Operand* a = prog.args(instr);
+                for (uint32_t i = 0; i < instr.argCount; i++)
+                    if (isRefArg(a[i]) && a[i].isLocation())
+                        clobber(a[i]);
+                if (!instr.result.isNone())
+                    clobber(instr.result);
+                continue;
+            }
+            if (instr.type == IRType::INPUT) {
+                if (instr.result.isLocation())
+                    clobber(instr.result);
+                else
+                    memory++;
+                continue;
+            }
+
+            Operand* d = defOf(instr);
+            if (!d)
+                continue;
+            if (instr.type == IRType::ASSIGN) {
+                // ͬ͵ĸԴֵ
+                bool sameType = typeOf(instr.op1, TokenType::UNKNOWN) == instr.resType;
+                uint32_t v = sameType ? valueOf(instr.op1) : 0;
+                clobber(*d);
+                if (sameType)
+                    setValue(*d, v);
+                continue;
+            }
+            if (!isPure(instr.type)) {
+                clobber(*d);
+                continue;
+            }
+
+            uint32_t a = valueOf(instr.op1), c = valueOf(instr.op2);
+            if (isCommutative(instr.type) && a > c)
+                std::swap(a, c);
+            bool isLoad = instr.type == IRType::LOAD_ARR;
+            ExprKey key = { (uint32_t)instr.type, (uint32_t)instr.resType, a, c, isLoad ? memory : 0 };
+
+            const Available* found = lookup(key);
+            if (found && !(found->holder == *d)) {
+                Available prev = *found;
+                stats.expressions++;
+                if (isLoad)
+                    stats.loads++;
+                instr = IRInstruction(IRType::ASSIGN, *d, prev.holder, Operand(), instr.resType);
+                clobber(*d);
+                setValue(*d, prev.value);
+                continue;
+            }
+            clobber(*d);
+            Available avail = { *d, valueOf(*d) };
+            // ȡڴ״̬̳
+            if (added && !isLoad && isStable(instr.op1) && isStable(instr.op2) && isStable(*d)) {
+                scoped[key] = avail;
+                added->push_back(key);
+            }
+            else
+                local[key] = avail;
+        }
+    }
+};
+
+}
+
+LVNStats numberValues(CFG& cfg) {
+    return ValueNumbering(cfg).run();
+}
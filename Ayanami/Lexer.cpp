@@ -21,36 +21,44 @@ bool Lexer::isNumber(uint32_t c) {
 }
 
 uint32_t Lexer::advance() {
-    if (pos < source.size()) {
-        return source[pos++];
-    }
-    else {
+    if (pos >= length)
         return '\0'; // ļĩβؿַ
+
+    // ASCII ·ַֽ UTF-8 루SourceBuffer У
+    unsigned char c = (unsigned char)source[pos];
+    if (c < 0x80) {
+        ++pos;
+        return c;
     }
+    const char* it = source + pos;
+    uint32_t cp = utf8::unchecked::next(it);
+    pos = it - source;
+    return cp;
 }
 
 void Lexer::skipSpace() {
     ++pos;
 }
 
+SymId Lexer::lexemeFrom(size_t start) {
+    return intern(std::string_view(source + start, pos - start));
+}
+
 Token Lexer::readIdentifierOrKeyword() {
-    std::vector<uint32_t> word;
+    size_t start = pos;
     while (isAlpha(peek()) || isNumber(peek()) || peek() == '_' || isChinese(peek())) {
-        word.push_back(advance());
+        advance();
     }
 
-    if (word == stringToUint32ts("input"))
-        return { TokenType::INPUT, word, line };
-    else if (word == stringToUint32ts("output"))
-        return { TokenType::OUTPUT, word, line };
-    else if (keywords.isKeyword(word))
-        return { keywords.getEnum(word), word, line};
-    else
-        return { TokenType::IDENTIFIER, word, line };
+    std::string_view text(source + start, pos - start);
+    TokenType type = Keyword::getEnum(text);
+    if (type == TokenType::UNKNOWN)
+        type = TokenType::IDENTIFIER;
+    return { type, lexemeFrom(start), line };
 }
 
 Token Lexer::readNumber() {
-    std::vector<uint32_t> num;
+    size_t start = pos;
     bool hasDot = false;
 
     while (isNumber(peek()) || peek() == '.') {
@@ -59,9 +67,11 @@ Token Lexer::readNumber() {
                 break; // ڶСֹͣ
             hasDot = true;
         }
-        num.push_back(advance());
+        advance();
     }
 
+    SymId num = lexemeFrom(start);
+
     if (hasDot)
         return { TokenType::FLOAT_LITERAL, num, line };
     else
@@ -69,93 +79,98 @@ Token Lexer::readNumber() {
 }
 
 Token Lexer::readCharOrString() {
-    std::vector<uint32_t> str;
     advance();
-    while (peek()!='\'') {
-        str.push_back(advance());
+    size_t start = pos;
+    while (pos < length && peek() != '\'') {
+        advance();
     }
+    SymId str = lexemeFrom(start);
     advance();
 
     return { TokenType::CHAR_LITERAL, str, line };
 }
 
 Token Lexer::readOperatorOrDelimiter() {
+    size_t start = pos;
     uint32_t c = advance();
-    std::vector<uint32_t> t;
-    t.push_back(c);
-    Keyword k;
     switch (c) {
     case '+': case '-': case '*': case '/': case '<': case '>': 
     case '(': case ')': case '{': case '}': case ',':case '[' :case ']':
-        return { k.getEnum(t), stringToUint32ts(std::string(1, c)), line };
+        break;
     case '=':
-        if (source[pos] == '=') {
-            t.push_back('=');
+        if (peek() == '=')
             advance();
-        }
-        return { k.getEnum(t), stringToUint32ts(std::string(1, c)), line };
+        break;
     case '!':
-        if (source[pos] == '=') {
-            t.push_back('=');
+        if (peek() == '=')
             advance();
-        }
-        return { k.getEnum(t), stringToUint32ts(std::string(1, c)), line }; 
+        break;
     case '&':
-        if (source[pos] == '&') {
-            t.push_back('&');
+        if (peek() == '&')
             advance();
-        }
-        return { k.getEnum(t), stringToUint32ts(std::string(1, c)), line };
+        break;
     case '|':
-        if (source[pos] == '|') {
-            t.push_back('|');
+        if (peek() == '|')
             advance();
-        }
-        return { k.getEnum(t), stringToUint32ts(std::string(1, c)), line };
+        break;
 
     default:
         throw std::runtime_error(
             "Unknown symbol: " + std::to_string(c) + " at line "
             + std::to_string(line) + "\n");
-        std::cerr << "Unknown symbol: " << c << " at line " << line << "\n";
-        return { TokenType::DELIMITER, stringToUint32ts(std::string(1, c)), line };
     }
+
+    std::string_view text(source + start, pos - start);
+    return { Keyword::getEnum(text), lexemeFrom(start), line };
 }
 
 uint32_t Lexer::peek() {
-    return source[pos];
+    if (pos >= length)
+        return '\0';
+    unsigned char c = (unsigned char)source[pos];
+    if (c < 0x80)
+        return c;
+    return utf8::unchecked::peek_next(source + pos);
 }
 
-Lexer::Lexer(const std::vector<uint32_t> src) :source(src) {
-
+Lexer::Lexer(std::string_view src) :source(src.data()), length(src.size()) {
+    newlineLexeme = intern("\\n");
+    eofLexeme = intern("");
 }
 
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
-    while (pos < source.size()) {
+Token Lexer::next() {
+    while (pos < length) {
         uint32_t c = peek();
 
         if (isSpace(c)) {
             skipSpace();
         }
         else if (isNewLine(c)) {
-            tokens.push_back({ TokenType::NEWLINE, stringToUint32ts("\\n"), line });
+            Token tok = { TokenType::NEWLINE, newlineLexeme, line };
             advance();
             line++;
+            return tok;
         }
         else if (isAlpha(c) || isChinese(c)) {
-            tokens.push_back(readIdentifierOrKeyword());
+            return readIdentifierOrKeyword();
         }
         else if (isNumber(c)) {
-            tokens.push_back(readNumber());
+            return readNumber();
         }
         else if (c == '\'' || c == '"') {
-            tokens.push_back(readCharOrString());
+            return readCharOrString();
         }
         else {
-            tokens.push_back(readOperatorOrDelimiter());
+            return readOperatorOrDelimiter();
         }
     }
-    tokens.push_back({ TokenType::END_OF_FILE, stringToUint32ts(""), line });
+    return { TokenType::END_OF_FILE, eofLexeme, line };
+}
+
+std::vector<Token> Lexer::tokenize() {
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
     return tokens;
 }
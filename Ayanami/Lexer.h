@@ -3,6 +3,7 @@
 #include <string>
 #include <unordered_set>
 #include <iostream>
+#include <string_view>
 #include "utf8.h"
 #ifndef UTIL_H
 #define UTIL_H
@@ -13,11 +14,15 @@
 
 class Lexer {
 private:
-    Keyword keywords;
-    std::vector<uint32_t> source;
+    // ֱָ SourceBuffer ӳ UTF-8 ֽڣҲ
+    const char* source;
+    size_t length;
     size_t pos = 0;
     int line = 1;
 
+    SymId newlineLexeme;
+    SymId eofLexeme;
+
     bool isSpace(uint32_t c);
 
     bool isNewLine(uint32_t c);
@@ -42,8 +47,15 @@ private:
 
     uint32_t peek();
 
+    //  [start, pos) ֽ֮פΪ lexeme
+    SymId lexemeFrom(size_t start);
+
 public:
-    Lexer(const std::vector<uint32_t> src);
+    Lexer(std::string_view src);
+
+    // ȡģʽÿֻгһ tokenļĩβ END_OF_FILE
+    Token next();
 
+    // һгȫ tokenڵ
     std::vector<Token> tokenize();
 };
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "Optimizer.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// ɱ i = phi(init, next)next = i + step i - step
+struct InductionVar {
+    Operand phi;
+    Operand init;
+    Operand next;
+    Operand step;
+    bool sub = false;
+};
+
+class LoopOptimizer {
+public:
+    LoopOptimizer(CFG& cfg) :cfg(cfg), prog(cfg.prog) {}
+
+    LoopStats run() {
+        // ȸѭ preheader¿ıѭĿ鼯ϣ
+        std::vector<Loop> loops;
+        while (true) {
+            loops = cfg.findLoops();
+            size_t n = cfg.blocks.size();
+            for (Loop& loop : loops) {
+                cfg.ensurePreheader(loop);
+                if (cfg.blocks.size() != n)
+                    break;
+            }
+            if (cfg.blocks.size() == n)
+                break;
+        }
+        stats.loops = loops.size();
+        findDefinitions();
+        for (Loop& loop : loops) {
+            hoist(loop);
+            reduce(loop);
+        }
+        return stats;
+    }
+
+private:
+    static constexpr uint32_t OUTSIDE = UINT32_MAX;
+
+    CFG& cfg;
+    IRProgram& prog;
+    LoopStats stats;
+    std::unordered_map<uint64_t, uint32_t> defBlock;   // ֻһεֵ -> ڿ
+
+    // SSA ֻһҲ ref ʱԼӲдֵ
+    void findDefinitions() {
+        std::unordered_map<uint64_t, uint32_t> defs;
+        std::unordered_set<uint64_t> refs;
+        for (uint32_t b : cfg.layout) {
+            for (Phi& phi : cfg.blocks[b].phis) {
+                defs[operandKey(phi.dst)]++;
+                defBlock[operandKey(phi.dst)] = b;
+            }
+            for (IRInstruction& instr : cfg.blocks[b].code) {
+                if (Operand* d = defOf(instr)) {
+                    defs[operandKey(*d)]++;
+                    defBlock[operandKey(*d)] = b;
+                }
+                forEachUse(prog, instr, [&](Operand& o) {
+                    if (isRefArg(o))
+                        refs.insert(operandKey(o));
+                });
+            }
+        }
+        for (auto it = defBlock.begin(); it != defBlock.end();) {
+            bool single = defs[it->first] == 1 && !refs.count(it->first) &&
+                (it->first >> 32) == (uint64_t)OperandKind::TEMP;
+            it = single ? std::next(it) : defBlock.erase(it);
+        }
+        for (const Param& p : cfg.func.params) {
+            uint64_t key = operandKey(Operand::var(p.name));
+            if (!p.isRef && !defs.count(key) && !refs.count(key))
+                defBlock[key] = OUTSIDE;
+        }
+    }
+
+    bool isSingleDef(const Operand& o) const {
+        return o.isLocation() && defBlock.count(operandKey(o));
+    }
+
+    // ѭв䣺ѭⶨһεֵ
+    bool isInvariant(const Loop& loop, const Operand& o) const {
+        if (o.isNone() || o.isImm())
+            return true;
+        auto it = o.isLocation() ? defBlock.find(operandKey(o)) : defBlock.end();
+        return it != defBlock.end() && !loop.contains(it->second);
+    }
+
+    static bool isHoistable(const IRInstruction& instr) {
+        switch (instr.type) {
+        case IRType::ADD: case IRType::SUB: case IRType::MUL:
+        case IRType::LESS: case IRType::GREATER: case IRType::EQUAL_EQUAL:
+        case IRType::NOT_EQUAL: case IRType::AND: case IRType::OR:
+        case IRType::ASSIGN:
+            return true;
+        case IRType::DIV:
+            // ʹѭһζִҲ㣬
+            if (instr.op2.kind == OperandKind::INT)
+                return instr.op2.i != 0 && instr.op2.i != -1;
+            return instr.op2.kind == OperandKind::FLOAT && instr.op2.f != 0.0;
+        default:
+            return false;
+        }
+    }
+
+    //  preheader ת֮ǰ
+    void appendToPreheader(const Loop& loop, const IRInstruction& instr) {
+        auto& code = cfg.blocks[loop.preheader].code;
+        auto at = cfg.blocks[loop.preheader].terminator() ? code.end() - 1 : code.end();
+        auto it = code.insert(at, instr);
+        if (Operand* d = defOf(*it))
+            defBlock[operandKey(*d)] = loop.preheader;
+    }
+
+    void hoist(const Loop& loop) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t b : cfg.layout) {
+                if (!loop.contains(b))
+                    continue;
+                auto& code = cfg.blocks[b].code;
+                for (size_t i = 0; i < code.size();) {
+                    IRInstruction& instr = code[i];
+                    Operand* d = defOf(instr);
+                    if (!d || !d->isTemp() || !isSingleDef(*d) || !isHoistable(instr) ||
+                        !isInvariant(loop, instr.op1) || !isInvariant(loop, instr.op2)) {
+                        i++;
+                        continue;
+                    }
+                    IRInstruction moved = instr;
+                    code.erase(code.begin() + i);
+                    appendToPreheader(loop, moved);
+                    stats.hoisted++;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    //  next Ķָi + cc + i  i - c
+    bool matchStep(const Loop& loop, InductionVar& iv) {
+        auto it = defBlock.find(operandKey(iv.next));
+        if (it == defBlock.end() || !loop.contains(it->second))
+            return false;
+        for (IRInstruction& instr : cfg.blocks[it->second].code) {
+            if (!(instr.result == iv.next))
+                continue;
+            if (instr.type == IRType::ADD && instr.op1 == iv.phi)
+                iv.step = instr.op2;
+            else if (instr.type == IRType::ADD && instr.op2 == iv.phi)
+                iv.step = instr.op1;
+            else if (instr.type == IRType::SUB && instr.op1 == iv.phi) {
+                iv.step = instr.op2;
+                iv.sub = true;
+            }
+            else
+                return false;
+            return isIntValue(iv.step) && isInvariant(loop, iv.step);
+        }
+        return false;
+    }
+
+    bool isIntValue(const Operand& o) const {
+        if (o.kind == OperandKind::INT)
+            return true;
+        if (o.isVar()) {
+            for (const Param& p : cfg.func.params)
+                if (p.name == o.id)
+                    return p.type == TokenType::INT;
+            return false;
+        }
+        return o.isTemp() && prog.tempType(o.id) == TokenType::INT;
+    }
+
+    std::vector<InductionVar> findInductionVars(const Loop& loop) {
+        std::vector<InductionVar> ivs;
+        BasicBlock& header = cfg.blocks[loop.header];
+        for (Phi& phi : header.phis) {
+            if (phi.type != TokenType::INT || !isSingleDef(phi.dst))
+                continue;
+            InductionVar iv;
+            iv.phi = phi.dst;
+            bool ok = true;
+            for (size_t k = 0; k < header.preds.size() && ok; k++) {
+                const Operand& a = phi.args[k];
+                if (header.preds[k] == loop.preheader)
+                    iv.init = a;
+                else if (iv.next.isNone())
+                    iv.next = a;
+                else
+                    ok = a == iv.next;
+            }
+            if (ok && !iv.init.isNone() && isSingleDef(iv.next) && matchStep(loop, iv))
+                ivs.push_back(iv);
+        }
+        return ivs;
+    }
+
+    //  preheader  a * bֱ۵
+    Operand multiplyInPreheader(const Loop& loop, const Operand& a, const Operand& b) {
+        Operand folded;
+        if (foldBinary(IRType::MUL, a, b, TokenType::INT, folded))
+            return folded;
+        // ɱ 0 ʼΪ 1
+        for (int side = 0; side < 2; side++) {
+            const Operand& c = side ? b : a;
+            const Operand& other = side ? a : b;
+            if (c.kind == OperandKind::INT && c.i == 0)
+                return Operand::imm(0);
+            if (c.kind == OperandKind::INT && c.i == 1)
+                return other;
+        }
+        Operand t = prog.newTemp(TokenType::INT);
+        appendToPreheader(loop, IRInstruction(IRType::MUL, t, a, b, TokenType::INT));
+        return t;
+    }
+
+    void reduce(const Loop& loop) {
+        std::vector<InductionVar> ivs = findInductionVars(loop);
+        if (ivs.empty())
+            return;
+        // (ɱ, ) -> µĹɱͬĳ˻ֻһ
+        std::vector<std::pair<std::pair<Operand, Operand>, Operand>> made;
+
+        for (uint32_t b : cfg.layout) {
+            if (!loop.contains(b))
+                continue;
+            for (size_t i = 0; i < cfg.blocks[b].code.size(); i++) {
+                IRInstruction& instr = cfg.blocks[b].code[i];
+                if (instr.type != IRType::MUL || instr.resType != TokenType::INT)
+                    continue;
+                const InductionVar* iv = nullptr;
+                Operand k;
+                for (const InductionVar& v : ivs) {
+                    if (instr.op1 == v.phi) { iv = &v; k = instr.op2; }
+                    else if (instr.op2 == v.phi) { iv = &v; k = instr.op1; }
+                    if (iv) break;
+                }
+                if (!iv || !isIntValue(k) || !isInvariant(loop, k))
+                    continue;
+
+                Operand s;
+                for (auto& m : made)
+                    if (m.first.first == iv->phi && m.first.second == k)
+                        s = m.second;
+                if (s.isNone()) {
+                    // ָܲڱ鵱ǰλ֮ǰ
+                    std::pair<uint32_t, size_t> at;
+                    s = newInductionVar(loop, *iv, k, at);
+                    made.push_back({ { iv->phi, k }, s });
+                    if (at.first == b && at.second <= i)
+                        i++;
+                }
+                IRInstruction& cur = cfg.blocks[b].code[i];
+                cur = IRInstruction(IRType::ASSIGN, cur.result, s, Operand(), TokenType::INT);
+                stats.reduced++;
+            }
+        }
+    }
+
+    // s = phi(init * k, s + step * k)½ next Ķ֮
+    // at ظָ (, ±)
+    Operand newInductionVar(const Loop& loop, const InductionVar& iv, const Operand& k,
+        std::pair<uint32_t, size_t>& at) {
+        Operand start = multiplyInPreheader(loop, iv.init, k);
+        Operand stride = multiplyInPreheader(loop, iv.step, k);
+        Operand s = prog.newTemp(TokenType::INT);
+        Operand sNext = prog.newTemp(TokenType::INT);
+
+        BasicBlock& header = cfg.blocks[loop.header];
+        Phi phi;
+        phi.dst = s;
+        phi.var = s;
+        phi.type = TokenType::INT;
+        for (uint32_t p : header.preds)
+            phi.args.push_back(p == loop.preheader ? start : sNext);
+        header.phis.push_back(phi);
+        defBlock[operandKey(s)] = loop.header;
+
+        uint32_t b = defBlock[operandKey(iv.next)];
+        auto& code = cfg.blocks[b].code;
+        auto pos = std::find_if(code.begin(), code.end(),
+            [&](const IRInstruction& instr) { return instr.result == iv.next; }) + 1;
+        at = { b, (size_t)(pos - code.begin()) };
+        code.insert(pos, IRInstruction(iv.sub ? IRType::SUB : IRType::ADD, sNext, s, stride, TokenType::INT));
+        defBlock[operandKey(sNext)] = b;
+        return s;
+    }
+};
+
+}
+
+LoopStats optimizeLoops(CFG& cfg) {
+    if (!cfg.inSSA())
+        cfg.toSSA();
+    return LoopOptimizer(cfg).run();
+}
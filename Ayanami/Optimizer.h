@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include "CFG.h"
+
+/*
+* IR Ż pass
+* ÿ pass ڵ CFGرθĶͳ
+*/
+
+// ---------- ϡҪ SSA ----------
+struct SCCPStats {
+    size_t folded = 0;      // ۵ָ phi
+    size_t branches = 0;    // ȷķ֧
+    size_t blocks = 0;      // ˲ɴɾĿ
+};
+
+/*
+*  SSA  Wegman-Zadeck ϡ
+*	Ƚϡ߼ڱֵʹô
+*	ΪתдΪ GOTO ֱ˳ִУ߲Ŀ鱻ɾ
+*/
+SCCPStats propagateConstants(CFG& cfg);
+
+//  type  C++ ۵һζԪ㣬޷۵ 0ʱ false
+bool foldBinary(IRType op, const Operand& a, const Operand& b, TokenType type, Operand& out);
+
+// ѳתΪ type Ӧint ضΪ 32 λchar ضΪ 8 λ
+bool coerceConstant(const Operand& value, TokenType type, Operand& out);
+
+// ----------  ----------
+struct DCEStats {
+    size_t instructions = 0;    // ɾָǩת
+    size_t temps = 0;           // ٳֵʱ
+    size_t blocks = 0;          // ɾĲɴ
+};
+
+/*
+* ڻԾɾٱȡָ
+*	CALL / INPUT иõָֻòķֵ
+*	ͬʱɾɴ顢һ GOTOûתָıǩ
+*	SSA ʽȥ phi ٷ
+*/
+DCEStats eliminateDeadCode(CFG& cfg);
+
+// ---------- ƴʱϲ ----------
+struct CopyStats {
+    size_t propagated = 0;      // 滻ĸƣƽ phi
+    size_t coalesced = 0;       // Ψһʹߵʱ
+};
+
+/*
+* SSA ϵĸƴ
+*	t = sͬs ֻһΣ t ʹû s ɾ
+*	ͬ phi ͬΪ
+*/
+CopyStats propagateCopies(CFG& cfg);
+
+/*
+* ȥ SSA ϲʱֻһ x = t ʹõ t
+* ֮ûжд x t Ķֱд x ɾ
+* t1 = i + 1; i = t1  =>  i = i + 1
+*/
+CopyStats coalesceTemps(CFG& cfg);
+
+// ---------- ֲֵ ----------
+struct LVNStats {
+    size_t expressions = 0;     // дΪƵظ
+    size_t loads = 0;           // ظȡ
+};
+
+/*
+* ڵľֲֵ
+*	Ƚϡ߼ LOAD_ARR , ֵţȥأ
+*	ظļдΪ dst = ǰƴ
+*	STORE_ARRCALLINPUT ֮ǰȡȫ
+*/
+LVNStats numberValues(CFG& cfg);
+
+// ---------- ѭŻ ----------
+struct LoopStats {
+    size_t loops = 0;           // ҵȻѭ
+    size_t hoisted = 0;         // Ĳָ
+    size_t reduced = 0;         // ǿĳ˷
+};
+
+/*
+* SSA ϵѭŻڲѭ
+*	᣺ѭⶨĴƵ preheader
+*	ֻڳΪ 0 -1 ĳʱᣬȡ
+*	ɱǿi = phi(init, i + c) ʱ i * k ΪµĹɱ s
+*	s  init * k ʼÿε c * k
+*/
+LoopStats optimizeLoops(CFG& cfg);
+
+// ----------  ----------
+struct InlineOptions {
+    size_t maxSize = 40;        // ָޣǩ
+    size_t maxHotSize = 120;    // õѭʱ
+    size_t maxRecursion = 2;    // ͬһһչ
+    size_t maxFunctionSize = 4000;  // ָ
+};
+
+struct InlineStats {
+    size_t inlined = 0;         // չĵõ
+    size_t instructions = 0;    // ָ
+};
+
+/*
+*  IR չãڽ CFG ֮ǰ
+*	ʱǩֲȫµģֲΪ _inlN_
+*	ֵдһʱֱʵΣƵµľֲ
+*	ref ʵǱʱֱ滻Ԫʱȹ̶±꣬
+*		ÿζдתɶԸԪص LOAD_ARR / STORE_ARR C++ õһ
+*	RETURN Ϊýֵչĩβ
+*/
+InlineStats inlineFunctions(IRProgram& prog, const InlineOptions& options = InlineOptions());
+
+// ---------- βݹ ----------
+/*
+* Ѷβøĳɸ¸ֵغͷظдĵ
+*	βãֻ֮տ顢GOTO RETURNֵ򷵻صýĩβ
+*	ref ԭͬһλõ ref ޷°󶨣д
+*	ڷ SSA  CFG У֮ǰ
+*/
+size_t eliminateTailCalls(CFG& cfg);
@@ -9,7 +9,7 @@ Statement* Parser::parseStatement() {
     while (match(TokenType::NEWLINE)) 
         continue;
 
-    Token tok = peek();
+    const Token& tok = peek();
 
     Statement* stmt = nullptr;
     if (tok.type == TokenType::FN) {
@@ -52,7 +52,7 @@ ForStmt* Parser::parseForStmt() {
     ExprNode* param;
 
     if (paramToken.type == TokenType::IDENTIFIER) {
-        param = new VarExpr(paramToken.lexeme);
+        param = arena.make<VarExpr>(paramToken.lexeme);
     }
     else {
         throw std::runtime_error(
@@ -73,7 +73,7 @@ ForStmt* Parser::parseForStmt() {
 
     expect(TokenType::IN);               //  in
 
-    ExprNode* start, *end, *step=new NumberExpr(1);
+    ExprNode* start, *end, *step=arena.make<NumberExpr>(1.0);
 
     expect(TokenType::LPAREN);               //  (
     start = parseExpression();
@@ -87,7 +87,7 @@ ForStmt* Parser::parseForStmt() {
     }
     else {
         end = start;
-        start = new NumberExpr(0);
+        start = arena.make<NumberExpr>(0.0);
     }
     consume(TokenType::RPAREN, "Expected ')'");//  )
 
@@ -98,7 +98,7 @@ ForStmt* Parser::parseForStmt() {
         advance(); // 
     }
 
-    return new ForStmt{ param, start, end, step, body };
+    return arena.make<ForStmt>(param, start, end, step, body);
 }
 
 WhileStmt* Parser::parseWhileStmt() {
@@ -113,12 +113,12 @@ WhileStmt* Parser::parseWhileStmt() {
         advance(); // 
     }
 
-    return new WhileStmt{ param, body };
+    return arena.make<WhileStmt>(param, body);
 }
 
 FunctionDef* Parser::parseFunction() {
     expect(TokenType::FN);               //  fn
-    std::vector<uint32_t> name = expect(TokenType::IDENTIFIER).lexeme;  // Ǳʶ
+    SymId name = expect(TokenType::IDENTIFIER).lexeme;  // Ǳʶ
     expect(TokenType::LPAREN);           //  (
     auto params = parseParamList();    // б
     expect(TokenType::RPAREN);           //  )
@@ -129,7 +129,7 @@ FunctionDef* Parser::parseFunction() {
         advance(); // 
     }
 
-    return new FunctionDef{ name, params, body };
+    return arena.make<FunctionDef>(name, params, body);
 }
 
 Statement* Parser::parseIf() {
@@ -143,7 +143,7 @@ Statement* Parser::parseIf() {
     }
     consume(TokenType::RBRACE, "expect '}' after if block");
 
-    return new IfStmt(condition, body);
+    return arena.make<IfStmt>(condition, arena.copy(body));
 }
 
 Statement* Parser::parseReturn() {
@@ -154,7 +154,7 @@ Statement* Parser::parseReturn() {
     }
 
     if (match(TokenType::NEWLINE) || check(TokenType::END_OF_FILE)) {
-        return new ReturnStmt(value);
+        return arena.make<ReturnStmt>(value);
     }else{
         throw std::runtime_error(
             "Expected newline after statement at pos " +
@@ -163,12 +163,12 @@ Statement* Parser::parseReturn() {
     }
 }
 
-std::vector<Param> Parser::parseParamList() {
+Span<Param> Parser::parseParamList() {
     std::vector<Param> params;
 
     //  ')'бΪ
     if (peek().type == TokenType::RPAREN) {
-        return params;
+        return Span<Param>();
     }
 
     while (true) {
@@ -207,7 +207,7 @@ std::vector<Param> Parser::parseParamList() {
         }
     }
 
-    return params;
+    return arena.copy(params);
 }
 
 Statement* Parser::parseConstDecl() {
@@ -223,7 +223,7 @@ Statement* Parser::parseConstDecl() {
     ExprNode* value = parseExpression();
 
     // һ AssignStmt ڵ
-    auto node = new AssignStmt();
+    auto node = arena.make<AssignStmt>();
     node->varName = name.lexeme;
     node->value = value;
     node->isConst = true; //ǳ
@@ -233,7 +233,7 @@ Statement* Parser::parseConstDecl() {
 
 Statement* Parser::parseExprStatement() {
     ExprNode* expr = parseExpression();
-    return new ExprStmt(expr);
+    return arena.make<ExprStmt>(expr);
 }
 
 ExprNode* Parser::parseExpression() {
@@ -249,7 +249,7 @@ ExprNode* Parser::parseAssignment() {
             throw std::runtime_error("Invalid assignment target");
         }
         ExprNode* right = parseAssignment();
-        return new BinaryExpr(left, "=", right);
+        return arena.make<BinaryExpr>(left, "=", right);
     }
 
     return left;
@@ -259,7 +259,7 @@ ExprNode* Parser::parseLogicalOr() {
     ExprNode* left = parseLogicalAnd();
     while (match(TokenType::OR)) { // ||
         ExprNode* right = parseLogicalAnd();
-        left = new BinaryExpr(left, stringToUint32ts("||"), right);
+        left = arena.make<BinaryExpr>(left, "||", right);
     }
     return left;
 }
@@ -268,7 +268,7 @@ ExprNode* Parser::parseLogicalAnd() {
     ExprNode* left = parseEquality();
     while (match(TokenType::AND)) { // &&
         ExprNode* right = parseEquality();
-        left = new BinaryExpr(left, stringToUint32ts("&&"), right);
+        left = arena.make<BinaryExpr>(left, "&&", right);
     }
     return left;
 }
@@ -278,11 +278,11 @@ ExprNode* Parser::parseEquality() {
     while (true) {
         if (match(TokenType::EQUAL_EQUAL)) { // ==
             ExprNode* right = parseRelational();
-            left = new BinaryExpr(left,"==", right);
+            left = arena.make<BinaryExpr>(left,"==", right);
         }
         else if (match(TokenType::NOT_EQUAL)) { // !=
             ExprNode* right = parseRelational();
-            left = new BinaryExpr(left, "!=", right);
+            left = arena.make<BinaryExpr>(left, "!=", right);
         }
         else break;
     }
@@ -294,11 +294,11 @@ ExprNode* Parser::parseRelational() {
     while (true) {
         if (match(TokenType::LESS)) {
             ExprNode* right = parseAdditive();
-            left = new BinaryExpr(left, "<", right);
+            left = arena.make<BinaryExpr>(left, "<", right);
         }
         else if (match(TokenType::GREATER)) {
             ExprNode* right = parseAdditive();
-            left = new BinaryExpr(left, ">", right);
+            left = arena.make<BinaryExpr>(left, ">", right);
         }
         else break;
     }
@@ -310,11 +310,11 @@ ExprNode* Parser::parseAdditive() {
     while (true) {
         if (match(TokenType::ADD)) {
             ExprNode* right = parseMultiplicative();
-            left = new BinaryExpr(left, "+", right);
+            left = arena.make<BinaryExpr>(left, "+", right);
         }
         else if (match(TokenType::SUB)) {
             ExprNode* right = parseMultiplicative();
-            left = new BinaryExpr(left, "-", right);
+            left = arena.make<BinaryExpr>(left, "-", right);
         }
         else break;
     }
@@ -326,7 +326,7 @@ ExprNode* Parser::parseMultiplicative() {
     while (match(TokenType::MUL) || match(TokenType::DEV)) {
         Token op = previous();
         ExprNode* right = parseMultiplicative(); // ݹ飬֤ҽ
-        left = new BinaryExpr(left, op.lexeme, right);
+        left = arena.make<BinaryExpr>(left, op.lexeme, right);
     }
     return left;
 }
@@ -334,17 +334,17 @@ ExprNode* Parser::parseMultiplicative() {
 ExprNode* Parser::parsePrimary() {
     Token cur = peek();
     //std::cout << "parsePrimary(): token=" << cur
-    //    << " value=" << uint32tsToString(peek().lexeme) <<" pos= "<<pos << std::endl;
+    //    << " value=" << symName(peek().lexeme) <<" pos= "<<pos << std::endl;
 
     if (match(TokenType::INT_LITERAL) || match(TokenType::FLOAT_LITERAL)) {
-        return new NumberExpr(previous().lexeme);
+        return arena.make<NumberExpr>(previous().lexeme);
         
     }
     else if (match(TokenType::CHAR_LITERAL)) {
-        return new CharExpr(previous().lexeme);
+        return arena.make<CharExpr>(previous().lexeme);
     }
     if (match(TokenType::IDENTIFIER))  {
-        std::vector<uint32_t> name = previous().lexeme;
+        SymId name = previous().lexeme;
         if (match(TokenType::LPAREN)) {
             std::vector<ExprNode*> args;
             if (!check(TokenType::RPAREN)) {
@@ -353,19 +353,19 @@ ExprNode* Parser::parsePrimary() {
                 } while (match(TokenType::COMMA));
             }
             consume(TokenType::RPAREN, "Expected ')'");
-            return new CallExpr(name, args);
+            return arena.make<CallExpr>(name, arena.copy(args));
         }
         if (match(TokenType::LSQUARE)) {
             ExprNode* index = parseExpression();
             consume(TokenType::RSQUARE, "Expected ']' after index");
-            return new ArrayElemExpr(name, index);
+            return arena.make<ArrayElemExpr>(name, index);
         }
-        return new VarExpr(name);
+        return arena.make<VarExpr>(name);
     }
     if (match(TokenType::TRUE))  
-        return new BoolExpr(true);
+        return arena.make<BoolExpr>(true);
     if (match(TokenType::FALSE))
-        return new BoolExpr(false);
+        return arena.make<BoolExpr>(false);
     if (match(TokenType::LPAREN)) {
         ExprNode* expr = parseExpression();
         consume(TokenType::RPAREN, "Expected ')'");
@@ -379,18 +379,18 @@ ExprNode* Parser::parsePrimary() {
             } while (match(TokenType::COMMA));
         }
         consume(TokenType::RSQUARE, "Expected ']'");
-        return new ArrayExpr(args);
+        return arena.make<ArrayExpr>(arena.copy(args));
     }
 
    // std::cout << "parsePrimary(): token=" << cur
-   //     << " value=" << uint32tsToString(peek().lexeme) << " pos= " << pos << std::endl;
+   //     << " value=" << symName(peek().lexeme) << " pos= " << pos << std::endl;
     throw std::runtime_error(
         "Unexpected token, pos "+std::to_string(pos)+"\n"
     );
     return nullptr;
 }
 
-std::vector<Statement*> Parser::parseBlock() {
+Span<Statement*> Parser::parseBlock() {
     expect(TokenType::LBRACE);
 
     std::vector<Statement*> stmts;
@@ -400,7 +400,7 @@ std::vector<Statement*> Parser::parseBlock() {
 
     expect(TokenType::RBRACE); // ȷ consume }
 
-    return stmts;
+    return arena.copy(stmts);
 }
 
 Statement* Parser::parseInput() {
@@ -412,7 +412,7 @@ Statement* Parser::parseInput() {
 
     expect(TokenType::RPAREN);
 
-    return new InputStmt(str);
+    return arena.make<InputStmt>(str);
 }
 
 Statement* Parser::parseOutput() {
@@ -424,5 +424,5 @@ Statement* Parser::parseOutput() {
 
     expect(TokenType::RPAREN);
 
-    return new OutputStmt(str);
+    return arena.make<OutputStmt>(str);
 }
\ No newline at end of file
@@ -14,20 +14,40 @@
 #endif
 
 
+#include"Lexer.h"
+
 class Parser {
 private:
-	std::vector<Token> tokens;
-	size_t pos;
-
-    Token peek() const { 
-        return tokens[pos];
+    // һԳȫ tokenǴ Lexer ȡ
+    // ֻһСǰհλһѵ token
+    static constexpr size_t LOOKAHEAD = 4;
+
+    Lexer& lexer;
+    AstArena& arena;      // нڵ㶼ɵ÷ͳһͷ
+    Token window[LOOKAHEAD];
+    size_t head = 0;      // λеǰ token λ
+    size_t buffered = 0;  // ȡδѵ token 
+    Token prev{};
+    size_t pos;           // ѵ token ڱ
+
+    // 鿴 k δѵ tokenk < LOOKAHEAD
+    const Token& peek(size_t k = 0) {
+        while (buffered <= k) {
+            window[(head + buffered) % LOOKAHEAD] = lexer.next();
+            buffered++;
+        }
+        return window[(head + k) % LOOKAHEAD];
     }
 
-    Token advance() {
-        return tokens[pos++]; 
+    const Token& advance() {
+        prev = peek();
+        head = (head + 1) % LOOKAHEAD;
+        buffered--;
+        pos++;
+        return prev;
     }
 
-    Token consume(TokenType type, const std::string& msg) {
+    const Token& consume(TokenType type, const std::string& msg) {
         if (check(type)) 
             return advance();
         throw std::runtime_error("Parse error: " + msg);
@@ -46,16 +66,16 @@ private:
         return peek().type == t;
     }
 
-    bool isAtEnd() const {
-        return pos >= tokens.size(); 
+    bool isAtEnd() {
+        return peek().type == TokenType::END_OF_FILE;
     }
 
-    Token previous() {
-        return tokens[pos - 1];
+    const Token& previous() {
+        return prev;
     }
 
-    Token expect(TokenType expectedType) {
-        Token tok = peek();  // 鿴ǰ tokenƶָ
+    const Token& expect(TokenType expectedType) {
+        const Token& tok = peek();  // 鿴ǰ tokenƶָ
         if (tok.type != expectedType) {
             throw std::runtime_error(
                 "Syntax﷨ error: expected " + std::to_string((int)(expectedType)) +
@@ -63,8 +83,7 @@ private:
                 +std::to_string(tok.line)+" pos= "+ std::to_string(pos)
             );
         }
-        advance();  // ָƶʾ token ѱ
-        return tok;
+        return advance();  // ָƶʾ token ѱ
     }
 
     void skipNewlines() {
@@ -74,11 +93,11 @@ private:
     }
 
 
-    std::vector<Param> parseParamList();
+    Span<Param> parseParamList();
 
 public:
-	Parser(const std::vector<Token>& tokens) : 
-		tokens(tokens), pos(0) {}
+	Parser(Lexer& lexer, AstArena& arena) : 
+		lexer(lexer), arena(arena), pos(0) {}
 
     Statement* parseStatement();
 
@@ -110,5 +129,5 @@ public:
     ExprNode* parsePrimary();           // š
 
 
-    std::vector<Statement*> parseBlock();
+    Span<Statement*> parseBlock();
 };
\ No newline at end of file
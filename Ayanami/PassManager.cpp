@@ -0,0 +1,252 @@
+#include "PassManager.h"
+#include "Optimizer.h"
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+// ---------- IR  ----------
+
+static bool isJump(IRType t) {
+    return t == IRType::GOTO || t == IRType::IF_FALSE_GOTO || t == IRType::IF_TRUE_GOTO;
+}
+
+void verifyFunction(CFG& cfg) {
+    IRProgram& prog = cfg.prog;
+    auto fail = [&](const std::string& why) {
+        throw std::runtime_error("invalid IR in " + symName(cfg.func.name) + ": " + why);
+    };
+
+    std::vector<char> inLayout(cfg.blocks.size(), 0);
+    for (uint32_t b : cfg.layout) {
+        if (cfg.blocks[b].dead)
+            fail("deleted block still in layout");
+        inLayout[b] = 1;
+    }
+    auto present = [&](uint32_t b) { return b < inLayout.size() && inLayout[b]; };
+
+    std::unordered_map<uint32_t, uint32_t> defs;
+    std::unordered_set<uint32_t> used;
+    auto use = [&](const Operand& o) {
+        if (o.isTemp())
+            used.insert(o.id);
+    };
+
+    for (uint32_t b : cfg.layout) {
+        BasicBlock& blk = cfg.blocks[b];
+        if (!cfg.inSSA() && !blk.phis.empty())
+            fail("phi outside SSA form");
+        for (Phi& phi : blk.phis) {
+            if (phi.args.size() != blk.preds.size())
+                fail("phi argument count differs from predecessor count");
+            defs[phi.dst.id]++;
+            for (const Operand& a : phi.args)
+                use(a);
+        }
+        for (size_t i = 0; i < blk.code.size(); i++) {
+            IRInstruction& instr = blk.code[i];
+            if (instr.type == IRType::LABEL || instr.type == IRType::FUNC_BEGIN || instr.type == IRType::FUNC_END)
+                fail("label or function marker inside a block");
+            if (isTerminator(instr.type) && i + 1 != blk.code.size())
+                fail("terminator in the middle of a block");
+            if (isJump(instr.type) && !present(cfg.blockOfLabel(instr.result.id)))
+                fail("jump to missing label " + prog.labelName(instr.result.id));
+            if (Operand* d = defOf(instr))
+                if (d->isTemp())
+                    defs[d->id]++;
+            forEachUse(prog, instr, [&](Operand& o) { use(o); });
+        }
+        //  GOTO / RETURN βĿ鲻 fallthrough
+        const IRInstruction* term = blk.terminator();
+        bool falls = !term || (term->type != IRType::GOTO && term->type != IRType::RETURN);
+        if (falls && blk.fallthrough != CFG::NONE && !present(blk.fallthrough))
+            fail("fallthrough to missing block");
+        for (uint32_t s : blk.succs) {
+            const auto& preds = cfg.blocks[s].preds;
+            if (!present(s) || std::find(preds.begin(), preds.end(), b) == preds.end())
+                fail("successor and predecessor lists disagree");
+        }
+    }
+
+    for (auto& d : defs) {
+        if (d.first == 0 || d.first > prog.tempCount())
+            fail("bad temporary t" + std::to_string(d.first));
+        if (cfg.inSSA() && d.second > 1)
+            fail("t" + std::to_string(d.first) + " defined more than once in SSA form");
+    }
+    for (uint32_t t : used)
+        if (!defs.count(t))
+            fail("t" + std::to_string(t) + " used but never defined");
+}
+
+void verifyProgram(IRProgram& prog) {
+    const auto& code = prog.getInstructions();
+    const auto& funcs = prog.getFunctions();
+    size_t prevEnd = 0;
+    for (size_t k = 0; k < funcs.size(); k++) {
+        const IRFunction& f = funcs[k];
+        const std::string name = symName(f.name);
+        auto fail = [&](const std::string& why) {
+            throw std::runtime_error("invalid IR in " + name + ": " + why);
+        };
+        if (f.end >= code.size() || f.begin >= f.end || (k > 0 && f.begin <= prevEnd))
+            fail("function range out of order");
+        if (code[f.begin].type != IRType::FUNC_BEGIN || code[f.end].type != IRType::FUNC_END ||
+            code[f.begin].result.id != f.name)
+            fail("FUNC_BEGIN / FUNC_END do not match the function table");
+        prevEnd = f.end;
+
+        std::unordered_set<uint32_t> labels, defined, used;
+        for (uint32_t i = f.begin + 1; i < f.end; i++) {
+            const IRInstruction& instr = code[i];
+            if (instr.type == IRType::FUNC_BEGIN || instr.type == IRType::FUNC_END)
+                fail("nested function marker");
+            if (instr.type == IRType::LABEL && !labels.insert(instr.result.id).second)
+                fail("label " + prog.labelName(instr.result.id) + " defined twice");
+            IRInstruction copy = instr;
+            if (Operand* d = defOf(copy))
+                if (d->isTemp())
+                    defined.insert(d->id);
+            forEachUse(prog, copy, [&](Operand& o) {
+                if (o.isTemp())
+                    used.insert(o.id);
+            });
+        }
+        for (uint32_t i = f.begin + 1; i < f.end; i++)
+            if (isJump(code[i].type) && !labels.count(code[i].result.id))
+                fail("jump to missing label " + prog.labelName(code[i].result.id));
+        for (uint32_t t : used)
+            if (t == 0 || t > prog.tempCount() || !defined.count(t))
+                fail("t" + std::to_string(t) + " used but never defined");
+    }
+}
+
+// ---------- PassManager ----------
+
+void PassManager::addFunctionPass(const std::string& name, FunctionPass pass, const std::string& extraName) {
+    Entry e;
+    e.name = name;
+    e.function = std::move(pass);
+    e.extraName = extraName;
+    passes.push_back(std::move(e));
+}
+
+void PassManager::addModulePass(const std::string& name, ModulePass pass, const std::string& extraName) {
+    Entry e;
+    e.name = name;
+    e.module = std::move(pass);
+    e.extraName = extraName;
+    passes.push_back(std::move(e));
+}
+
+template<typename F>
+static void verifyAfter(const std::string& pass, F&& check) {
+    try {
+        check();
+    }
+    catch (const std::runtime_error& ex) {
+        throw std::runtime_error("after " + pass + ": " + ex.what());
+    }
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PassManager::run(IRProgram& prog) {
+    if (verify)
+        verifyAfter("IR generation", [&] { verifyProgram(prog); });
+    size_t i = 0;
+    while (i < passes.size()) {
+        if (!passes[i].module) {
+            size_t j = i;
+            while (j < passes.size() && !passes[j].module)
+                j++;
+            runFunctionPasses(prog, i, j);
+            i = j;
+            continue;
+        }
+        Entry& e = passes[i++];
+        size_t before = prog.getInstructions().size();
+        auto start = std::chrono::steady_clock::now();
+        e.add(e.module(prog));
+        e.seconds += secondsSince(start);
+        e.delta += (long long)prog.getInstructions().size() - (long long)before;
+        e.runs++;
+        if (verify)
+            verifyAfter(e.name, [&] { verifyProgram(prog); });
+    }
+}
+
+void PassManager::runFunctionPasses(IRProgram& prog, size_t first, size_t last) {
+    transformFunctions(prog, [&](CFG& cfg) {
+        for (size_t k = first; k < last; k++) {
+            Entry& e = passes[k];
+            long long before = (long long)cfg.instructionCount();
+            auto start = std::chrono::steady_clock::now();
+            e.add(e.function(cfg));
+            e.seconds += secondsSince(start);
+            e.delta += (long long)cfg.instructionCount() - before;
+            e.runs++;
+            if (verify)
+                verifyAfter(e.name, [&] { verifyFunction(cfg); });
+        }
+    });
+    if (verify)
+        verifyAfter(passes[last - 1].name + " (linearized)", [&] { verifyProgram(prog); });
+}
+
+void PassManager::printStats(std::ostream& os) const {
+    os << std::left << std::setw(16) << "pass" << std::right
+        << std::setw(6) << "runs" << std::setw(12) << "time(ms)"
+        << std::setw(10) << "instrs" << std::setw(10) << "changes" << "\n";
+    double total = 0;
+    long long delta = 0;
+    for (const Entry& e : passes) {
+        os << std::left << std::setw(16) << e.name << std::right
+            << std::setw(6) << e.runs
+            << std::setw(12) << std::fixed << std::setprecision(3) << e.seconds * 1000
+            << std::setw(10) << std::showpos << e.delta << std::noshowpos
+            << std::setw(10) << e.changes;
+        if (!e.extraName.empty())
+            os << "  " << e.extra << " " << e.extraName;
+        os << "\n";
+        total += e.seconds;
+        delta += e.delta;
+    }
+    os << std::left << std::setw(16) << "total" << std::right << std::setw(6) << ""
+        << std::setw(12) << std::fixed << std::setprecision(3) << total * 1000
+        << std::setw(10) << std::showpos << delta << std::noshowpos << "\n";
+}
+
+// ---------- ˮ ----------
+
+void buildPipeline(PassManager& pm, int level) {
+    if (level <= 0)
+        return;
+    if (level >= 2) {
+        // βݹȸĳѭʣµĵ
+        pm.addFunctionPass("tail-calls", [](CFG& cfg) { return eliminateTailCalls(cfg); });
+        pm.addModulePass("inline", [](IRProgram& prog) { return inlineFunctions(prog).inlined; });
+    }
+    pm.addFunctionPass("sccp", [](CFG& cfg) {
+        SCCPStats s = propagateConstants(cfg);
+        return s.folded + s.branches;
+    });
+    if (level >= 2)
+        pm.addFunctionPass("value-numbering", [](CFG& cfg) { return numberValues(cfg).expressions; });
+    pm.addFunctionPass("copy-prop", [](CFG& cfg) { return propagateCopies(cfg).propagated; });
+    if (level >= 2) {
+        pm.addFunctionPass("loops", [](CFG& cfg) {
+            LoopStats s = optimizeLoops(cfg);
+            return s.hoisted + s.reduced;
+        });
+        pm.addFunctionPass("copy-prop", [](CFG& cfg) { return propagateCopies(cfg).propagated; });
+    }
+    pm.addFunctionPass("coalesce", [](CFG& cfg) { return coalesceTemps(cfg).coalesced; });
+    pm.addFunctionPass("dce", [](CFG& cfg) {
+        DCEStats s = eliminateDeadCode(cfg);
+        return PassResult(s.instructions, s.temps);
+    }, "temps removed");
+}
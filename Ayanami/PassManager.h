@@ -0,0 +1,77 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CFG.h"
+
+/*
+* IR 
+* 壺 pass ֮ IR ǷȻϷϷʱ׳ std::runtime_error
+* ݣ
+*	תĿڡսָֻڿβǰһ¡phi ǰ
+*	ʱЧںж壬SSA ʽֻһ
+*	FUNC_BEGIN / FUNC_END 뺯һ
+*/
+void verifyFunction(CFG& cfg);
+void verifyProgram(IRProgram& prog);
+
+/*
+* pass 
+* 壺˳һ IR pass
+* ã
+*	ĺ pass ϲһ transformFunctions У
+*	¼ÿ pass ĺʱָ仯Ķѡÿ pass ֮ IR
+* ˵
+*	pass رεĸĶ۵ɾչĸȣֻͳƣ
+*	ҪʱٴһӼ DCE ɾʱǼ pass ʱ
+*/
+struct PassResult {
+    size_t changes = 0;
+    size_t extra = 0;           // ӼǼʱûиֵ pass 
+
+    PassResult(size_t changes = 0, size_t extra = 0) :changes(changes), extra(extra) {}
+};
+
+class PassManager {
+public:
+    using FunctionPass = std::function<PassResult(CFG&)>;
+    using ModulePass = std::function<PassResult(IRProgram&)>;
+
+    bool verify = false;
+
+    void addFunctionPass(const std::string& name, FunctionPass pass, const std::string& extraName = "");
+    void addModulePass(const std::string& name, ModulePass pass, const std::string& extraName = "");
+
+    void run(IRProgram& prog);
+
+    // ÿ pass һУдʱָ仯ĶиӼٸ
+    void printStats(std::ostream& os) const;
+
+    bool empty() const { return passes.empty(); }
+
+private:
+    struct Entry {
+        std::string name;
+        FunctionPass function;
+        ModulePass module;
+
+        size_t runs = 0;
+        double seconds = 0;
+        long long delta = 0;        // ָ仯ʾ
+        size_t changes = 0;
+        std::string extraName;
+        size_t extra = 0;
+
+        void add(const PassResult& r) {
+            changes += r.changes;
+            extra += r.extra;
+        }
+    };
+    std::vector<Entry> passes;
+
+    void runFunctionPasses(IRProgram& prog, size_t first, size_t last);
+};
+
+// Żˮߣ0 Ż1 Ż2 ټβݹֵѭŻ
+void buildPipeline(PassManager& pm, int level);
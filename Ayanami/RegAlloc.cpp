@@ -0,0 +1,658 @@
+#include "RegAlloc.h"
+#include "BitSet.h"
+#include "CFG.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_set>
+
+namespace {
+
+constexpr uint32_t NO_POS = UINT32_MAX;
+constexpr uint32_t NO_VALUE = UINT32_MAX;
+
+struct Range {
+    uint32_t from, to;          // [from, to)
+};
+
+/*
+* Ծ
+* ֺÿһһ Interval[spanFrom, spanTo) Ϊһθλãͬһֵĸβӣ
+* ̶䣨value Ϊ NO_VALUEʾôƻļĴloc һʼȷ
+*/
+struct Interval {
+    uint32_t value = NO_VALUE;
+    RegClass cls = RegClass::INT;
+    std::vector<Range> ranges;          // Ҳཻ
+    std::vector<uint32_t> uses;         // дλã
+    uint32_t spanFrom = 0, spanTo = 0;
+    Location loc;
+
+    bool fixed() const { return value == NO_VALUE; }
+    uint32_t start() const { return ranges.front().from; }
+    uint32_t end() const { return ranges.back().to; }
+
+    bool covers(uint32_t pos) const {
+        for (const Range& r : ranges) {
+            if (pos < r.from)
+                return false;
+            if (pos < r.to)
+                return true;
+        }
+        return false;
+    }
+
+    // pos ֮ĵһʹλ
+    uint32_t nextUse(uint32_t pos) const {
+        auto it = std::lower_bound(uses.begin(), uses.end(), pos);
+        return it == uses.end() ? NO_POS : *it;
+    }
+
+    // 䶼Ծĵһλ
+    uint32_t intersect(const Interval& o) const {
+        size_t i = 0, j = 0;
+        while (i < ranges.size() && j < o.ranges.size()) {
+            const Range& a = ranges[i];
+            const Range& b = o.ranges[j];
+            uint32_t lo = std::max(a.from, b.from);
+            if (lo < std::min(a.to, b.to))
+                return lo;
+            if (a.to <= b.to)
+                i++;
+            else
+                j++;
+        }
+        return NO_POS;
+    }
+};
+
+// ʱӺǰΣranges ʱţһĿǰһ
+void prependRange(Interval& it, uint32_t from, uint32_t to) {
+    if (!it.ranges.empty() && it.ranges.back().from <= to) {
+        it.ranges.back().from = std::min(it.ranges.back().from, from);
+        it.ranges.back().to = std::max(it.ranges.back().to, to);
+    }
+    else
+        it.ranges.push_back({ from, to });
+}
+
+struct Block {
+    uint32_t first, last;               // Ժͷָ
+    uint32_t taken = NO_POS;            // תĿ
+    uint32_t fall = NO_POS;             // ˳ִеĿ
+};
+
+uint32_t floor4(uint32_t pos) {
+    return pos & ~3u;
+}
+
+}
+
+/*
+* һɨ
+* 裺л -> 鼶Ծ ->  -> ɨ -> ֵƶ
+*/
+class LinearScan {
+public:
+    LinearScan(IRProgram& prog, const IRFunction& fn, const RegisterFile& target,
+        const std::function<RegClass(const Operand&)>& classOf, RegAllocation& result)
+        :prog(prog), fn(fn), target(target), classOf(classOf), result(result) {
+    }
+
+    void run() {
+        result.base = fn.begin + 1;
+        const auto& all = prog.getInstructions();
+        code.assign(all.begin() + fn.begin + 1, all.begin() + fn.end);
+        if (code.empty())
+            return;
+        collectValues();
+        buildBlocks();
+        solveLiveness();
+        buildIntervals();
+        scan();
+        resolve();
+    }
+
+private:
+    IRProgram& prog;
+    const IRFunction& fn;
+    const RegisterFile& target;
+    const std::function<RegClass(const Operand&)>& classOf;
+    RegAllocation& result;
+
+    std::vector<IRInstruction> code;
+    std::unordered_map<uint64_t, uint32_t> index;       // operandKey -> ֵ
+    std::vector<uint64_t> keys;
+    std::vector<RegClass> classes;
+    std::unordered_set<uint64_t> pinned;                // ʼջеֵ
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> blockOf;                      // ָ -> 
+    std::vector<char> blockStart;
+    std::vector<BitSet> liveIn, liveOut;
+
+    std::vector<Interval> intervals;                    // ǰ keys.size() Ϊֵĳʼ
+    std::vector<std::vector<uint32_t>> children;        // ֵ -> 
+    std::priority_queue<std::pair<uint32_t, uint32_t>, std::vector<std::pair<uint32_t, uint32_t>>,
+        std::greater<>> unhandled;                      // (, )
+    std::vector<uint32_t> active, inactive;
+
+    // ---------- ֵ ----------
+
+    void collectValues() {
+        for (const Param& p : fn.params)
+            if (p.isRef)
+                pinned.insert(operandKey(Operand::var(p.name)));
+        for (IRInstruction& instr : code)
+            if (instr.type == IRType::CALL) {
+                const Operand* a = prog.args(instr);
+                for (uint32_t k = 0; k < instr.argCount; k++)
+                    if (isRefArg(a[k]) && a[k].isLocation())
+                        pinned.insert(operandKey(a[k]));
+            }
+
+        auto add = [&](const Operand& o) {
+            uint64_t key = operandKey(o);
+            if (pinned.count(key) || index.count(key))
+                return;
+            index.emplace(key, (uint32_t)keys.size());
+            keys.push_back(key);
+            classes.push_back(classOf(o));
+        };
+        for (const Param& p : fn.params)
+            add(Operand::var(p.name));
+        for (IRInstruction& instr : code) {
+            forEachUse(prog, instr, [&](Operand& o) { add(o); });
+            if (Operand* d = defOf(instr))
+                add(*d);
+        }
+        result.values = keys.size();
+    }
+
+    // ˵һ£ÿ LABEL ÿսָ֮ʼ¿
+    void buildBlocks() {
+        uint32_t n = (uint32_t)code.size();
+        blockOf.assign(n, 0);
+        blockStart.assign(n, 0);
+        std::unordered_map<uint32_t, uint32_t> labelBlock;
+        for (uint32_t k = 0; k < n; k++) {
+            bool starts = k == 0 || code[k].type == IRType::LABEL || isTerminator(code[k - 1].type);
+            if (starts) {
+                if (!blocks.empty() && !isTerminator(code[k - 1].type))
+                    blocks.back().fall = (uint32_t)blocks.size();
+                blocks.push_back({ k, k });
+                blockStart[k] = 1;
+            }
+            blocks.back().last = k;
+            blockOf[k] = (uint32_t)blocks.size() - 1;
+            if (code[k].type == IRType::LABEL)
+                labelBlock[code[k].result.id] = (uint32_t)blocks.size() - 1;
+        }
+        for (Block& b : blocks) {
+            const IRInstruction& t = code[b.last];
+            if (t.type == IRType::IF_TRUE_GOTO || t.type == IRType::IF_FALSE_GOTO)
+                b.fall = b.last + 1 < n ? blockOf[b.last + 1] : NO_POS;
+            if (isTerminator(t.type) && t.type != IRType::RETURN) {
+                auto it = labelBlock.find(t.result.id);
+                b.taken = it == labelBlock.end() ? NO_POS : it->second;
+            }
+        }
+    }
+
+    template<typename F>
+    void forEachValueUse(IRInstruction& instr, F&& f) {
+        forEachUse(prog, instr, [&](Operand& o) {
+            auto it = index.find(operandKey(o));
+            if (it != index.end())
+                f(it->second);
+        });
+    }
+
+    uint32_t valueDef(IRInstruction& instr) {
+        if (Operand* d = defOf(instr)) {
+            auto it = index.find(operandKey(*d));
+            if (it != index.end())
+                return it->second;
+        }
+        return NO_VALUE;
+    }
+
+    void solveLiveness() {
+        size_t n = blocks.size(), m = keys.size();
+        std::vector<BitSet> gen(n, BitSet(m)), kill(n, BitSet(m));
+        for (size_t b = 0; b < n; b++)
+            for (uint32_t k = blocks[b].first; k <= blocks[b].last; k++) {
+                forEachValueUse(code[k], [&](uint32_t v) {
+                    if (!kill[b].test(v))
+                        gen[b].set(v);
+                });
+                uint32_t d = valueDef(code[k]);
+                if (d != NO_VALUE)
+                    kill[b].set(d);
+            }
+
+        liveIn.assign(n, BitSet(m));
+        liveOut.assign(n, BitSet(m));
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t b = n; b-- > 0;) {
+                BitSet out(m);
+                if (blocks[b].taken != NO_POS)
+                    out.merge(liveIn[blocks[b].taken]);
+                if (blocks[b].fall != NO_POS)
+                    out.merge(liveIn[blocks[b].fall]);
+                BitSet in = out;
+                in.transfer(gen[b], kill[b]);
+                liveOut[b] = std::move(out);
+                if (!(in == liveIn[b])) {
+                    liveIn[b] = std::move(in);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // ----------  ----------
+
+    void buildIntervals() {
+        size_t m = keys.size();
+        intervals.resize(m);
+        children.resize(m);
+        for (uint32_t v = 0; v < m; v++) {
+            intervals[v].value = v;
+            intervals[v].cls = classes[v];
+            children[v].push_back(v);
+        }
+        std::vector<Interval> fixed[2];
+        for (int c = 0; c < 2; c++)
+            for (const RegisterFile::Register& r : target.regs[c])
+                if (r.callerSaved) {
+                    fixed[c].emplace_back();
+                    fixed[c].back().cls = (RegClass)c;
+                    fixed[c].back().loc = Location::inReg(r.id);
+                }
+
+        for (size_t b = blocks.size(); b-- > 0;) {
+            uint32_t from = 4 * blocks[b].first, to = 4 * (blocks[b].last + 1);
+            liveOut[b].forEach([&](uint32_t v) { prependRange(intervals[v], from, to); });
+            for (uint32_t k = blocks[b].last + 1; k-- > blocks[b].first;) {
+                IRInstruction& instr = code[k];
+                uint32_t d = valueDef(instr);
+                if (d != NO_VALUE) {
+                    Interval& it = intervals[d];
+                    if (!it.ranges.empty() && it.ranges.back().from <= 4 * k + 2)
+                        it.ranges.back().from = 4 * k + 2;
+                    else
+                        it.ranges.push_back({ 4 * k + 2, 4 * k + 3 });
+                    it.uses.push_back(4 * k + 2);
+                }
+                if (target.clobbers && target.clobbers(instr))
+                    for (int c = 0; c < 2; c++)
+                        for (Interval& f : fixed[c])
+                            prependRange(f, 4 * k + 1, 4 * k + 2);
+                forEachValueUse(instr, [&](uint32_t v) {
+                    prependRange(intervals[v], from, 4 * k + 1);
+                    if (intervals[v].uses.empty() || intervals[v].uses.back() != 4 * k)
+                        intervals[v].uses.push_back(4 * k);
+                });
+            }
+        }
+
+        for (Interval& it : intervals) {
+            std::reverse(it.ranges.begin(), it.ranges.end());
+            std::reverse(it.uses.begin(), it.uses.end());
+            it.spanFrom = 0;
+            it.spanTo = 4 * (uint32_t)code.size();
+        }
+        for (uint32_t v = 0; v < m; v++)
+            if (!intervals[v].ranges.empty())
+                unhandled.push({ intervals[v].start(), v });
+        for (int c = 0; c < 2; c++)
+            for (Interval& f : fixed[c])
+                if (!f.ranges.empty()) {
+                    std::reverse(f.ranges.begin(), f.ranges.end());
+                    inactive.push_back((uint32_t)intervals.size());
+                    intervals.push_back(std::move(f));
+                }
+    }
+
+    //  pos4 ıڲ𿪣غһ
+    uint32_t split(uint32_t idx, uint32_t pos) {
+        Interval child;
+        {
+            Interval& it = intervals[idx];
+            child.value = it.value;
+            child.cls = it.cls;
+            std::vector<Range> keep;
+            for (const Range& r : it.ranges) {
+                if (r.to <= pos)
+                    keep.push_back(r);
+                else if (r.from >= pos)
+                    child.ranges.push_back(r);
+                else {
+                    keep.push_back({ r.from, pos });
+                    child.ranges.push_back({ pos, r.to });
+                }
+            }
+            it.ranges = std::move(keep);
+            auto mid = std::lower_bound(it.uses.begin(), it.uses.end(), pos);
+            child.uses.assign(mid, it.uses.end());
+            it.uses.erase(mid, it.uses.end());
+            child.spanFrom = pos;
+            child.spanTo = it.spanTo;
+            it.spanTo = pos;
+        }
+        uint32_t c = (uint32_t)intervals.size();
+        children[child.value].push_back(c);
+        intervals.push_back(std::move(child));
+        result.splits++;
+        return c;
+    }
+
+    // һ afterǰʹλãزֵ
+    static uint32_t reloadPoint(const Interval& it, uint32_t after) {
+        for (uint32_t u : it.uses) {
+            uint32_t p = floor4(u);
+            if (p > after && p > it.start())
+                return p;
+        }
+        return NO_POS;
+    }
+
+    // ŵջϣһʹǰ𿪣һ²
+    void spill(uint32_t idx, uint32_t pos) {
+        intervals[idx].loc = Location();
+        uint32_t p = reloadPoint(intervals[idx], pos);
+        if (p != NO_POS) {
+            uint32_t c = split(idx, p);
+            unhandled.push({ intervals[c].start(), c });
+        }
+    }
+
+    /*
+    * ռżĴ idx  p ó
+    * ѾɨĲֲ·䣬ֻܷջϣջǿãθĵջҲǰȫ
+    */
+    void evict(uint32_t idx, uint32_t p, uint32_t pos) {
+        uint32_t c = p > intervals[idx].start() ? split(idx, p) : idx;
+        if (c == idx)
+            intervals[idx].loc = Location();
+        if (intervals[c].start() > pos)
+            unhandled.push({ intervals[c].start(), c });
+        else
+            spill(c, pos);
+    }
+
+    size_t regIndex(RegClass c, uint8_t reg) const {
+        const auto& regs = target.regs[(int)c];
+        for (size_t i = 0; i < regs.size(); i++)
+            if (regs[i].id == reg)
+                return i;
+        return regs.size();
+    }
+
+    bool tryAllocateFree(uint32_t cur) {
+        Interval& it = intervals[cur];
+        const auto& regs = target.regs[(int)it.cls];
+        std::vector<uint32_t> freeUntil(regs.size() + 1, NO_POS);
+        for (uint32_t a : active)
+            if (intervals[a].cls == it.cls)
+                freeUntil[regIndex(it.cls, intervals[a].loc.reg)] = 0;
+        for (uint32_t a : inactive)
+            if (intervals[a].cls == it.cls) {
+                uint32_t p = intervals[a].intersect(it);
+                size_t r = regIndex(it.cls, intervals[a].loc.reg);
+                freeUntil[r] = std::min(freeUntil[r], p);
+            }
+
+        size_t best = regs.size();
+        for (size_t r = 0; r < regs.size(); r++)
+            if (best == regs.size() || freeUntil[r] > freeUntil[best])
+                best = r;
+        if (best == regs.size() || freeUntil[best] <= it.start())
+            return false;
+        if (freeUntil[best] < it.end()) {
+            uint32_t p = floor4(freeUntil[best]);
+            if (p <= it.start())
+                return false;
+            uint32_t c = split(cur, p);
+            unhandled.push({ intervals[c].start(), c });
+        }
+        intervals[cur].loc = Location::inReg(regs[best].id);
+        return true;
+    }
+
+    /*
+    * ûпмĴȽϸĴһʹõλ
+    * cur ĵһʹñмĴ curռһʹԶļĴ
+    */
+    void allocateBlocked(uint32_t cur) {
+        RegClass cls = intervals[cur].cls;
+        uint32_t pos = intervals[cur].start();
+        const auto& regs = target.regs[(int)cls];
+        std::vector<uint32_t> nextUse(regs.size() + 1, NO_POS), blockPos(regs.size() + 1, NO_POS);
+        auto consider = [&](uint32_t a, bool isActive) {
+            const Interval& o = intervals[a];
+            if (o.cls != cls)
+                return;
+            size_t r = regIndex(cls, o.loc.reg);
+            if (o.fixed()) {
+                uint32_t p = o.intersect(intervals[cur]);
+                blockPos[r] = std::min(blockPos[r], p);
+                nextUse[r] = std::min(nextUse[r], p);
+            }
+            else if (isActive || o.intersect(intervals[cur]) != NO_POS)
+                nextUse[r] = std::min(nextUse[r], o.nextUse(pos));
+        };
+        for (uint32_t a : active)
+            consider(a, true);
+        for (uint32_t a : inactive)
+            consider(a, false);
+
+        size_t best = regs.size();
+        for (size_t r = 0; r < regs.size(); r++)
+            if (best == regs.size() || nextUse[r] > nextUse[best])
+                best = r;
+        uint32_t first = intervals[cur].nextUse(pos);
+        if (best == regs.size() || first == NO_POS || first > nextUse[best] ||
+            (blockPos[best] < intervals[cur].end() && floor4(blockPos[best]) <= pos)) {
+            spill(cur, pos);
+            return;
+        }
+
+        uint8_t reg = regs[best].id;
+        if (blockPos[best] < intervals[cur].end()) {
+            uint32_t c = split(cur, floor4(blockPos[best]));
+            unhandled.push({ intervals[c].start(), c });
+        }
+        intervals[cur].loc = Location::inReg(reg);
+
+        auto holds = [&](uint32_t a) {
+            const Interval& o = intervals[a];
+            return !o.fixed() && o.cls == cls && o.loc.kind == Location::REG && o.loc.reg == reg;
+        };
+        for (size_t i = 0; i < active.size();)
+            if (holds(active[i])) {
+                evict(active[i], floor4(pos), pos);
+                active.erase(active.begin() + i);
+            }
+            else
+                i++;
+        // Ծཻ𿪣ǰһռżĴ inactive 
+        for (size_t i = 0; i < inactive.size();) {
+            uint32_t p = holds(inactive[i]) ? intervals[inactive[i]].intersect(intervals[cur]) : NO_POS;
+            if (p != NO_POS)
+                evict(inactive[i], floor4(p), pos);
+            if (intervals[inactive[i]].loc.kind != Location::REG)
+                inactive.erase(inactive.begin() + i);
+            else
+                i++;
+        }
+    }
+
+    void scan() {
+        while (!unhandled.empty()) {
+            uint32_t cur = unhandled.top().second;
+            unhandled.pop();
+            uint32_t pos = intervals[cur].start();
+
+            std::vector<uint32_t> nextActive, nextInactive;
+            for (uint32_t a : active) {
+                if (intervals[a].end() <= pos)
+                    continue;
+                (intervals[a].covers(pos) ? nextActive : nextInactive).push_back(a);
+            }
+            for (uint32_t a : inactive) {
+                if (intervals[a].end() <= pos)
+                    continue;
+                (intervals[a].covers(pos) ? nextActive : nextInactive).push_back(a);
+            }
+            active = std::move(nextActive);
+            inactive = std::move(nextInactive);
+
+            if (!tryAllocateFree(cur))
+                allocateBlocked(cur);
+            if (intervals[cur].loc.kind == Location::REG)
+                active.push_back(cur);
+        }
+    }
+
+    // ---------- ƶ ----------
+
+    Location locationAt(uint32_t v, uint32_t pos) const {
+        for (uint32_t c : children[v])
+            if (intervals[c].spanFrom <= pos && pos < intervals[c].spanTo)
+                return intervals[c].loc;
+        return Location();
+    }
+
+    /*
+    * ͬʱƶųȺ˳Ŀ겻ٱƶȡ
+    * ʣµĶڼĴ֮ɻһԴĴȰᵽ scratch ƻ
+    */
+    void sequentialize(std::vector<Move>& moves) const {
+        std::vector<Move> pending, ordered;
+        for (const Move& m : moves)
+            if (m.from != m.to)
+                pending.push_back(m);
+        while (!pending.empty()) {
+            bool progress = false;
+            for (size_t i = 0; i < pending.size(); i++) {
+                const Move& m = pending[i];
+                bool blocked = m.to.kind == Location::REG && std::any_of(pending.begin(), pending.end(),
+                    [&](const Move& o) { return &o != &m && o.from == m.to && o.from.kind == Location::REG; });
+                if (!blocked) {
+                    ordered.push_back(m);
+                    pending.erase(pending.begin() + i);
+                    progress = true;
+                    break;
+                }
+            }
+            if (progress)
+                continue;
+            Move& m = pending.front();
+            Location tmp = Location::inReg(target.scratch[(int)m.cls]);
+            Location src = m.from;
+            ordered.push_back({ m.value, m.cls, src, tmp });
+            for (Move& o : pending)
+                if (o.from == src && o.cls == m.cls)
+                    o.from = tmp;
+        }
+        moves = std::move(ordered);
+    }
+
+    void addMove(std::vector<Move>& list, uint32_t v, Location from, Location to) {
+        if (from != to)
+            list.push_back({ keys[v], classes[v], from, to });
+    }
+
+    void resolve() {
+        // ελ
+        for (uint32_t v = 0; v < keys.size(); v++) {
+            auto& segs = result.segments[keys[v]];
+            std::sort(children[v].begin(), children[v].end(),
+                [&](uint32_t a, uint32_t b) { return intervals[a].spanFrom < intervals[b].spanFrom; });
+            for (uint32_t c : children[v]) {
+                const Interval& it = intervals[c];
+                if (it.loc.kind == Location::STACK && !it.uses.empty())
+                    result.spilled++;
+                if (it.loc.kind == Location::REG) {
+                    auto& used = result.used[(int)it.cls];
+                    if (std::find(used.begin(), used.end(), it.loc.reg) == used.end())
+                        used.push_back(it.loc.reg);
+                }
+                if (!segs.empty() && segs.back().loc == it.loc)
+                    segs.back().to = it.spanTo;
+                else
+                    segs.push_back({ it.spanFrom, it.spanTo, it.loc });
+            }
+        }
+
+        liveIn[0].forEach([&](uint32_t v) { result.entryLive.insert(keys[v]); });
+
+        // ڵĲֵ㣺ֵڲֵȻԾʱҪƶ鿪ͷĲֵɿߴ
+        for (uint32_t v = 0; v < keys.size(); v++)
+            for (uint32_t c : children[v]) {
+                const Interval& it = intervals[c];
+                uint32_t p = it.spanFrom;
+                if (p == 0 || blockStart[p / 4] || !it.covers(p))
+                    continue;
+                addMove(result.before[result.base + p / 4], v, locationAt(v, p - 1), it.loc);
+            }
+
+        // ߣڻԾֵλòͬʱƶ
+        for (const Block& b : blocks) {
+            uint32_t out = 4 * b.last + 3;
+            auto edge = [&](uint32_t s, std::vector<Move>& list) {
+                uint32_t in = 4 * blocks[s].first;
+                liveIn[s].forEach([&](uint32_t v) { addMove(list, v, locationAt(v, out), locationAt(v, in)); });
+            };
+            if (b.taken != NO_POS)
+                edge(b.taken, result.takenExit[result.base + b.last]);
+            if (b.fall != NO_POS)
+                edge(b.fall, result.fallExit[result.base + b.last]);
+        }
+
+        for (auto* table : { &result.before, &result.takenExit, &result.fallExit })
+            for (auto& entry : *table)
+                sequentialize(entry.second);
+    }
+};
+
+Location RegAllocation::at(const Operand& o, uint32_t i) const {
+    auto it = segments.find(operandKey(o));
+    if (it == segments.end() || i < base)
+        return Location();
+    uint32_t pos = 4 * (i - base);
+    const auto& segs = it->second;
+    auto s = std::upper_bound(segs.begin(), segs.end(), pos,
+        [](uint32_t p, const Segment& seg) { return p < seg.from; });
+    if (s == segs.begin())
+        return Location();
+    --s;
+    return pos < s->to ? s->loc : Location();
+}
+
+Location RegAllocation::atEntry(const Operand& o) const {
+    return entryLive.count(operandKey(o)) ? at(o, base) : Location();
+}
+
+const std::vector<Move>& RegAllocation::movesBefore(uint32_t i) const {
+    static const std::vector<Move> none;
+    auto it = before.find(i);
+    return it == before.end() ? none : it->second;
+}
+
+const std::vector<Move>& RegAllocation::movesOnExit(uint32_t i, bool taken) const {
+    static const std::vector<Move> none;
+    const auto& table = taken ? takenExit : fallExit;
+    auto it = table.find(i);
+    return it == table.end() ? none : it->second;
+}
+
+RegAllocation allocateRegisters(IRProgram& prog, const IRFunction& fn, const RegisterFile& target,
+    const std::function<RegClass(const Operand&)>& classOf) {
+    RegAllocation result;
+    LinearScan(prog, fn, target, classOf, result).run();
+    return result;
+}
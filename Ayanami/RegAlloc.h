@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include "IR.h"
+
+enum class RegClass : uint8_t { INT, FLOAT };
+
+// ֵĳһʱ̵λãĴֵԼջۣλɺ˰ţ
+struct Location {
+    enum Kind : uint8_t { STACK, REG };
+    Kind kind = STACK;
+    uint8_t reg = 0;
+
+    static Location inReg(uint8_t r) { return { REG, r }; }
+    bool operator==(const Location& o) const { return kind == o.kind && (kind == STACK || reg == o.reg); }
+    bool operator!=(const Location& o) const { return !(*this == o); }
+};
+
+/*
+* ĿļĴ
+* regs ʱ˳Уscratch 䣬ֻڲƶɻʱ
+* clobbers жһָǷƻ callerSaved ļĴáʱã
+*/
+struct RegisterFile {
+    struct Register {
+        uint8_t id;
+        bool callerSaved;
+    };
+    std::vector<Register> regs[2];          // ±Ϊ RegClass
+    uint8_t scratch[2] = { 0, 0 };
+    std::function<bool(const IRInstruction&)> clobbers;
+};
+
+// һƶvalue  from ᵽ toSTACK ָ value ջ
+struct Move {
+    uint64_t value;                         // operandKey
+    RegClass cls;
+    Location from, to;
+};
+
+/*
+* һķ
+* ָ IRProgram еľ±
+* movesBefore(i) ָ i ֮ǰִУmovesOnExit(i, taken) ָ i βĻ뿪ʱִУ
+* taken Ϊת뿪Ϊ˳ִеһ飻ƶźȺִм
+*/
+class RegAllocation {
+public:
+    Location at(const Operand& o, uint32_t i) const;
+    // ڴλãڴԾֵΪ STACK˾ݴװβΣ
+    Location atEntry(const Operand& o) const;
+    const std::vector<Move>& movesBefore(uint32_t i) const;
+    const std::vector<Move>& movesOnExit(uint32_t i, bool taken) const;
+
+    // ֵļĴ˾ݴ˱汻߱ļĴ
+    const std::vector<uint8_t>& usedRegisters(RegClass c) const { return used[(int)c]; }
+
+    size_t values = 0;          // ֵ
+    size_t splits = 0;          // ִ
+    size_t spilled = 0;         // ջϵ
+
+private:
+    friend class LinearScan;
+
+    struct Segment {
+        uint32_t from, to;      // Ժͷλ [from, to)
+        Location loc;
+    };
+    uint32_t base = 0;          // һָ±
+    std::unordered_map<uint64_t, std::vector<Segment>> segments;
+    std::unordered_map<uint32_t, std::vector<Move>> before, takenExit, fallExit;
+    std::unordered_set<uint64_t> entryLive;
+    std::vector<uint8_t> used[2];
+};
+
+/*
+* ɨĴ
+* 壺 IR ÿ TEMP / VAR ĻԾ䣬˳ target ļĴ޹
+* Լ
+*	ڵ k ָռλ 4k..4k+34k 4k+1 ƻĴ4k+2 д
+*	ĿÿָֱʹջеֵֻӰٶȣûмĴξջ
+*	ĴʱһʹԶ𿪣µĲȷջϣһʹǰ²
+*	õ䲻ֵ callerSaved ļĴڵô𿪺󣬵ǰĲԿɸüĴ
+*	ref ʵδֵַ ref ββ䣬ʼջ
+* classOf ֵļĴ
+*/
+RegAllocation allocateRegisters(IRProgram& prog, const IRFunction& fn, const RegisterFile& target,
+    const std::function<RegClass(const Operand&)>& classOf);
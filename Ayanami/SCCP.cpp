@@ -0,0 +1,426 @@
+#include "Optimizer.h"
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+static bool isTruthy(const Operand& v) {
+    return v.kind == OperandKind::FLOAT ? v.f != 0.0 : v.i != 0;
+}
+
+static double asDouble(const Operand& v) {
+    return v.kind == OperandKind::FLOAT ? v.f : (double)v.i;
+}
+
+bool coerceConstant(const Operand& value, TokenType type, Operand& out) {
+    if (!value.isImm())
+        return false;
+    bool isFloat = value.kind == OperandKind::FLOAT;
+    switch (type) {
+    case TokenType::INT:
+        if (isFloat) {
+            if (!(std::fabs(value.f) < 2147483648.0))
+                return false;
+            out = Operand::imm((int32_t)value.f);
+        }
+        else
+            out = Operand::imm((int32_t)value.i);
+        return true;
+    case TokenType::CHAR:
+        if (isFloat) {
+            if (!(std::fabs(value.f) < 128.0))
+                return false;
+            out = Operand::immChar((int8_t)value.f);
+        }
+        else
+            out = Operand::immChar(value.kind == OperandKind::CHAR && value.i >= 0 && value.i < 128 ?
+                value.i : (int8_t)value.i);
+        return true;
+    case TokenType::BOOL:
+        out = Operand::imm(isTruthy(value) ? 1 : 0);
+        return true;
+    case TokenType::FLOAT:
+        out = Operand::immFloat(asDouble(value));
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool foldBinary(IRType op, const Operand& a, const Operand& b, TokenType type, Operand& out) {
+    if (!a.isImm() || !b.isImm())
+        return false;
+    bool isFloat = a.kind == OperandKind::FLOAT || b.kind == OperandKind::FLOAT;
+    Operand r;
+    switch (op) {
+    case IRType::LESS:
+    case IRType::GREATER:
+    case IRType::EQUAL_EQUAL:
+    case IRType::NOT_EQUAL: {
+        int cmp;
+        if (isFloat) {
+            double x = asDouble(a), y = asDouble(b);
+            cmp = x < y ? -1 : (x > y ? 1 : 0);
+        }
+        else
+            cmp = a.i < b.i ? -1 : (a.i > b.i ? 1 : 0);
+        bool v = op == IRType::LESS ? cmp < 0 :
+            op == IRType::GREATER ? cmp > 0 :
+            op == IRType::EQUAL_EQUAL ? cmp == 0 : cmp != 0;
+        r = Operand::imm(v ? 1 : 0);
+        break;
+    }
+    case IRType::AND:
+        r = Operand::imm(isTruthy(a) && isTruthy(b) ? 1 : 0);
+        break;
+    case IRType::OR:
+        r = Operand::imm(isTruthy(a) || isTruthy(b) ? 1 : 0);
+        break;
+    case IRType::ADD:
+    case IRType::SUB:
+    case IRType::MUL:
+    case IRType::DIV:
+        if (isFloat) {
+            double x = asDouble(a), y = asDouble(b), v;
+            if (op == IRType::ADD) v = x + y;
+            else if (op == IRType::SUB) v = x - y;
+            else if (op == IRType::MUL) v = x * y;
+            else v = x / y;
+            if (!std::isfinite(v))
+                return false;
+            r = Operand::immFloat(v);
+        }
+        else {
+            // ɵ C++  int 㣨char Ϊ int
+            int64_t x = (int32_t)a.i, y = (int32_t)b.i, v;
+            if (op == IRType::ADD) v = x + y;
+            else if (op == IRType::SUB) v = x - y;
+            else if (op == IRType::MUL) v = x * y;
+            else {
+                if (y == 0 || (x == INT32_MIN && y == -1))
+                    return false;
+                v = x / y;
+            }
+            if (v < INT32_MIN || v > INT32_MAX)
+                return false;   // з C++ δ壬ʱ
+            r = Operand::imm(v);
+        }
+        break;
+    default:
+        return false;
+    }
+    return coerceConstant(r, type, out);
+}
+
+namespace {
+
+struct LatticeValue {
+    enum State { TOP, CONST, BOTTOM } state = TOP;
+    Operand value;
+};
+
+// ĳ SSA ֵһʹ
+struct UseSite {
+    uint32_t block;
+    bool phi;
+    uint32_t index;
+};
+
+class SCCP {
+public:
+    SCCP(CFG& cfg) :cfg(cfg), prog(cfg.prog) {}
+
+    SCCPStats run() {
+        collect();
+        blockVisited.assign(cfg.blocks.size(), 0);
+        flowWork.push_back({ CFG::NONE, cfg.entry });
+        while (!flowWork.empty() || !ssaWork.empty()) {
+            while (!flowWork.empty()) {
+                auto edge = flowWork.back();
+                flowWork.pop_back();
+                visitEdge(edge.first, edge.second);
+            }
+            while (!ssaWork.empty()) {
+                uint32_t t = ssaWork.back();
+                ssaWork.pop_back();
+                for (const UseSite& u : uses[t]) {
+                    if (!blockVisited[u.block])
+                        continue;
+                    if (u.phi)
+                        visitPhi(u.block, u.index);
+                    else
+                        visitInstr(u.block, u.index);
+                }
+            }
+        }
+        return rewrite();
+    }
+
+private:
+    CFG& cfg;
+    IRProgram& prog;
+    std::unordered_map<uint32_t, LatticeValue> values;     // SSA ʱ -> ֵ
+    std::unordered_map<uint32_t, std::vector<UseSite>> uses;
+    std::unordered_set<uint64_t> executable;                // ִеı (from, to)
+    std::vector<char> blockVisited;
+    std::vector<std::pair<uint32_t, uint32_t>> flowWork;
+    std::vector<uint32_t> ssaWork;
+    SCCPStats stats;
+
+    // ֻǡöһΡҲ ref ʱ
+    void collect() {
+        std::unordered_map<uint32_t, int> defs;
+        std::unordered_set<uint32_t> refTemps;
+        for (uint32_t b : cfg.layout) {
+            BasicBlock& blk = cfg.blocks[b];
+            for (uint32_t i = 0; i < blk.phis.size(); i++) {
+                defs[blk.phis[i].dst.id]++;
+                for (const Operand& a : blk.phis[i].args)
+                    if (a.isTemp())
+                        uses[a.id].push_back({ b, true, i });
+            }
+            for (uint32_t i = 0; i < blk.code.size(); i++) {
+                IRInstruction& instr = blk.code[i];
+                if (Operand* d = defOf(instr))
+                    if (d->isTemp())
+                        defs[d->id]++;
+                forEachUse(prog, instr, [&](Operand& o) {
+                    if (!o.isTemp()) return;
+                    if (isRefArg(o))
+                        refTemps.insert(o.id);
+                    uses[o.id].push_back({ b, false, i });
+                });
+            }
+        }
+        for (auto& d : defs)
+            if (d.second == 1 && !refTemps.count(d.first))
+                values[d.first];
+    }
+
+    LatticeValue valueOf(const Operand& o) const {
+        LatticeValue v;
+        if (o.isImm()) {
+            v.state = LatticeValue::CONST;
+            v.value = o;
+            return v;
+        }
+        if (o.isTemp()) {
+            auto it = values.find(o.id);
+            if (it != values.end())
+                return it->second;
+        }
+        v.state = LatticeValue::BOTTOM;
+        return v;
+    }
+
+    // ֵֻ½TOP -> CONST -> BOTTOM
+    void update(const Operand& dst, LatticeValue v) {
+        if (!dst.isTemp())
+            return;
+        auto it = values.find(dst.id);
+        if (it == values.end())
+            return;
+        LatticeValue& cur = it->second;
+        if (v.state == LatticeValue::CONST) {
+            Operand c;
+            if (!coerceConstant(v.value, prog.tempType(dst.id), c))
+                v.state = LatticeValue::BOTTOM;
+            else
+                v.value = c;
+        }
+        if (cur.state == LatticeValue::BOTTOM || v.state == LatticeValue::TOP)
+            return;
+        if (cur.state == LatticeValue::CONST && v.state == LatticeValue::CONST && cur.value == v.value)
+            return;
+        if (cur.state == LatticeValue::CONST && v.state == LatticeValue::CONST)
+            v.state = LatticeValue::BOTTOM;
+        cur = v;
+        ssaWork.push_back(dst.id);
+    }
+
+    static uint64_t edgeKey(uint32_t from, uint32_t to) {
+        return ((uint64_t)from << 32) | to;
+    }
+
+    void visitEdge(uint32_t from, uint32_t to) {
+        if (!executable.insert(edgeKey(from, to)).second)
+            return;
+        BasicBlock& blk = cfg.blocks[to];
+        for (uint32_t i = 0; i < blk.phis.size(); i++)
+            visitPhi(to, i);
+        if (blockVisited[to])
+            return;
+        blockVisited[to] = 1;
+        for (uint32_t i = 0; i < blk.code.size(); i++)
+            visitInstr(to, i);
+        if (!blk.terminator())
+            addSuccessors(to, true, true);
+    }
+
+    void visitPhi(uint32_t b, uint32_t index) {
+        BasicBlock& blk = cfg.blocks[b];
+        Phi& phi = blk.phis[index];
+        LatticeValue result;
+        for (size_t j = 0; j < blk.preds.size(); j++) {
+            if (!executable.count(edgeKey(blk.preds[j], b)))
+                continue;
+            if (phi.args[j].isNone())
+                continue;   // δֵӰ
+            LatticeValue v = valueOf(phi.args[j]);
+            if (v.state == LatticeValue::TOP)
+                continue;
+            if (v.state == LatticeValue::BOTTOM ||
+                (result.state == LatticeValue::CONST && result.value != v.value)) {
+                result.state = LatticeValue::BOTTOM;
+                break;
+            }
+            result = v;
+        }
+        update(phi.dst, result);
+    }
+
+    // תtaken ΪתĿ꣬fall Ϊ˳
+    void addSuccessors(uint32_t b, bool fall, bool taken) {
+        BasicBlock& blk = cfg.blocks[b];
+        const IRInstruction* term = blk.terminator();
+        if (term && term->type == IRType::RETURN)
+            return;
+        if (term && term->type == IRType::GOTO) {
+            flowWork.push_back({ b, cfg.blockOfLabel(term->result.id) });
+            return;
+        }
+        if (fall && blk.fallthrough != CFG::NONE)
+            flowWork.push_back({ b, blk.fallthrough });
+        if (taken && term)
+            flowWork.push_back({ b, cfg.blockOfLabel(term->result.id) });
+    }
+
+    void visitInstr(uint32_t b, uint32_t index) {
+        IRInstruction& instr = cfg.blocks[b].code[index];
+        switch (instr.type) {
+        case IRType::IF_FALSE_GOTO:
+        case IRType::IF_TRUE_GOTO: {
+            LatticeValue c = valueOf(instr.op1);
+            if (c.state == LatticeValue::TOP)
+                return;
+            if (c.state == LatticeValue::BOTTOM) {
+                addSuccessors(b, true, true);
+                return;
+            }
+            bool jump = isTruthy(c.value) == (instr.type == IRType::IF_TRUE_GOTO);
+            addSuccessors(b, !jump, jump);
+            return;
+        }
+        case IRType::GOTO:
+        case IRType::RETURN:
+            addSuccessors(b, false, false);
+            return;
+        default:
+            break;
+        }
+
+        Operand* d = defOf(instr);
+        if (!d)
+            return;
+        LatticeValue result;
+        switch (instr.type) {
+        case IRType::ASSIGN:
+            result = valueOf(instr.op1);
+            break;
+        case IRType::ADD: case IRType::SUB: case IRType::MUL: case IRType::DIV:
+        case IRType::LESS: case IRType::GREATER: case IRType::EQUAL_EQUAL:
+        case IRType::NOT_EQUAL: case IRType::AND: case IRType::OR: {
+            LatticeValue a = valueOf(instr.op1), c = valueOf(instr.op2);
+            if (a.state == LatticeValue::BOTTOM || c.state == LatticeValue::BOTTOM)
+                result.state = LatticeValue::BOTTOM;
+            else if (a.state == LatticeValue::CONST && c.state == LatticeValue::CONST) {
+                Operand folded;
+                if (foldBinary(instr.type, a.value, c.value, instr.resType, folded)) {
+                    result.state = LatticeValue::CONST;
+                    result.value = folded;
+                }
+                else
+                    result.state = LatticeValue::BOTTOM;
+            }
+            break;
+        }
+        default:
+            // ڴ桢áĽڱδ֪
+            result.state = LatticeValue::BOTTOM;
+            break;
+        }
+        update(*d, result);
+    }
+
+    bool constantOf(const Operand& o, Operand& c) const {
+        if (!o.isTemp())
+            return false;
+        auto it = values.find(o.id);
+        if (it == values.end() || it->second.state != LatticeValue::CONST)
+            return false;
+        c = it->second.value;
+        return true;
+    }
+
+    SCCPStats rewrite() {
+        // δִеĿ
+        for (uint32_t b : cfg.layout)
+            if (!blockVisited[b])
+                cfg.blocks[b].code.clear();
+
+        for (uint32_t b : cfg.layout) {
+            BasicBlock& blk = cfg.blocks[b];
+            if (!blockVisited[b])
+                continue;
+            std::vector<Phi> phis;
+            for (Phi& phi : blk.phis) {
+                Operand c;
+                if (constantOf(phi.dst, c)) {
+                    stats.folded++;
+                    continue;
+                }
+                for (Operand& a : phi.args)
+                    if (constantOf(a, c))
+                        a = c;
+                phis.push_back(phi);
+            }
+            blk.phis = phis;
+
+            std::vector<IRInstruction> code;
+            for (IRInstruction& instr : blk.code) {
+                Operand c;
+                Operand* d = defOf(instr);
+                if (d && constantOf(*d, c)) {
+                    // ֵָ֪ûи
+                    stats.folded++;
+                    continue;
+                }
+                forEachUse(prog, instr, [&](Operand& o) {
+                    Operand k;
+                    if (!isRefArg(o) && constantOf(o, k))
+                        o = k;
+                });
+                if ((instr.type == IRType::IF_FALSE_GOTO || instr.type == IRType::IF_TRUE_GOTO) &&
+                    instr.op1.isImm()) {
+                    stats.branches++;
+                    bool jump = isTruthy(instr.op1) == (instr.type == IRType::IF_TRUE_GOTO);
+                    if (!jump)
+                        continue;   // תֱ˳ִ
+                    instr = IRInstruction(IRType::GOTO, instr.result);
+                }
+                code.push_back(instr);
+            }
+            blk.code = code;
+        }
+        cfg.recomputeEdges();
+        stats.blocks = cfg.removeUnreachable();
+        return stats;
+    }
+};
+
+}
+
+SCCPStats propagateConstants(CFG& cfg) {
+    if (!cfg.inSSA())
+        cfg.toSSA();
+    return SCCP(cfg).run();
+}
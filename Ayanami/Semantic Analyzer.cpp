@@ -1,8 +1,9 @@
 #include"Semantic Analyzer.h"
 #include <unordered_set>
+#include <cmath>
 
 std::ostream& operator<<(std::ostream& out, Symbol& a) {
-    out << "name: " << a.name << std::endl
+    out << "name: " << symName(a.name) << std::endl
         << "valueType: " << valueTypeToString(a.valueType) << std::endl
         << "isConst: " << a.isConst << std::endl
         << "isRef: " << a.isRef << std::endl
@@ -21,26 +22,54 @@ TokenType makeArrayType(TokenType t) {
     }
 }
 
-void SymbolTable::declare(const std::string& name, const Symbol& sym) {
-    if (table.find(name) != table.end()) {
-        throw std::runtime_error("Symbol '" + name + "' already declared in this scope");
+SymbolTable::SymbolTable() {
+    enterScope(); // ȫ
+}
+
+void SymbolTable::enterScope() {
+    scopeMarks.push_back((uint32_t)entries.size());
+}
+
+void SymbolTable::exitScope() {
+    uint32_t mark = scopeMarks.back();
+    scopeMarks.pop_back();
+    // 򵯳ĿÿֵͷָΪڱεĿ
+    while (entries.size() > mark) {
+        const Entry& e = entries.back();
+        if (e.shadowed == NONE)
+            heads.erase(e.name);
+        else
+            heads[e.name] = e.shadowed;
+        entries.pop_back();
     }
-    table[name] = sym;
 }
 
-Symbol* SymbolTable::lookup(const std::string& name) {
-    auto it = table.find(name);
-    if (it != table.end()) return &it->second;
-    if (parent) return parent->lookup(name);
-    return nullptr;
+Symbol* SymbolTable::declare(SymId name, const Symbol& sym) {
+    if (existsInCurrentScope(name)) {
+        throw std::runtime_error("Symbol '" + symName(name) + "' already declared in this scope");
+    }
+    pool.push_back(sym);
+    Symbol* stored = &pool.back();
+
+    auto it = heads.find(name);
+    uint32_t shadowed = it == heads.end() ? NONE : it->second;
+    heads[name] = (uint32_t)entries.size();
+    entries.push_back({ name, shadowed, (uint32_t)scopeMarks.size(), stored });
+    return stored;
+}
+
+Symbol* SymbolTable::lookup(SymId name) {
+    auto it = heads.find(name);
+    if (it == heads.end()) return nullptr;
+    return entries[it->second].sym;
 }
 
-bool SymbolTable::existsInCurrentScope(const std::string& name) {
-    return table.find(name) != table.end();
+bool SymbolTable::existsInCurrentScope(SymId name) {
+    auto it = heads.find(name);
+    return it != heads.end() && entries[it->second].depth == scopeMarks.size();
 }
 
 SemanticAnalyzer::SemanticAnalyzer() {
-    current = new SymbolTable(nullptr); // ȫ
     functionReturnStack.clear();
 }
 
@@ -52,37 +81,25 @@ void SemanticAnalyzer::analyze(Statement* stmt) {
 }
 
 void SemanticAnalyzer::enterScope() {
-    SymbolTable* child = new SymbolTable(current);
-    current = child;
+    symbols.enterScope();
 }
 
 void SemanticAnalyzer::exitScope() {
-    SymbolTable* parent = current->parent;
-    historySymTable.push_back(current);
-    //delete current;
-    current = parent;
+    symbols.exitScope();
 }
 
 void SemanticAnalyzer::visitStatement(Statement* s) {
-    if (auto es = dynamic_cast<ExprStmt*>(s)) { visitExpr(es); return; }
-    if (auto as = dynamic_cast<AssignStmt*>(s)) { visitAssign(as); return; }
-    if (auto fd = dynamic_cast<FunctionDef*>(s)) { visitFunctionDef(fd); return; }
-    if (auto rs = dynamic_cast<ReturnStmt*>(s)) { visitReturn(rs); return; }
-    if (auto is = dynamic_cast<IfStmt*>(s)) { visitIf(is); return; }
-    if (auto fs = dynamic_cast<ForStmt*>(s)) { visitFor(fs); return; }
-    if (auto ws = dynamic_cast<WhileStmt*>(s)) { visitWhile(ws); return; }
-
-    //  statement ͣIf/While/ExprStmtȣڴչ
-    // Ǹ/飬ɽ enterScope/exitScope 
+    dispatchStmt(s);
 }
 
 void SemanticAnalyzer::visitExpr(ExprStmt* node) {
-    if (auto be = dynamic_cast<BinaryExpr*>(node->expr)) {
-        std::string name = uint32tsToString(be->left->name);
-        Symbol* sym = current->lookup(name);
+    if (auto be = node_cast<BinaryExpr>(node->expr)) {
+        SymId id = be->left->name;
+        const std::string& name = symName(id);
+        Symbol* sym = symbols.lookup(id);
         TokenType rhsType = inferType(be->right);
 
-        if (auto elem = dynamic_cast<ArrayElemExpr*>(be->left)) {
+        if (auto elem = node_cast<ArrayElemExpr>(be->left)) {
 
             if (!sym)
                 throw std::runtime_error("Undeclared array variable '" + name + "'");
@@ -118,6 +135,9 @@ void SemanticAnalyzer::visitExpr(ExprStmt* node) {
                 sym->valueType = makeArrayType(rhsType);
             }
 
+            elem->symbol = sym;
+            elem->type = elemType;
+            elem->typed = true;
             return;
         }
 
@@ -125,11 +145,15 @@ void SemanticAnalyzer::visitExpr(ExprStmt* node) {
         if (!sym) {
             // ״γ => ﷨
             Symbol s;
-            s.name = name;
+            s.name = id;
             s.valueType = rhsType;
             s.isConst = false;
-            current->declare(name, s);
+            Symbol* declared = symbols.declare(id, s);
 
+            if (auto var = node_cast<VarExpr>(be->left))
+                var->symbol = declared;
+            be->left->type = rhsType;
+            be->left->typed = true;
             //std::cout << s;
             return;
         }
@@ -146,46 +170,22 @@ void SemanticAnalyzer::visitExpr(ExprStmt* node) {
             // δ֪Ϣ
             if (sym->valueType == TokenType::UNKNOWN) sym->valueType = rhsType;
 
+            if (auto var = node_cast<VarExpr>(be->left))
+                var->symbol = sym;
+            be->left->type = sym->valueType;
+            be->left->typed = true;
             //std::cout << (*sym);
         }
     }
-    else if (auto call = dynamic_cast<CallExpr*>(node->expr)) {
-        // 
-        std::string funcName = uint32tsToString(call->callee);
-        for (int i = 0; i < call->args.size(); i++) {
-            auto t = inferType(call->args[i]);
-            funcName += valueTypeToString(t);
-        }
-        const Symbol* fn = current->lookup(funcName);
-        if (!fn) {
-            throw std::runtime_error("Undefined function: " + uint32tsToString(call->callee));
-        }
-
-        // 
-        if (call->args.size() != fn->paramTypes.size()) {
-            throw std::runtime_error(
-                "Function '" + uint32tsToString(call->callee) + "' expects " +
-                std::to_string(fn->paramTypes.size()) + " arguments, but got " +
-                std::to_string(call->args.size()));
-        }
-
-        // ͼ
-        for (size_t i = 0; i < call->args.size(); ++i) {
-            TokenType argType = inferType(call->args[i]);
-            if (argType != fn->paramTypes[i]) {
-                throw std::runtime_error(
-                    "Type mismatch in argument " + std::to_string(i + 1) +
-                    " of function '" + uint32tsToString(call->callee) + "'");
-            }
-        }
-
-        // غķֵ
-        //return fn->funcReturnType;
+    else if (auto call = node_cast<CallExpr>(node->expr)) {
+        // ãذ󶨶 visitCall 
+        inferType(call);
     }
 }
 
 void SemanticAnalyzer::visitAssign(AssignStmt* node) {
-    std::string name = uint32tsToString(node->varName);
+    SymId id = node->varName;
+    const std::string& name = symName(id);
     TokenType rhsType = inferType(node->value);
 
     if (rhsType>=TokenType::ARR_INT) {
@@ -196,14 +196,14 @@ void SemanticAnalyzer::visitAssign(AssignStmt* node) {
         }
     }
 
-    Symbol* sym = current->lookup(name);
+    Symbol* sym = symbols.lookup(id);
     if (!sym) {
         // ״γ => ﷨
         Symbol s;
-        s.name = name;
+        s.name = id;
         s.valueType = rhsType;
         s.isConst = node->isConst;
-        current->declare(name, s);
+        node->symbol = symbols.declare(id, s);
 
         //std::cout << s;
         return;
@@ -221,41 +221,44 @@ void SemanticAnalyzer::visitAssign(AssignStmt* node) {
         // δ֪Ϣ
         if (sym->valueType == TokenType::UNKNOWN) sym->valueType = rhsType;
 
+        node->symbol = sym;
         //std::cout << (*sym);
     }
 }
 
 void SemanticAnalyzer::visitFunctionDef(FunctionDef* node) {
-    std::string fname = uint32tsToString(node->name);
+    std::string fname = symName(node->name);
     for (int i = 0; i < node->params.size(); i++) {
         fname += valueTypeToString(node->params[i].type);
     }
+    SymId fid = intern(fname);
 
-    if (current->lookup(fname) && current->existsInCurrentScope(fname)) {
+    if (symbols.existsInCurrentScope(fid)) {
         throw std::runtime_error("Function '" + fname + "' already declared in this scope");
     }
 
     // ڵǰţռλ
     Symbol funcSym;
-    funcSym.name = fname;
+    funcSym.name = fid;
     funcSym.isFunction = true;
     funcSym.valueType = TokenType::FN;
 
     // /д funcSym.paramTypes param.type ֪
     for (const Param& p : node->params) {
         funcSym.paramTypes.push_back(p.type);
+        funcSym.paramRefs.push_back(p.isRef);
     }
-    current->declare(fname, funcSym);
+    Symbol* fs = symbols.declare(fid, funcSym);
+    node->symbol = fs;
 
     // 򣨺壩Ѳű
     enterScope();
     for (const Param& p : node->params) {
-        std::string pname = uint32tsToString(p.name);
         Symbol psym;
-        psym.name = pname;
+        psym.name = p.name;
         psym.valueType = p.type;
         psym.isRef = p.isRef;
-        current->declare(pname, psym);
+        symbols.declare(p.name, psym);
     }
 
     // ѹһ return-type setռ return 
@@ -271,15 +274,13 @@ void SemanticAnalyzer::visitFunctionDef(FunctionDef* node) {
     if (retSet.empty()) {
         // û return => void
         // úŵķϢ
-        Symbol* fs = current->parent->lookup(fname); // ע⣺ڸ
-        if (fs) fs->funcReturnType = TokenType::VOID;
+        fs->funcReturnType = TokenType::VOID;
 
         node->retType = TokenType::VOID;
     }
     else if (retSet.size() == 1) {
         TokenType rt = *retSet.begin();
-        Symbol* fs = current->parent->lookup(fname);
-        if (fs) fs->funcReturnType = rt;
+        fs->funcReturnType = rt;
 
         node->retType = rt;
     }
@@ -318,8 +319,8 @@ void SemanticAnalyzer::visitIf(IfStmt* node) {
 
 void SemanticAnalyzer::visitFor(ForStmt* node) {
     //  ѭ
-    std::string varName = uint32tsToString(node->param->name);
-    Symbol* sym = current->lookup(varName);
+    SymId varName = node->param->name;
+    Symbol* sym = symbols.lookup(varName);
     //TokenType rhsType = inferType(node->param);
 
     if (!sym) {
@@ -328,11 +329,15 @@ void SemanticAnalyzer::visitFor(ForStmt* node) {
         funcSym.name = varName;
         funcSym.valueType = TokenType::INT;
         funcSym.isConst = false;
-        current->declare(varName, funcSym);
+        sym = symbols.declare(varName, funcSym);
 
         //std::cout << s;
         //return;
     }
+    if (auto var = node_cast<VarExpr>(node->param))
+        var->symbol = sym;
+    node->param->type = sym->valueType;
+    node->param->typed = true;
 
     // 鲢Ƶʽ
     TokenType startType = TokenType::INT;
@@ -350,12 +355,6 @@ void SemanticAnalyzer::visitFor(ForStmt* node) {
     if (endType != TokenType::INT || startType != TokenType::INT || stepType != TokenType::INT)
         throw std::runtime_error("For-loop bounds and step must be integers.");
 
-    // ʡԲȫĬֵ
-    if (!node->startExpr)
-        node->startExpr = new NumberExpr(0);
-    if (!node->stepExpr)
-        node->stepExpr = new NumberExpr(1);
-
     // ѭ
     enterScope();
 
@@ -415,125 +414,131 @@ void SemanticAnalyzer::visitOutput(OutputStmt* stmt) {
 
 TokenType SemanticAnalyzer::inferType(ExprNode* expr) {
     if (!expr) return TokenType::VOID;
-    if (auto n = dynamic_cast<NumberExpr*>(expr)) {
-        // ж򸡵
-        double v = n->value;
-        if (std::floor(v) == v) return TokenType::INT;
-        return TokenType::FLOAT;
-    }
-    if (auto n = dynamic_cast<CharExpr*>(expr)) {
-        // жַ
-        std::string v = n->value;
-        return TokenType::CHAR;
-    }
-    if (auto n = dynamic_cast<BoolExpr*>(expr)) {
-        // жϲ
-        bool v = n->value;
-        return TokenType::BOOL;
+    // ÿڵֻƶһΣڽڵ
+    if (expr->typed) return expr->type;
+    expr->type = dispatchExpr(expr);
+    expr->typed = true;
+    return expr->type;
+}
+
+TokenType SemanticAnalyzer::visitNumber(NumberExpr* n) {
+    // ж򸡵
+    double v = n->value;
+    if (std::floor(v) == v) return TokenType::INT;
+    return TokenType::FLOAT;
+}
+
+TokenType SemanticAnalyzer::visitChar(CharExpr* n) {
+    // жַ
+    return TokenType::CHAR;
+}
+
+TokenType SemanticAnalyzer::visitBool(BoolExpr* n) {
+    // жϲ
+    bool v = n->value;
+    return TokenType::BOOL;
+}
+
+TokenType SemanticAnalyzer::visitVar(VarExpr* v) {
+    Symbol* sym = symbols.lookup(v->name);
+    if (!sym) {
+        // δĹ򣬵һγֻ Assign ʱΪñ
+        throw std::runtime_error("Use of undeclared variable '" + symName(v->name) + "'");
     }
-    if (auto v = dynamic_cast<VarExpr*>(expr)) {
-        std::string name = uint32tsToString(v->name);
-        Symbol* sym = current->lookup(name);
-        if (!sym) {
-            // δĹ򣬵һγֻ Assign ʱΪñ
-            throw std::runtime_error("Use of undeclared variable '" + name + "'");
-        }
-        return sym->valueType;
+    v->symbol = sym;
+    return sym->valueType;
+}
+
+TokenType SemanticAnalyzer::visitArray(ArrayExpr* ae) {
+    if (ae->elem.size() == 0) {
+        return TokenType::UNKNOWN;
     }
-    if (auto ae = dynamic_cast<ArrayExpr*>(expr)) {
-        if (ae->elem.size() == 0) {
-            return TokenType::UNKNOWN;
-        }
-        TokenType type = inferType(ae->elem[0]);
-        for (int i = 1; i < ae->elem.size(); i++) {
-            if (inferType(ae->elem[i]) != type) {
-                throw std::runtime_error("There are more than one type in this array");
-            }
+    TokenType type = inferType(ae->elem[0]);
+    for (int i = 1; i < ae->elem.size(); i++) {
+        if (inferType(ae->elem[i]) != type) {
+            throw std::runtime_error("There are more than one type in this array");
         }
-        ae->type = TokenType((int)type - (int)TokenType::INT + (int)TokenType::ARR_INT);
-        return ae->type;
     }
-    if (auto elem = dynamic_cast<ArrayElemExpr*>(expr)) {
-        Symbol* sym = current->lookup(uint32tsToString(elem->name));
-        if (!sym)
-            throw std::runtime_error("Undeclared array variable '" + uint32tsToString(elem->name) + "'");
-        if (inferType(elem->index) != TokenType::INT)
-            throw std::runtime_error("Array index must be integer");
-
-        // Ԫ
-        switch (sym->valueType) {
-        case TokenType::ARR_INT: return TokenType::INT;
-        case TokenType::ARR_FLOAT: return TokenType::FLOAT;
-        case TokenType::ARR_CHAR: return TokenType::CHAR;
-        case TokenType::ARR_BOOL: return TokenType::BOOL;
-        default:
-            throw std::runtime_error("Attempting to index non-array variable '" + uint32tsToString(elem->name) + "'");
-        }
+    ae->type = TokenType((int)type - (int)TokenType::INT + (int)TokenType::ARR_INT);
+    return ae->type;
+}
+
+TokenType SemanticAnalyzer::visitArrayElem(ArrayElemExpr* elem) {
+    Symbol* sym = symbols.lookup(elem->name);
+    if (!sym)
+        throw std::runtime_error("Undeclared array variable '" + symName(elem->name) + "'");
+    if (inferType(elem->index) != TokenType::INT)
+        throw std::runtime_error("Array index must be integer");
+    elem->symbol = sym;
+
+    // Ԫ
+    switch (sym->valueType) {
+    case TokenType::ARR_INT: return TokenType::INT;
+    case TokenType::ARR_FLOAT: return TokenType::FLOAT;
+    case TokenType::ARR_CHAR: return TokenType::CHAR;
+    case TokenType::ARR_BOOL: return TokenType::BOOL;
+    default:
+        throw std::runtime_error("Attempting to index non-array variable '" + symName(elem->name) + "'");
     }
-    if (auto b = dynamic_cast<BinaryExpr*>(expr)) {
-        // 򻯴Ǹֵ "=" AssignStmt ﴦǼӼ˳ƶ
-        std::string op = uint32tsToString(b->op);
-        if (op == "=") {
-            // Ӧߵֵ AssignStmt ʾparser Ӧ֣
-            return inferType(b->right);
-        }
-        TokenType L = inferType(b->left);
-        TokenType R = inferType(b->right);
-        if (op == "+" || op == "-" || op == "*" || op == "/") {
-            if (L == TokenType::FLOAT || R == TokenType::FLOAT) return TokenType::FLOAT;
-            if (L == TokenType::INT && R == TokenType::INT) return TokenType::INT;
-            if (L == TokenType::CHAR || R == TokenType::CHAR) return TokenType::CHAR;
-            if (L == TokenType::BOOL || R == TokenType::BOOL) return TokenType::BOOL;
-            // ݷ UNKNOWN
-            return TokenType::UNKNOWN;
-        }
-        // ߼/Ƚ㷵 BOOL
-        if (op == "==" || op == "!=" || op == "<" || op == ">" ||
-            op == "<=" || op == ">=" || op == "&&" || op == "||") {
-            return TokenType::BOOL;
-        }
+}
 
+TokenType SemanticAnalyzer::visitBinary(BinaryExpr* b) {
+    // 򻯴Ǹֵ "=" AssignStmt ﴦǼӼ˳ƶ
+    const std::string& op = symName(b->op);
+    if (op == "=") {
+        // Ӧߵֵ AssignStmt ʾparser Ӧ֣
+        return inferType(b->right);
+    }
+    TokenType L = inferType(b->left);
+    TokenType R = inferType(b->right);
+    if (op == "+" || op == "-" || op == "*" || op == "/") {
+        if (L == TokenType::FLOAT || R == TokenType::FLOAT) return TokenType::FLOAT;
+        if (L == TokenType::INT && R == TokenType::INT) return TokenType::INT;
+        if (L == TokenType::CHAR || R == TokenType::CHAR) return TokenType::CHAR;
+        if (L == TokenType::BOOL || R == TokenType::BOOL) return TokenType::BOOL;
+        // ݷ UNKNOWN
         return TokenType::UNKNOWN;
     }
-    if (auto call = dynamic_cast<CallExpr*>(expr)) {
-        // 
-        std::string funcName = uint32tsToString(call->callee);
-        for (int i = 0; i < call->args.size(); i++) {
-            auto t = inferType(call->args[i]);
-            funcName += valueTypeToString(t);
-        }
-        const Symbol* fn = current->lookup(funcName);
-        if (!fn) {
-            throw std::runtime_error("Undefined function: " + uint32tsToString(call->callee));
-        }
-        
-        // 
-        if (call->args.size() != fn->paramTypes.size()) {
-            throw std::runtime_error(
-                "Function '" + uint32tsToString(call->callee) + "' expects " +
-                std::to_string(fn->paramTypes.size()) + " arguments, but got " +
-                std::to_string(call->args.size()));
-        }
-
-        // ͼ
-        for (size_t i = 0; i < call->args.size(); ++i) {
-            TokenType argType = inferType(call->args[i]);
-            if (argType != fn->paramTypes[i]) {
-                throw std::runtime_error(
-                    "Type mismatch in argument " + std::to_string(i + 1) +
-                    " of function '" + uint32tsToString(call->callee) + "'");
-            }
-        }
-
-        // غķֵ
-        return fn->funcReturnType;
+    // ߼/Ƚ㷵 BOOL
+    if (op == "==" || op == "!=" || op == "<" || op == ">" ||
+        op == "<=" || op == ">=" || op == "&&" || op == "||") {
+        return TokenType::BOOL;
     }
 
-    // ʽͣCallExpr, MemberExpr, etc.Ҫչ
     return TokenType::UNKNOWN;
 }
 
+TokenType SemanticAnalyzer::visitCall(CallExpr* call) {
+    // 
+    std::string funcName = symName(call->callee);
+    for (int i = 0; i < call->args.size(); i++) {
+        auto t = inferType(call->args[i]);
+        funcName += valueTypeToString(t);
+    }
+    Symbol* fn = symbols.lookup(intern(funcName));
+    if (!fn) {
+        throw std::runtime_error("Undefined function: " + symName(call->callee));
+    }
+    call->fn = fn;
+    
+    // 
+    if (call->args.size() != fn->paramTypes.size()) {
+        throw std::runtime_error(
+            "Function '" + symName(call->callee) + "' expects " +
+            std::to_string(fn->paramTypes.size()) + " arguments, but got " +
+            std::to_string(call->args.size()));
+    }
 
+    // ͼ
+    for (size_t i = 0; i < call->args.size(); ++i) {
+        TokenType argType = call->args[i]->type;
+        if (argType != fn->paramTypes[i]) {
+            throw std::runtime_error(
+                "Type mismatch in argument " + std::to_string(i + 1) +
+                " of function '" + symName(call->callee) + "'");
+        }
+    }
 
-
-
+    // غķֵ
+    return fn->funcReturnType;
+}
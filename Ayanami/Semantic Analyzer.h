@@ -9,6 +9,8 @@
 #include <memory>
 #include <stdexcept>
 #include <set>
+#include <deque>
+#include <cstdint>
 #ifndef ASTNODE_H
 #define ASTNODE_H
 #include"ASTNode.h"
@@ -16,7 +18,8 @@
 #ifndef SEM_H
 #define SEM_H
 #endif
-// ٶ util.h ṩ utf32ToString / stringToUint32ts 
+#include"ASTVisitor.h"
+// ٶ util.h ṩ Token / TokenType 
 #ifndef UTIL_H
 #define UTIL_H
 #include"util.h"
@@ -24,43 +27,61 @@
 
 // ---------- űʾ ----------
 struct Symbol {
-    std::string name;
+    SymId name = 0;
     TokenType valueType = TokenType::UNKNOWN;
     bool isConst = false;
     bool isRef = false;        // ò
     bool isFunction = false;
     // ںչб͵
     std::vector<TokenType> paramTypes;
+    std::vector<bool> paramRefs;       // ǷΪ ref
     TokenType funcReturnType = TokenType::UNKNOWN;
 
     friend std::ostream& operator<<(std::ostream& out, Symbol& a);
 };
 
-// ---------- ű֧ʽ ----------
+// ---------- űƽջ ----------
+/*
+* һĿջÿάһڱ
+*	heads[name] ָµĿĿűڱεһĿ
+*	lookup ֻһιϣң˳ʱضĿջָͷ
+* űֻ׷ӵ pool ַȻЧAST ϵİ󶨲
+*/
 class SymbolTable {
 public:
-    SymbolTable(SymbolTable* parent = nullptr) : parent(parent) {}
-    ~SymbolTable() {
-        //delete parent;
-    }
+    SymbolTable();
 
-    // ڵǰ
-    void declare(const std::string& name, const Symbol& sym);
+    void enterScope();
+    void exitScope();
+
+    // ڵǰ򣩣طŵĵַڼЧ
+    Symbol* declare(SymId name, const Symbol& sym);
 
-    // Ķ壨ϣ
-    Symbol* lookup(const std::string& name);
+    // Ķ
+    Symbol* lookup(SymId name);
 
     // ڵǰǷ
-    bool existsInCurrentScope(const std::string& name);
+    bool existsInCurrentScope(SymId name);
 
-    SymbolTable* parent;
 private:
-    std::unordered_map<std::string, Symbol> table;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Entry {
+        SymId name;
+        uint32_t shadowed;   // ڱεͬĿ±꣬NONE ʾû
+        uint32_t depth;      // 
+        Symbol* sym;
+    };
+
+    std::deque<Symbol> pool;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> scopeMarks;            // ÿʼʱ entries ĳ
+    std::unordered_map<SymId, uint32_t> heads;   //  -> Ŀ±
 };
 
-
 // ----------  ----------
-class SemanticAnalyzer {
+class SemanticAnalyzer : public ASTVisitor<SemanticAnalyzer, TokenType> {
+    friend class ASTVisitor<SemanticAnalyzer, TokenType>;
 public:
     SemanticAnalyzer();
 
@@ -76,9 +97,7 @@ public:
     // ---------- Expression type inference ----------
     TokenType inferType(ExprNode* expr);
 
-    SymbolTable* current;
-
-    std::vector<SymbolTable*>historySymTable;
+    SymbolTable symbols;
 private:
 
     bool inLoop = false;
@@ -110,5 +129,15 @@ private:
 
     void visitOutput(OutputStmt* stmt);
 
+    // ---------- Expression visitors inferType ɣ ----------
+    TokenType visitNumber(NumberExpr* n);
+    TokenType visitChar(CharExpr* n);
+    TokenType visitBool(BoolExpr* n);
+    TokenType visitVar(VarExpr* v);
+    TokenType visitArray(ArrayExpr* ae);
+    TokenType visitArrayElem(ArrayElemExpr* elem);
+    TokenType visitBinary(BinaryExpr* b);
+    TokenType visitCall(CallExpr* call);
+
 };
 
@@ -0,0 +1,132 @@
+#include "SourceBuffer.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include "utf8.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SourceBuffer::SourceBuffer(const std::string& path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Cannot open source file '" + path + "'");
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("Cannot stat source file '" + path + "'");
+	}
+	fileHandle = file;
+	mappedLength = (size_t)fileSize.QuadPart;
+
+	// ļ޷ӳ䣬ֱӵջ
+	if (mappedLength != 0) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			unmap();
+			throw std::runtime_error("Cannot map source file '" + path + "'");
+		}
+		mappingHandle = mapping;
+		mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!mapped) {
+			unmap();
+			throw std::runtime_error("Cannot map source file '" + path + "'");
+		}
+	}
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Cannot open source file '" + path + "'");
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::runtime_error("Cannot stat source file '" + path + "'");
+	}
+	mappedLength = (size_t)st.st_size;
+
+	if (mappedLength != 0) {
+		void* p = mmap(nullptr, mappedLength, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Cannot map source file '" + path + "'");
+		}
+		// ˳ɨ裬ʾںǰԤ
+		madvise(p, mappedLength, MADV_SEQUENTIAL);
+		mapped = p;
+	}
+	// ӳ佨ļɹر
+	close(fd);
+#endif
+
+	begin = static_cast<const char*>(mapped);
+	length = mappedLength;
+
+	//  UTF-8 BOM±ļϣ
+	if (length >= 3 && utf8::starts_with_bom(begin, begin + length)) {
+		begin += 3;
+		length -= 3;
+	}
+
+	if (!isValidUtf8(begin, length)) {
+		unmap();
+		throw std::runtime_error("Invalid UTF-8 in source file");
+	}
+}
+
+SourceBuffer::~SourceBuffer() {
+	unmap();
+}
+
+void SourceBuffer::unmap() {
+#ifdef _WIN32
+	if (mapped)
+		UnmapViewOfFile(mapped);
+	if (mappingHandle)
+		CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle)
+		CloseHandle((HANDLE)fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (mapped)
+		munmap(mapped, mappedLength);
+#endif
+	mapped = nullptr;
+	begin = nullptr;
+	length = 0;
+}
+
+bool SourceBuffer::isValidUtf8(const char* p, size_t n) {
+	const char* end = p + n;
+	while (p < end) {
+		// ASCII ·һμ 8 ֽڵλ
+		while (end - p >= 8) {
+			uint64_t word;
+			std::memcpy(&word, p, sizeof(word));
+			if (word & 0x8080808080808080ull)
+				break;
+			p += 8;
+		}
+		while (p < end && (unsigned char)*p < 0x80)
+			++p;
+		if (p == end)
+			break;
+
+		// ֽУ utf8cpp У鵥
+		if (utf8::internal::validate_next(p, end) != utf8::internal::UTF8_OK)
+			return false;
+	}
+	return true;
+}
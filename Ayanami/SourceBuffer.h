@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/*
+* Դļ
+* 壺ֻڴӳķʽ .aya Դļ
+* ã
+*	Lexer ֱӳ UTF-8 ֽɨ裬 UTF-32
+*	ֵڴļСҲж⿽
+*/
+class SourceBuffer {
+public:
+	explicit SourceBuffer(const std::string& path);
+	~SourceBuffer();
+
+	SourceBuffer(const SourceBuffer&) = delete;
+	SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+	const char* data() const { return begin; }
+	size_t size() const { return length; }
+
+	std::string_view view() const { return std::string_view(begin, length); }
+
+private:
+	const char* begin = nullptr;
+	size_t length = 0;
+
+	// ӳʼַ볤ȣ BOM
+	void* mapped = nullptr;
+	size_t mappedLength = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+
+	void unmap();
+
+	// У UTF-8 ASCII ְ 8 ֽһֻԶֽУ
+	static bool isValidUtf8(const char* p, size_t n);
+};
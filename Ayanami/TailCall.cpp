@@ -0,0 +1,94 @@
+#include "Optimizer.h"
+
+namespace {
+
+bool isSelfCall(const CFG& cfg, const IRInstruction& instr) {
+    return instr.type == IRType::CALL && instr.op1.id == cfg.func.name;
+}
+
+// ֮󵽺֮䲻κ
+bool isTailPosition(CFG& cfg, uint32_t b, size_t index) {
+    const IRInstruction& call = cfg.blocks[b].code[index];
+    auto isReturn = [&](const IRInstruction& instr) {
+        return instr.type == IRType::RETURN &&
+            (instr.op1.isNone() || (!call.result.isNone() && instr.op1 == call.result));
+    };
+
+    size_t i = index + 1;
+    for (size_t steps = 0; steps <= cfg.blocks.size(); steps++) {
+        const BasicBlock& blk = cfg.blocks[b];
+        uint32_t next;
+        if (i == blk.code.size())
+            next = blk.fallthrough;
+        else if (i + 1 == blk.code.size() && blk.code[i].type == IRType::GOTO)
+            next = cfg.blockOfLabel(blk.code[i].result.id);
+        else
+            return i + 1 == blk.code.size() && isReturn(blk.code[i]);
+        if (next == CFG::NONE)
+            return true;    // 䵽ĩβ
+        b = next;
+        i = 0;
+    }
+    return false;
+}
+
+// ref βֻԭԼλ
+bool argsCompatible(CFG& cfg, const IRInstruction& call) {
+    const auto& params = cfg.func.params;
+    if (call.argCount != params.size())
+        return false;
+    const Operand* args = cfg.prog.args(call);
+    for (size_t k = 0; k < params.size(); k++)
+        if (params[k].isRef && !(args[k].isVar() && args[k].id == params[k].name))
+            return false;
+    return true;
+}
+
+}
+
+size_t eliminateTailCalls(CFG& cfg) {
+    cfg.fromSSA();
+    uint32_t body = cfg.entry;
+    size_t eliminated = 0;
+
+    for (size_t pos = 0; pos < cfg.layout.size(); pos++) {
+        uint32_t b = cfg.layout[pos];
+        for (size_t i = 0; i < cfg.blocks[b].code.size(); i++) {
+            IRInstruction call = cfg.blocks[b].code[i];
+            if (!isSelfCall(cfg, call) || !argsCompatible(cfg, call) || !isTailPosition(cfg, b, i))
+                continue;
+
+            // Ȱʵʱ帳βΣʵοñβΣ
+            const auto& params = cfg.func.params;
+            std::vector<Operand> args(cfg.prog.args(call), cfg.prog.args(call) + call.argCount);
+            std::vector<IRInstruction> copies, assigns;
+            for (size_t k = 0; k < params.size(); k++) {
+                Operand p = Operand::var(params[k].name);
+                Operand a = args[k];
+                a.flags = 0;
+                if (params[k].isRef || a == p)
+                    continue;
+                Operand t = cfg.prog.newTemp(params[k].type);
+                copies.emplace_back(IRType::ASSIGN, t, a, Operand(), params[k].type);
+                assigns.emplace_back(IRType::ASSIGN, p, t, Operand(), params[k].type);
+            }
+
+            // ͷҪһصĿ飬ڿǰ
+            if (eliminated == 0) {
+                std::vector<uint32_t> none;
+                cfg.splitPreds(cfg.entry, none);
+            }
+            auto& code = cfg.blocks[b].code;
+            code.erase(code.begin() + i, code.end());
+            code.insert(code.end(), copies.begin(), copies.end());
+            code.insert(code.end(), assigns.begin(), assigns.end());
+            code.emplace_back(IRType::GOTO, Operand::label(cfg.ensureLabel(body)));
+            cfg.recomputeEdges();
+            eliminated++;
+            break;
+        }
+    }
+    if (eliminated)
+        cfg.removeUnreachable();
+    return eliminated;
+}
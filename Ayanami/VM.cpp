@@ -0,0 +1,385 @@
+#include "VM.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AYA_COMPUTED_GOTO 1
+#else
+#define AYA_COMPUTED_GOTO 0
+#endif
+
+namespace {
+
+constexpr size_t STACK_VALUES = 1 << 21;        // 16 MB ֵջ
+constexpr size_t MAX_CALL_DEPTH = 1 << 18;
+constexpr size_t OUTPUT_BUFFER = 1 << 16;
+constexpr size_t NATIVE_STACK_BUDGET = 4 << 20;  // شõĻջ
+
+//  32 λƺչ
+inline int64_t wrap(uint32_t v) {
+    return (int32_t)v;
+}
+
+inline int64_t floatToInt(double f) {
+    return f > -2147483649.0 && f < 2147483648.0 ? (int32_t)f : INT32_MIN;
+}
+
+std::string outOfRange(int64_t i, int64_t length) {
+    return "runtime error: array index " + std::to_string(i) + " out of range [0, " + std::to_string(length) + ")";
+}
+
+inline Value* element(Value* arr, int64_t i) {
+    if (i < 0 || i >= arr[-1].i)
+        throw std::runtime_error(outOfRange(i, arr[-1].i));
+    return arr + i;
+}
+
+}
+
+VM::VM(const BcProgram& prog) :prog(prog), stack(STACK_VALUES), stackEnd(stack.data() + stack.size()) {
+}
+
+//  base  fn ֲ֡Ĵװ볣ʵɵдã
+Value* VM::enter(const BcFunction& fn, Value* base) {
+    if (base + fn.regs > stackEnd || calls.size() >= MAX_CALL_DEPTH)
+        throw std::runtime_error("runtime error: stack overflow");
+    std::memset(base + fn.params, 0, sizeof(Value) * (fn.constBase - fn.params));
+    if (!fn.consts.empty())
+        std::memcpy(base + fn.constBase, fn.consts.data(), sizeof(Value) * fn.consts.size());
+    return base;
+}
+
+// ȷڵ -1 ԪأԪ
+Value* VM::newArray(int64_t n) {
+    if (n < 0)
+        throw std::runtime_error("runtime error: negative array size");
+    arrays.emplace_back(new Value[(size_t)n + 1]());
+    Value* p = arrays.back().get();
+    p[0].i = n;
+    return p + 1;
+}
+
+void VM::flush() {
+    if (!output.empty()) {
+        std::fwrite(output.data(), 1, output.size(), stdout);
+        output.clear();
+    }
+    std::fflush(stdout);
+}
+
+void VM::input(Op op, Value& dst) {
+    flush();
+    if (op == Op::IN_F) {
+        double v = 0;
+        if (std::scanf("%lf", &v) != 1)
+            v = 0;
+        dst.f = v;
+    }
+    else if (op == Op::IN_C) {
+        char v = 0;
+        if (std::scanf(" %c", &v) != 1)
+            v = 0;
+        dst.i = (int8_t)v;
+    }
+    else {
+        int v = 0;
+        if (std::scanf("%d", &v) != 1)
+            v = 0;
+        dst.i = v;
+    }
+}
+
+void VM::print(Op op, Value v) {
+    char buf[32];
+    if (op == Op::OUT_C)
+        output += (char)v.i;
+    else if (op == Op::OUT_F)
+        output.append(buf, std::snprintf(buf, sizeof buf, "%g", v.f));
+    else
+        output.append(buf, std::snprintf(buf, sizeof buf, "%lld", (long long)v.i));
+    if (output.size() >= OUTPUT_BUFFER)
+        flush();
+}
+
+int VM::run() {
+    size_t n = prog.functions.size();
+    hotness.assign(n, 0);
+    tiers.assign(n, jit && JitCompiler::supported() ? Tier::INTERPRETED : Tier::FAILED);
+    natives.assign(n, nullptr);
+    code.assign(n, NativeCode());
+
+    char here;
+    nativeStackLimit = (char*)((uintptr_t)&here - NATIVE_STACK_BUDGET);
+    JitRuntime rt;
+    rt.ctx = this;
+    rt.natives = natives.data();
+    rt.stackLimit = &nativeStackLimit;
+    rt.stackEnd = &stackEnd;
+    rt.call = nativeCall;
+    rt.newArray = nativeNewArray;
+    rt.input = nativeInput;
+    rt.output = nativeOutput;
+    rt.divideError = nativeDivideError;
+    rt.boundsError = nativeBoundsError;
+    rt.stackError = nativeStackError;
+    compiler.reset(new JitCompiler(rt));
+
+    try {
+        const BcFunction& main = prog.functions[prog.mainIndex];
+        Value result = interpret(&main, enter(main, stack.data()));
+        flush();
+        return main.retType == TokenType::FLOAT || main.retType == TokenType::VOID ? 0 : (int)result.i;
+    }
+    catch (...) {
+        flush();
+        throw;
+    }
+}
+
+// ɱش룬ʧܵĺԺһֱִ
+bool VM::tierUp(uint32_t index) {
+    if (!compiler->compile(prog.functions[index], code[index])) {
+        tiers[index] = Tier::FAILED;
+        return false;
+    }
+    natives[index] = code[index].entry;
+    tiers[index] = Tier::NATIVE;
+    jitCompiled++;
+    return true;
+}
+
+//  base ִѱĺresume ǿʱ֡ĵǰ״̬
+Value VM::callNative(uint32_t index, Value* base, const void* resume) {
+    if (!natives[index](this, base, resume))
+        throw std::runtime_error(nativeError);
+    return base[0];
+}
+
+/*
+*  fn ĿͷִеأR ΪѾ enter ֡
+* ִеĺ֮ĵֻѹ CallInfoش뾭 nativeCall صʱ룬calls ӵǰȿʼ
+*/
+Value VM::interpret(const BcFunction* fn, Value* R) {
+    const size_t bottom = calls.size();
+    const BcInstr* pc = fn->code.data();
+    BcInstr ins;
+    Value result;
+    result.i = 0;
+
+#if AYA_COMPUTED_GOTO
+#define AYA_OPCODE_LABEL(name) &&op_##name,
+    static void* const dispatch[] = { AYA_OPCODES(AYA_OPCODE_LABEL) };
+#undef AYA_OPCODE_LABEL
+#define CASE(name) op_##name:
+#define NEXT ins = *pc++; goto *dispatch[(size_t)ins.op]
+#else
+#define CASE(name) case Op::name:
+#define NEXT continue
+#endif
+// ѭĻرߣȶ
+#define JUMP(cond) \
+    if (cond) { \
+        const BcInstr* to = fn->code.data() + ins.c; \
+        if (to < pc) { \
+            pc = to; \
+            goto backedge; \
+        } \
+        pc = to; \
+    } \
+    NEXT
+
+    {
+#if AYA_COMPUTED_GOTO
+        NEXT;
+#else
+        for (;;) {
+            ins = *pc++;
+            switch (ins.op) {
+#endif
+        CASE(MOV) R[ins.a] = R[ins.b]; NEXT;
+
+        CASE(ADD_I) R[ins.a].i = wrap((uint32_t)R[ins.b].i + (uint32_t)R[ins.c].i); NEXT;
+        CASE(SUB_I) R[ins.a].i = wrap((uint32_t)R[ins.b].i - (uint32_t)R[ins.c].i); NEXT;
+        CASE(MUL_I) R[ins.a].i = wrap((uint32_t)R[ins.b].i * (uint32_t)R[ins.c].i); NEXT;
+        CASE(DIV_I) {
+            int64_t d = R[ins.c].i;
+            if (d == 0)
+                throw std::runtime_error("runtime error: division by zero");
+            //  int64 INT_MIN / -1 Ϊ INT_MIN
+            R[ins.a].i = wrap((uint32_t)(R[ins.b].i / d));
+            NEXT;
+        }
+        CASE(ADD_F) R[ins.a].f = R[ins.b].f + R[ins.c].f; NEXT;
+        CASE(SUB_F) R[ins.a].f = R[ins.b].f - R[ins.c].f; NEXT;
+        CASE(MUL_F) R[ins.a].f = R[ins.b].f * R[ins.c].f; NEXT;
+        CASE(DIV_F) R[ins.a].f = R[ins.b].f / R[ins.c].f; NEXT;
+
+        CASE(LT_I) R[ins.a].i = R[ins.b].i < R[ins.c].i; NEXT;
+        CASE(GT_I) R[ins.a].i = R[ins.b].i > R[ins.c].i; NEXT;
+        CASE(EQ_I) R[ins.a].i = R[ins.b].i == R[ins.c].i; NEXT;
+        CASE(NE_I) R[ins.a].i = R[ins.b].i != R[ins.c].i; NEXT;
+        CASE(LT_F) R[ins.a].i = R[ins.b].f < R[ins.c].f; NEXT;
+        CASE(GT_F) R[ins.a].i = R[ins.b].f > R[ins.c].f; NEXT;
+        CASE(EQ_F) R[ins.a].i = R[ins.b].f == R[ins.c].f; NEXT;
+        CASE(NE_F) R[ins.a].i = R[ins.b].f != R[ins.c].f; NEXT;
+        CASE(AND) R[ins.a].i = R[ins.b].i & R[ins.c].i; NEXT;
+        CASE(OR) R[ins.a].i = R[ins.b].i | R[ins.c].i; NEXT;
+
+        CASE(I2F) R[ins.a].f = (double)R[ins.b].i; NEXT;
+        CASE(F2I) R[ins.a].i = floatToInt(R[ins.b].f); NEXT;
+        CASE(I2C) R[ins.a].i = (int8_t)R[ins.b].i; NEXT;
+        CASE(I2B) R[ins.a].i = R[ins.b].i != 0; NEXT;
+        CASE(F2B) R[ins.a].i = R[ins.b].f != 0; NEXT;
+
+        CASE(JMP) JUMP(true);
+        CASE(JT) JUMP(R[ins.a].i != 0);
+        CASE(JF) JUMP(R[ins.a].i == 0);
+        CASE(JLT_I) JUMP(R[ins.a].i < R[ins.b].i);
+        CASE(JGE_I) JUMP(R[ins.a].i >= R[ins.b].i);
+        CASE(JGT_I) JUMP(R[ins.a].i > R[ins.b].i);
+        CASE(JLE_I) JUMP(R[ins.a].i <= R[ins.b].i);
+        CASE(JEQ_I) JUMP(R[ins.a].i == R[ins.b].i);
+        CASE(JNE_I) JUMP(R[ins.a].i != R[ins.b].i);
+
+        CASE(NEWARR) R[ins.a].p = newArray(R[ins.b].i); NEXT;
+        CASE(LOADE) R[ins.a] = *element(R[ins.b].p, R[ins.c].i); NEXT;
+        CASE(STOREE) *element(R[ins.a].p, R[ins.b].i) = R[ins.c]; NEXT;
+        CASE(ADDR) R[ins.a].p = &R[ins.b]; NEXT;
+        CASE(ADDRE) R[ins.a].p = element(R[ins.b].p, R[ins.c].i); NEXT;
+        CASE(LOADP) R[ins.a] = *R[ins.b].p; NEXT;
+        CASE(STOREP) *R[ins.a].p = R[ins.b]; NEXT;
+
+        CASE(CALL) {
+            const BcFunction& callee = prog.functions[ins.b];
+            const uint16_t* args = fn->argPool.data() + ins.c;
+            Value* base = R + fn->regs;
+            Tier tier = tiers[ins.b];
+            if (tier == Tier::NATIVE || (tier == Tier::INTERPRETED && ++hotness[ins.b] >= JIT_THRESHOLD && tierUp(ins.b))) {
+                for (uint16_t k = 0; k < args[0]; k++)
+                    base[k] = R[args[k + 1]];
+                Value v = callNative(ins.b, base, nullptr);
+                if (ins.a != BcInstr::NO_REG)
+                    R[ins.a] = v;
+                NEXT;
+            }
+            enter(callee, base);
+            for (uint16_t k = 0; k < args[0]; k++)
+                base[k] = R[args[k + 1]];
+            calls.push_back({ pc, R, fn, ins.a });
+            R = base;
+            fn = &callee;
+            pc = callee.code.data();
+            NEXT;
+        }
+        CASE(RET) {
+            result = R[ins.a];
+            goto leave;
+        }
+        CASE(RET_VOID) {
+            result.i = 0;
+            goto leave;
+        }
+
+        CASE(IN_I) input(Op::IN_I, R[ins.a]); NEXT;
+        CASE(IN_C) input(Op::IN_C, R[ins.a]); NEXT;
+        CASE(IN_F) input(Op::IN_F, R[ins.a]); NEXT;
+        CASE(OUT_I) print(Op::OUT_I, R[ins.a]); NEXT;
+        CASE(OUT_C) print(Op::OUT_C, R[ins.a]); NEXT;
+        CASE(OUT_F) print(Op::OUT_F, R[ins.a]); NEXT;
+
+    backedge: {
+            // ѱ루պôﵽֵʱŵǰ֡лشѭͷ
+            uint32_t index = (uint32_t)(fn - prog.functions.data());
+            Tier tier = tiers[index];
+            if (tier == Tier::NATIVE || (tier == Tier::INTERPRETED && ++hotness[index] >= JIT_THRESHOLD && tierUp(index))) {
+                result = callNative(index, R, code[index].pcAddress[pc - fn->code.data()]);
+                goto leave;
+            }
+        }
+        NEXT;
+
+    leave:
+        if (calls.size() == bottom)
+            return result;
+        {
+            CallInfo ci = calls.back();
+            calls.pop_back();
+            if (ci.dst != BcInstr::NO_REG)
+                ci.base[ci.dst] = result;
+            R = ci.base;
+            fn = ci.fn;
+            pc = ci.ret;
+        }
+        NEXT;
+#if !AYA_COMPUTED_GOTO
+            }
+        }
+#endif
+    }
+#undef CASE
+#undef NEXT
+#undef JUMP
+}
+
+// ---------- شʱ ----------
+
+int VM::nativeCall(void* ctx, Value* frame, uint32_t fn) {
+    VM* vm = (VM*)ctx;
+    size_t bottom = vm->calls.size();
+    try {
+        if (vm->tiers[fn] == Tier::INTERPRETED && ++vm->hotness[fn] >= JIT_THRESHOLD && vm->tierUp(fn))
+            return vm->natives[fn](ctx, frame, nullptr);
+        const BcFunction& callee = vm->prog.functions[fn];
+        frame[0] = vm->interpret(&callee, vm->enter(callee, frame));
+        return 1;
+    }
+    catch (const std::exception& ex) {
+        // 쳣ܴشջ֡Ϊ 0 㴫ȥ
+        vm->calls.resize(bottom);
+        vm->nativeError = ex.what();
+        return 0;
+    }
+}
+
+int VM::nativeNewArray(void* ctx, Value* dst, int64_t n) {
+    VM* vm = (VM*)ctx;
+    try {
+        dst->p = vm->newArray(n);
+        return 1;
+    }
+    catch (const std::exception& ex) {
+        vm->nativeError = ex.what();
+        return 0;
+    }
+}
+
+int VM::nativeInput(void* ctx, Value* dst, uint32_t op) {
+    ((VM*)ctx)->input((Op)op, *dst);
+    return 1;
+}
+
+int VM::nativeOutput(void* ctx, int64_t bits, uint32_t op) {
+    Value v;
+    v.i = bits;
+    try {
+        ((VM*)ctx)->print((Op)op, v);
+        return 1;
+    }
+    catch (const std::exception& ex) {
+        ((VM*)ctx)->nativeError = ex.what();
+        return 0;
+    }
+}
+
+void VM::nativeDivideError(void* ctx) {
+    ((VM*)ctx)->nativeError = "runtime error: division by zero";
+}
+
+void VM::nativeBoundsError(void* ctx, int64_t index, int64_t length) {
+    ((VM*)ctx)->nativeError = outOfRange(index, length);
+}
+
+void VM::nativeStackError(void* ctx) {
+    ((VM*)ctx)->nativeError = "runtime error: stack overflow";
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include "Bytecode.h"
+#include "Jit.h"
+
+/*
+* Ĵʽֽ
+* 壺ֱӽִ compileBytecode Ľrun Ҫⲿ
+* Լ
+*	֡ļĴһԤȷֵջϣֻƶַ֡ѭݹ
+*	GCC / Clang  computed goto ɣ˻ switch
+*	int 㰴 32 λƣ 0 Խ runtime_error
+*	д뻺ǰʱˢ
+*	ֲִУȽִУôѭ֮ʹﵽ JIT_THRESHOLD ʱɱش룻
+*	֮ĵֱӽ뱾ش룬ڽ͵֡һѭʱлȥ֡ͨã
+*/
+class VM {
+public:
+    static constexpr uint32_t JIT_THRESHOLD = 1000;
+
+    explicit VM(const BcProgram& prog);
+
+    // ִ main main  int ֵvoid main Ϊ 0
+    int run();
+
+    bool jit = true;            // رպִֻ
+    size_t jitCompiled = 0;     // ɱشĺ
+
+private:
+    struct CallInfo {
+        const BcInstr* ret;         // غִеָ
+        Value* base;                // ߵ֡
+        const BcFunction* fn;
+        uint16_t dst;               // ֵдߵĸĴ
+    };
+    enum class Tier : uint8_t { INTERPRETED, NATIVE, FAILED };
+
+    const BcProgram& prog;
+    std::vector<Value> stack;
+    Value* stackEnd;
+    char* nativeStackLimit = nullptr;
+    std::vector<CallInfo> calls;
+    std::vector<std::unique_ptr<Value[]>> arrays;   // ڳǰͷ
+    std::string output;
+
+    std::vector<uint32_t> hotness;
+    std::vector<Tier> tiers;
+    std::vector<NativeFunction> natives;            // شֱӰ±ȡС̶
+    std::vector<NativeCode> code;
+    std::unique_ptr<JitCompiler> compiler;
+    std::string nativeError;                        // شʱĴϢ
+
+    Value* enter(const BcFunction& fn, Value* base);
+    Value interpret(const BcFunction* fn, Value* R);
+    Value callNative(uint32_t index, Value* base, const void* resume);
+    bool tierUp(uint32_t index);
+    Value* newArray(int64_t n);
+    void input(Op op, Value& dst);
+    void print(Op op, Value v);
+    void flush();
+
+    // شõʱ JitRuntime
+    static int nativeCall(void* ctx, Value* frame, uint32_t fn);
+    static int nativeNewArray(void* ctx, Value* dst, int64_t n);
+    static int nativeInput(void* ctx, Value* dst, uint32_t op);
+    static int nativeOutput(void* ctx, int64_t bits, uint32_t op);
+    static void nativeDivideError(void* ctx);
+    static void nativeBoundsError(void* ctx, int64_t index, int64_t length);
+    static void nativeStackError(void* ctx);
+};
@@ -0,0 +1,1440 @@
+#include "X86Gen.h"
+#include "CFG.h"
+#include "RegAlloc.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Ĵһ
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+const char* const reg64[] = { "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+    "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15" };
+const char* const reg32[] = { "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+    "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d" };
+
+const Reg intArgRegs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+constexpr size_t INT_ARG_REGS = 6;
+constexpr size_t FLOAT_ARG_REGS = 8;
+
+std::string xmm(int n) {
+    return "%xmm" + std::to_string(n);
+}
+
+std::string imm(int64_t v) {
+    return "$" + std::to_string(v);
+}
+
+TokenType elementType(TokenType arr) {
+    switch (arr) {
+    case TokenType::ARR_INT:   return TokenType::INT;
+    case TokenType::ARR_FLOAT: return TokenType::FLOAT;
+    case TokenType::ARR_CHAR:  return TokenType::CHAR;
+    case TokenType::ARR_BOOL:  return TokenType::BOOL;
+    default:                   return TokenType::UNKNOWN;
+    }
+}
+
+// еĺĸ֡»ԭֽд _xx
+std::string functionLabel(SymId name) {
+    static const char hex[] = "0123456789abcdef";
+    std::string s = "aya_";
+    for (unsigned char c : symName(name)) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')
+            s += (char)c;
+        else {
+            s += '_';
+            s += hex[c >> 4];
+            s += hex[c & 15];
+        }
+    }
+    return s;
+}
+
+/*
+* ɨļĴ
+* rax rcx rdx rdi r10 r11  xmm0 xmm1 ָ뱾rax / xmm0 ͬʱƲƶĻ
+* ߱ǰ棬òϱ߱ļĴͲﱣ
+*/
+RegisterFile x86Registers() {
+    RegisterFile rf;
+    for (Reg r : { RSI, R8, R9 })
+        rf.regs[(int)RegClass::INT].push_back({ r, true });
+    for (Reg r : { RBX, R12, R13, R14, R15 })
+        rf.regs[(int)RegClass::INT].push_back({ r, false });
+    for (uint8_t x = 2; x < 16; x++)
+        rf.regs[(int)RegClass::FLOAT].push_back({ x, true });
+    rf.scratch[(int)RegClass::INT] = RAX;
+    rf.scratch[(int)RegClass::FLOAT] = 0;
+    // ʱͨһصԼ
+    rf.clobbers = [](const IRInstruction& instr) {
+        return instr.type == IRType::CALL || instr.type == IRType::ALLOC_ARR ||
+            instr.type == IRType::INPUT || instr.type == IRType::OUTPUT;
+    };
+    return rf;
+}
+
+// ֵchar  C++  char ضΪ 8 λ
+bool intImmediate(const Operand& o, int64_t& v) {
+    if (o.kind == OperandKind::INT)
+        v = o.i;
+    else if (o.kind == OperandKind::CHAR)
+        v = (int8_t)o.i;
+    else
+        return false;
+    return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+/*
+* ʱ
+* д 4KB ǰͳʱˢ£ cin  cout Чһ£
+* ֻĶ߱ļĴ
+*/
+const char* const runtimeAsm = R"(
+# ---------- ʱ ----------
+	.text
+# д
+aya_flush:
+	movq	aya_outlen(%rip), %rdx
+	leaq	aya_outbuf(%rip), %rsi
+1:	testq	%rdx, %rdx
+	jz	2f
+	movl	$1, %edi
+	movl	$1, %eax		# write
+	syscall
+	testq	%rax, %rax
+	jle	2f
+	addq	%rax, %rsi
+	subq	%rax, %rdx
+	jmp	1b
+2:	movq	$0, aya_outlen(%rip)
+	ret
+
+# rsi = , rdx = ֽ
+aya_write:
+	pushq	%r12
+	pushq	%r13
+	movq	%rsi, %r12
+	movq	%rdx, %r13
+1:	testq	%r13, %r13
+	jz	3f
+	movq	aya_outlen(%rip), %rax
+	cmpq	$4096, %rax
+	jb	2f
+	call	aya_flush
+	xorl	%eax, %eax
+2:	leaq	aya_outbuf(%rip), %rcx
+	movb	(%r12), %dl
+	movb	%dl, (%rcx,%rax)
+	incq	%rax
+	movq	%rax, aya_outlen(%rip)
+	incq	%r12
+	decq	%r13
+	jmp	1b
+3:	popq	%r13
+	popq	%r12
+	ret
+
+# dil = ַ
+aya_print_char:
+	subq	$24, %rsp
+	movb	%dil, (%rsp)
+	movq	%rsp, %rsi
+	movl	$1, %edx
+	call	aya_write
+	addq	$24, %rsp
+	ret
+
+# rdi = з
+aya_print_int:
+	subq	$40, %rsp
+	movq	%rdi, %rax
+	leaq	32(%rsp), %rsi
+	movl	$10, %ecx
+	testq	%rax, %rax
+	jns	1f
+	negq	%rax
+1:	xorl	%edx, %edx
+	divq	%rcx
+	addb	$48, %dl		# '0'
+	decq	%rsi
+	movb	%dl, (%rsi)
+	testq	%rax, %rax
+	jnz	1b
+	testq	%rdi, %rdi
+	jns	2f
+	decq	%rsi
+	movb	$45, (%rsi)		# '-'
+2:	leaq	32(%rsp), %rdx
+	subq	%rsi, %rdx
+	call	aya_write
+	addq	$40, %rsp
+	ret
+
+# xmm0 = double %g  6 λЧ
+# Ȱ x ų 17 λҵ y = x * 10^k뵽 6 λͽǡһȡż printf һ£
+# 1e-39 ~ 1e43 ֮ y β 5 ݾȷһγ˻Աе 10 ݣ ulp
+# ıд 0(%rsp) 6 λַ 32(%rsp) 
+aya_print_float:
+	subq	$56, %rsp
+	movq	%rsp, %rdi
+	movq	%xmm0, %rax
+	btrq	$63, %rax
+	jnc	1f
+	movb	$45, (%rdi)		# '-'
+	incq	%rdi
+1:	movq	%rax, %xmm0
+	movq	%rax, %rcx
+	shrq	$52, %rcx
+	cmpq	$0x7ff, %rcx
+	jne	3f
+	shlq	$12, %rax		# β 0 Ϊ nan
+	jnz	2f
+	movl	$0x666e69, (%rdi)	# "inf"
+	addq	$3, %rdi
+	jmp	.Lpf_out
+2:	movl	$0x6e616e, (%rdi)	# "nan"
+	addq	$3, %rdi
+	jmp	.Lpf_out
+3:	testq	%rax, %rax
+	jnz	4f
+	movb	$48, (%rdi)
+	incq	%rdi
+	jmp	.Lpf_out
+4:	xorl	%r10d, %r10d		# Ԥȳ˹ 10 ݴ
+	movq	%rax, %rcx
+	shrq	$52, %rcx
+	cmpl	$60, %ecx		# x < 2^-963ǹʱȳ 1e32ֻһ
+	jae	5f
+	mulsd	.Laya_pow10+256(%rip), %xmm0
+	movl	$32, %r10d
+	movq	%xmm0, %rax
+	movq	%rax, %rcx
+	shrq	$52, %rcx
+5:	subl	$1023, %ecx
+	imull	$78913, %ecx, %ecx
+	sarl	$18, %ecx		# e0 = floor(ָ * log10(2))ʮָΪ e0  e0 + 1
+	movl	$16, %esi
+	subl	%ecx, %esi		# k = 16 - e0y = x * 10^k  [1e16, 1e18)
+	subl	%r10d, %ecx
+	movl	%ecx, %r10d
+	leal	27(%rsi), %ecx
+	cmpl	$82, %ecx
+	ja	.Lpf_table
+	movq	%rax, %r8		# -27 <= k <= 55y = m * 2^(b + k) * 5^k ȷ
+	shrq	$52, %r8
+	shlq	$12, %rax
+	shrq	$12, %rax
+	btsq	$52, %rax		# β mx = m * 2^bb = ָ - 1075
+	leal	-1075(%r8,%rsi), %ecx
+	leaq	.Laya_pow5(%rip), %r9
+	xorl	%r11d, %r11d
+	testl	%esi, %esi
+	jns	25f
+	xorl	%edx, %edx		# k < 0 ʱ b + k >= 0(m << (b + k)) / 5^-k
+	shldq	%cl, %rax, %rdx
+	shlq	%cl, %rax
+	testb	$64, %cl
+	jz	26f
+	movq	%rax, %rdx
+	xorl	%eax, %eax
+26:	negl	%esi
+	divq	(%r9,%rsi,8)
+	movq	%rdx, %r11
+	jmp	.Lpf_round
+25:	cmpl	$27, %esi
+	ja	27f
+	mulq	(%r9,%rsi,8)
+	testl	%ecx, %ecx
+	js	6f
+	shlq	%cl, %rax
+	jmp	.Lpf_round
+6:	negl	%ecx			# Ʋ 61 λƳλ r11
+	movl	$1, %r11d
+	shlq	%cl, %r11
+	decq	%r11
+	andq	%rax, %r11
+	shrdq	%cl, %rdx, %rax
+	jmp	.Lpf_round
+27:	subl	$28, %esi		# k >= 28 ʱ 5^k ռ 64 λ˻ 192 λ 61 ~ 127 λ
+	shll	$4, %esi
+	movq	%rax, %r8
+	leaq	.Laya_pow5w(%rip), %r9
+	addq	%rsi, %r9
+	mulq	(%r9)
+	movq	%rax, %r11		#  64 λƳ
+	movq	%rdx, %rsi
+	movq	%r8, %rax
+	mulq	8(%r9)
+	addq	%rsi, %rax
+	adcq	$0, %rdx
+	negl	%ecx
+	cmpl	$64, %ecx
+	jae	28f
+	movl	$1, %esi
+	shlq	%cl, %rsi
+	decq	%rsi
+	andq	%r11, %rsi
+	shrdq	%cl, %rax, %r11
+	movq	%r11, %rax
+	movq	%rsi, %r11
+	jmp	.Lpf_round
+28:	subl	$64, %ecx
+	movl	$1, %esi
+	shlq	%cl, %rsi
+	decq	%rsi
+	andq	%rax, %rsi
+	orq	%rsi, %r11
+	shrdq	%cl, %rdx, %rax
+	jmp	.Lpf_round
+.Lpf_table:				# һγ˻Աе 10 
+	leaq	.Laya_pow10(%rip), %r9
+	testl	%esi, %esi
+	js	7f
+	mulsd	(%r9,%rsi,8), %xmm0
+	jmp	20f
+7:	negl	%esi
+	divsd	(%r9,%rsi,8), %xmm0
+20:	cvttsd2si	%xmm0, %rax
+	xorl	%r11d, %r11d
+.Lpf_round:				# rax = y ֣r11  0 ʾС
+	movl	%r10d, %ecx
+	movabsq	$100000000000, %r8	# y  17 λʱȥ 11 λ
+	movabsq	$10000000000000000, %r9
+	cmpq	%r9, %rax
+	jae	21f
+	movabsq	$10000000000, %r8	# ˱еʱֻ 16 λ
+	decl	%ecx
+	jmp	22f
+21:	movabsq	$100000000000000000, %r9
+	cmpq	%r9, %rax
+	jb	22f
+	movabsq	$1000000000000, %r8	# 18 λ
+	incl	%ecx
+22:	xorl	%edx, %edx
+	divq	%r8
+	shrq	$1, %r8
+	cmpq	%r8, %rdx		#  printf ͬͽ룬ǡһʱȡż
+	jb	24f
+	ja	23f
+	testq	%r11, %r11
+	jnz	23f
+	testb	$1, %al
+	jz	24f
+23:	incq	%rax
+24:	cmpq	$1000000, %rax
+	jb	8f
+	movl	$100000, %eax
+	incl	%ecx
+8:	movl	$10, %r9d
+	movl	$5, %esi
+9:	xorl	%edx, %edx
+	divq	%r9
+	addb	$48, %dl
+	movb	%dl, 32(%rsp,%rsi)
+	decq	%rsi
+	jns	9b
+	movl	$5, %r8d		# r8 = һ 0 
+10:	cmpb	$48, 32(%rsp,%r8)
+	jne	11f
+	decl	%r8d
+	jmp	10b
+11:	cmpl	$-4, %ecx
+	jl	.Lpf_sci
+	cmpl	$6, %ecx
+	jge	.Lpf_sci
+	testl	%ecx, %ecx
+	js	.Lpf_small
+	xorl	%esi, %esi		# 㣺 e + 1 λ
+12:	movb	32(%rsp,%rsi), %dl
+	movb	%dl, (%rdi)
+	incq	%rdi
+	incl	%esi
+	cmpl	%ecx, %esi
+	jle	12b
+	cmpl	%ecx, %r8d
+	jle	.Lpf_out
+	movb	$46, (%rdi)		# '.'
+	incq	%rdi
+13:	movb	32(%rsp,%rsi), %dl
+	movb	%dl, (%rdi)
+	incq	%rdi
+	incl	%esi
+	cmpl	%r8d, %esi
+	jle	13b
+	jmp	.Lpf_out
+.Lpf_small:				# 0.000dddǰ 0  -e-1 
+	movw	$0x2e30, (%rdi)		# "0."
+	addq	$2, %rdi
+	movl	%ecx, %esi
+	incl	%esi
+14:	testl	%esi, %esi
+	jz	15f
+	movb	$48, (%rdi)
+	incq	%rdi
+	incl	%esi
+	jmp	14b
+15:	movb	32(%rsp,%rsi), %dl
+	movb	%dl, (%rdi)
+	incq	%rdi
+	incl	%esi
+	cmpl	%r8d, %esi
+	jle	15b
+	jmp	.Lpf_out
+.Lpf_sci:				# d.ddddde+XX
+	movb	32(%rsp), %dl
+	movb	%dl, (%rdi)
+	incq	%rdi
+	testl	%r8d, %r8d
+	jz	17f
+	movb	$46, (%rdi)
+	incq	%rdi
+	movl	$1, %esi
+16:	movb	32(%rsp,%rsi), %dl
+	movb	%dl, (%rdi)
+	incq	%rdi
+	incl	%esi
+	cmpl	%r8d, %esi
+	jle	16b
+17:	movb	$101, (%rdi)		# 'e'
+	incq	%rdi
+	movb	$43, %dl		# '+'
+	testl	%ecx, %ecx
+	jns	18f
+	movb	$45, %dl
+	negl	%ecx
+18:	movb	%dl, (%rdi)
+	incq	%rdi
+	movl	%ecx, %eax		# ָλ
+	cmpl	$100, %eax
+	jb	19f
+	xorl	%edx, %edx
+	movl	$100, %r9d
+	divl	%r9d
+	addb	$48, %al
+	movb	%al, (%rdi)
+	incq	%rdi
+	movl	%edx, %eax
+19:	xorl	%edx, %edx
+	movl	$10, %r9d
+	divl	%r9d
+	addb	$48, %al
+	movb	%al, (%rdi)
+	addb	$48, %dl
+	movb	%dl, 1(%rdi)
+	addq	$2, %rdi
+.Lpf_out:
+	movq	%rsp, %rsi
+	movq	%rdi, %rdx
+	subq	%rsi, %rdx
+	call	aya_write
+	addq	$56, %rsp
+	ret
+
+# һֽڵȡߣeax = ֽڣļβΪ -1
+aya_peekc:
+	movq	aya_inpos(%rip), %rax
+	cmpq	aya_inlen(%rip), %rax
+	jb	2f
+	call	aya_flush
+	xorl	%edi, %edi
+	leaq	aya_inbuf(%rip), %rsi
+	movl	$4096, %edx
+	xorl	%eax, %eax		# read
+	syscall
+	testq	%rax, %rax
+	jg	1f
+	movl	$-1, %eax
+	ret
+1:	movq	%rax, aya_inlen(%rip)
+	movq	$0, aya_inpos(%rip)
+	xorl	%eax, %eax
+2:	leaq	aya_inbuf(%rip), %rcx
+	movzbl	(%rcx,%rax), %eax
+	ret
+
+aya_skipws:
+1:	call	aya_peekc
+	cmpl	$32, %eax
+	je	2f
+	cmpl	$9, %eax		# \t \n \v \f \r
+	jl	3f
+	cmpl	$13, %eax
+	jg	3f
+2:	incq	aya_inpos(%rip)
+	jmp	1b
+3:	ret
+
+# rax =  intûʱΪ 0
+aya_read_int:
+	pushq	%rbx
+	pushq	%r12
+	call	aya_skipws
+	xorl	%ebx, %ebx
+	xorl	%r12d, %r12d
+	call	aya_peekc
+	cmpl	$45, %eax		# '-'
+	jne	1f
+	movl	$1, %r12d
+	jmp	2f
+1:	cmpl	$43, %eax		# '+'
+	jne	3f
+2:	incq	aya_inpos(%rip)
+3:	call	aya_peekc
+	subl	$48, %eax
+	cmpl	$9, %eax
+	ja	4f
+	imulq	$10, %rbx
+	addq	%rax, %rbx
+	incq	aya_inpos(%rip)
+	jmp	3b
+4:	movq	%rbx, %rax
+	testl	%r12d, %r12d
+	jz	5f
+	negq	%rax
+5:	movslq	%eax, %rax
+	popq	%r12
+	popq	%rbx
+	ret
+
+# rax = ַհףļβΪ 0
+aya_read_char:
+	call	aya_skipws
+	call	aya_peekc
+	testl	%eax, %eax
+	jns	1f
+	xorl	%eax, %eax
+	ret
+1:	incq	aya_inpos(%rip)
+	movsbq	%al, %rax
+	ret
+
+# xmm0 =  doubleβȡ 18 λֻʮָ
+aya_read_float:
+	pushq	%rbx
+	pushq	%r12
+	pushq	%r13
+	pushq	%r14
+	call	aya_skipws
+	xorl	%ebx, %ebx		# β
+	xorl	%r12d, %r12d		# 
+	xorl	%r13d, %r13d		# ʮָ
+	xorl	%r14d, %r14d		# βλ
+	call	aya_peekc
+	cmpl	$45, %eax
+	jne	1f
+	movl	$1, %r12d
+	jmp	2f
+1:	cmpl	$43, %eax
+	jne	3f
+2:	incq	aya_inpos(%rip)
+3:	call	aya_peekc		# 
+	subl	$48, %eax
+	cmpl	$9, %eax
+	ja	4f
+	call	.Lrf_digit
+	jmp	3b
+4:	cmpl	$-2, %eax		# '.'
+	jne	6f
+	incq	aya_inpos(%rip)
+5:	call	aya_peekc		# С
+	subl	$48, %eax
+	cmpl	$9, %eax
+	ja	6f
+	call	.Lrf_digit
+	decl	%r13d
+	jmp	5b
+6:	cmpl	$53, %eax		# 'e'
+	je	7f
+	cmpl	$21, %eax		# 'E'
+	jne	8f
+7:	incq	aya_inpos(%rip)
+	call	aya_read_int
+	addl	%eax, %r13d
+8:	cvtsi2sdq	%rbx, %xmm0
+	movsd	.Laya_ten(%rip), %xmm1
+9:	testl	%r13d, %r13d
+	jz	11f
+	js	10f
+	mulsd	%xmm1, %xmm0
+	decl	%r13d
+	jmp	9b
+10:	divsd	%xmm1, %xmm0
+	incl	%r13d
+	jmp	9b
+11:	testl	%r12d, %r12d
+	jz	12f
+	movq	%xmm0, %rax
+	btcq	$63, %rax
+	movq	%rax, %xmm0
+12:	popq	%r14
+	popq	%r13
+	popq	%r12
+	popq	%rbx
+	ret
+.Lrf_digit:				# eax = ֣ȡ߸ַ
+	incq	aya_inpos(%rip)
+	cmpl	$18, %r14d
+	jae	1f
+	imulq	$10, %rbx
+	addq	%rax, %rbx
+	incl	%r14d
+	ret
+1:	incl	%r13d
+	ret
+
+# rdi = ֽrax = ڴ棻ʱϵͳӳ 1MB
+aya_alloc:
+	addq	$15, %rdi
+	andq	$-16, %rdi
+	movq	aya_heap(%rip), %rax
+	leaq	(%rax,%rdi), %rdx
+	cmpq	aya_heapend(%rip), %rdx
+	jbe	2f
+	movl	$0x100000, %esi
+	cmpq	%rsi, %rdi
+	cmova	%rdi, %rsi
+	pushq	%rdi
+	pushq	%rsi
+	xorl	%edi, %edi
+	movl	$3, %edx		# PROT_READ | PROT_WRITE
+	movl	$0x22, %r10d		# MAP_PRIVATE | MAP_ANONYMOUS
+	movq	$-1, %r8
+	xorl	%r9d, %r9d
+	movl	$9, %eax		# mmap
+	syscall
+	popq	%rsi
+	popq	%rdi
+	cmpq	$-4096, %rax
+	ja	1f
+	leaq	(%rax,%rsi), %rdx
+	movq	%rdx, aya_heapend(%rip)
+	leaq	(%rax,%rdi), %rdx
+	jmp	2f
+1:	call	aya_flush
+	movl	$1, %edi
+	movl	$60, %eax		# exit(1)
+	syscall
+2:	movq	%rdx, aya_heap(%rip)
+	ret
+
+	.data
+	.align	8
+aya_outlen:	.quad	0
+aya_inpos:	.quad	0
+aya_inlen:	.quad	0
+aya_heap:	.quad	0
+aya_heapend:	.quad	0
+
+	.bss
+	.align	16
+aya_outbuf:	.skip	4096
+aya_inbuf:	.skip	4096
+
+	.section	.rodata
+	.align	8
+.Laya_ten:	.double	10.0
+)";
+
+// aya_print_float ı10^0 ~ 10^308ͽ double5^0 ~ 5^27  5^28 ~ 5^55͡ 64 λʱ .rodata ֮
+void emitPowerTables(std::ostream& out) {
+    out << ".Laya_pow10:";
+    for (int k = 0; k <= 308; k++) {
+        double v = std::strtod(("1e" + std::to_string(k)).c_str(), nullptr);
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof bits);
+        out << (k % 4 ? ", " : "\n\t.quad\t") << bits;
+    }
+    out << "\n.Laya_pow5:";
+    uint64_t lo = 1, hi = 0;
+    for (int k = 0; k <= 55; k++) {
+        if (k <= 27)
+            out << (k % 4 ? ", " : "\n\t.quad\t") << lo;
+        else
+            out << (k == 28 ? "\n.Laya_pow5w:" : "") << (k % 2 ? ", " : "\n\t.quad\t") << lo << ", " << hi;
+        uint64_t lo4 = lo << 2;     // (hi, lo) *= 5
+        uint64_t carry = lo >> 62;
+        lo += lo4;
+        carry += lo < lo4;
+        hi = hi * 5 + carry;
+    }
+    out << "\n";
+}
+
+/*
+*  IR ɻ
+* ÿ TEMP / VAR ջ֡ռһ 8 ֽڲλ rbp ƫƣջϴĲֱõѹջλ
+* ĴʱֵڷֵĴֱüĴʱڲλ
+* ָ rax / xmm0 㣬ٰĿתдء룻
+* r10 / r11 ֻ ref βԪصĵַ
+*/
+class AsmWriter {
+public:
+    AsmWriter(IRProgram& prog, std::ostream& out, bool allocate) :prog(prog), out(out), allocate(allocate) {
+        for (const IRFunction& f : prog.getFunctions())
+            functions[f.name] = &f;
+    }
+
+    void run() {
+        checkTopLevel();
+        auto mainIt = std::find_if(prog.getFunctions().begin(), prog.getFunctions().end(),
+            [](const IRFunction& f) { return symName(f.name) == "main"; });
+        if (mainIt == prog.getFunctions().end())
+            throw std::runtime_error("native backend: no main function");
+
+        out << "# Ayanami x86-64 (GAS)\n";
+        out << "\t.text\n\t.globl\t_start\n_start:\n";
+        ins("xorl", "%ebp", "%ebp");
+        ins("call", functionLabel(mainIt->name));
+        if (isIntegral(mainIt->retType))
+            ins("movl", "%eax", "%ebx");
+        else
+            ins("xorl", "%ebx", "%ebx");
+        ins("call", "aya_flush");
+        ins("movl", "%ebx", "%edi");
+        ins("movl", "$60", "%eax");
+        ins("syscall");
+
+        for (size_t k = 0; k < prog.getFunctions().size(); k++)
+            genFunction(prog.getFunctions()[k], k);
+
+        out << runtimeAsm;
+        emitPowerTables(out);
+        if (!floatConsts.empty()) {
+            out << "\n\t.section\t.rodata\n\t.align\t8\n";
+            for (auto& c : floatConsts)
+                out << ".LC" << c.second << ":\t.quad\t" << c.first << "\n";
+        }
+    }
+
+private:
+    IRProgram& prog;
+    std::ostream& out;
+    bool allocate;
+    RegisterFile registers = x86Registers();
+    std::unordered_map<SymId, const IRFunction*> functions;
+    std::map<uint64_t, uint32_t> floatConsts;   // double λ -> 
+
+    // ǰ
+    const IRFunction* fn = nullptr;
+    size_t fnIndex = 0;
+    std::unordered_map<uint64_t, int32_t> slots;        // operandKey ->  rbp ƫ
+    std::unordered_map<SymId, TokenType> varTypes;
+    std::unordered_set<SymId> refParams;
+    int32_t frameBottom = 0;                            // õƫ
+    int32_t frameSize = 0;
+    RegAllocation alloc;
+    uint32_t curInstr = 0;                              // ڷָ±
+    std::vector<std::pair<Reg, int32_t>> savedRegs;     // ߱ļĴλ
+    std::vector<std::pair<std::string, uint32_t>> stubs;    // תϵƶǩתָ
+
+    static bool isIntegral(TokenType t) {
+        return t == TokenType::INT || t == TokenType::CHAR || t == TokenType::BOOL;
+    }
+
+    // C++ ˻Ѻдļ޴ţֱӱ
+    void checkTopLevel() {
+        const auto& code = prog.getInstructions();
+        std::vector<char> inside(code.size(), 0);
+        for (const IRFunction& f : prog.getFunctions())
+            for (uint32_t i = f.begin; i <= f.end; i++)
+                inside[i] = 1;
+        for (size_t i = 0; i < code.size(); i++)
+            if (!inside[i])
+                throw std::runtime_error("native backend: statements outside functions are not supported");
+    }
+
+    void ins(const char* op) {
+        out << '\t' << op << '\n';
+    }
+    void ins(const char* op, const std::string& a) {
+        out << '\t' << op << '\t' << a << '\n';
+    }
+    void ins(const char* op, const std::string& a, const std::string& b) {
+        out << '\t' << op << '\t' << a << ", " << b << '\n';
+    }
+
+    std::string label(const Operand& l) const {
+        return ".L" + std::to_string(l.id);
+    }
+
+    std::string floatConst(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof bits);
+        auto it = floatConsts.emplace(bits, (uint32_t)floatConsts.size()).first;
+        return ".LC" + std::to_string(it->second) + "(%rip)";
+    }
+
+    TokenType typeOf(const Operand& o) const {
+        switch (o.kind) {
+        case OperandKind::TEMP:
+            return prog.tempType(o.id);
+        case OperandKind::VAR: {
+            auto it = varTypes.find(o.id);
+            return it == varTypes.end() ? TokenType::INT : it->second;
+        }
+        case OperandKind::FLOAT:
+            return TokenType::FLOAT;
+        case OperandKind::CHAR:
+            return TokenType::CHAR;
+        case OperandKind::ELEM:
+            return elementType(typeOf(Operand::var(o.id)));
+        default:
+            return TokenType::INT;
+        }
+    }
+
+    // ---------- ջ֡ ----------
+
+    void layoutFrame() {
+        slots.clear();
+        varTypes.clear();
+        refParams.clear();
+        frameBottom = 0;
+        auto slotOf = [&](const Operand& o) {
+            if (slots.emplace(operandKey(o), frameBottom - 8).second)
+                frameBottom -= 8;
+        };
+
+        size_t ints = 0, floats = 0, stacked = 0;
+        for (const Param& p : fn->params) {
+            Operand v = Operand::var(p.name);
+            varTypes[p.name] = p.type;
+            if (p.isRef)
+                refParams.insert(p.name);
+            bool inXmm = !p.isRef && p.type == TokenType::FLOAT;
+            if (inXmm ? floats++ < FLOAT_ARG_REGS : ints++ < INT_ARG_REGS)
+                slotOf(v);
+            else
+                slots[operandKey(v)] = 16 + 8 * (int32_t)stacked++;
+        }
+
+        auto& code = prog.getInstructions();
+        for (uint32_t i = fn->begin + 1; i < fn->end; i++) {
+            IRInstruction instr = code[i];
+            if (Operand* d = defOf(instr)) {
+                if (d->isVar())
+                    varTypes.emplace(d->id, instr.resType);
+                slotOf(*d);
+            }
+            forEachUse(prog, instr, [&](Operand& o) { slotOf(o); });
+            // Ԫде鱾
+            auto arrayOf = [&](const Operand& o) {
+                if (o.kind == OperandKind::ELEM)
+                    slotOf(Operand::var(o.id));
+            };
+            arrayOf(instr.result);
+            arrayOf(instr.op1);
+            arrayOf(instr.op2);
+            if (instr.type == IRType::CALL) {
+                const Operand* a = prog.args(instr);
+                for (uint32_t k = 0; k < instr.argCount; k++)
+                    arrayOf(a[k]);
+            }
+        }
+    }
+
+    // ĴΪõı߱Ĵλ
+    void allocateFrameRegisters() {
+        alloc = RegAllocation();
+        savedRegs.clear();
+        if (allocate) {
+            alloc = allocateRegisters(prog, *fn, registers,
+                [&](const Operand& o) { return typeOf(o) == TokenType::FLOAT ? RegClass::FLOAT : RegClass::INT; });
+            for (uint8_t r : alloc.usedRegisters(RegClass::INT))
+                for (const RegisterFile::Register& info : registers.regs[(int)RegClass::INT])
+                    if (info.id == r && !info.callerSaved) {
+                        frameBottom -= 8;
+                        savedRegs.push_back({ (Reg)r, frameBottom });
+                    }
+        }
+        frameSize = (-frameBottom + 15) & ~15;
+    }
+
+    std::string slotPlace(uint64_t key) const {
+        return std::to_string(slots.at(key)) + "(%rbp)";
+    }
+
+    std::string locationName(uint64_t key, RegClass cls, Location loc) const {
+        if (loc.kind == Location::STACK)
+            return slotPlace(key);
+        return cls == RegClass::FLOAT ? xmm(loc.reg) : reg64[loc.reg];
+    }
+
+    void emitMoves(const std::vector<Move>& moves) {
+        for (const Move& m : moves) {
+            const char* op = "movq";
+            if (m.cls == RegClass::FLOAT)
+                op = m.from.kind == Location::REG && m.to.kind == Location::REG ? "movapd" : "movsd";
+            ins(op, locationName(m.value, m.cls, m.from), locationName(m.value, m.cls, m.to));
+        }
+    }
+
+    // תĿ꣺Ҫƶʱ׮׮ںĩβƶȥ
+    std::string branchTarget(const IRInstruction& instr) {
+        if (alloc.movesOnExit(curInstr, true).empty())
+            return label(instr.result);
+        std::string stub = ".Lm" + std::to_string(fnIndex) + "_" + std::to_string(stubs.size());
+        stubs.push_back({ stub, curInstr });
+        return stub;
+    }
+
+    // ----------  ----------
+
+    // ڵڴλãref βκԪȰѵַ r11± r10
+    std::string place(const Operand& o) {
+        if (o.kind == OperandKind::ELEM)
+            return elementPlace(Operand::var(o.id), o.elemIndex());
+        Location loc = alloc.at(o, curInstr);
+        if (loc.kind == Location::REG)
+            return typeOf(o) == TokenType::FLOAT ? xmm(loc.reg) : reg64[loc.reg];
+        auto it = slots.find(operandKey(o));
+        if (it == slots.end())
+            throw std::runtime_error("native backend: no storage for " + prog.str(o));
+        std::string mem = std::to_string(it->second) + "(%rbp)";
+        if (o.isVar() && refParams.count(o.id)) {
+            ins("movq", mem, "%r11");
+            return "(%r11)";
+        }
+        return mem;
+    }
+
+    std::string elementPlace(const Operand& arr, const Operand& index) {
+        int64_t k;
+        if (intImmediate(index, k)) {
+            loadInt(arr, R11);
+            return std::to_string(k * 8) + "(%r11)";
+        }
+        loadInt(index, R10);
+        loadInt(arr, R11);
+        return "(%r11,%r10,8)";
+    }
+
+    //  rfloat  0 ضϣ
+    void loadInt(const Operand& o, Reg r) {
+        int64_t v;
+        if (intImmediate(o, v)) {
+            if (v == 0)
+                ins("xorl", reg32[r], reg32[r]);
+            else
+                ins("movq", imm(v), reg64[r]);
+            return;
+        }
+        if (o.kind == OperandKind::FLOAT) {
+            ins("movq", imm(std::fabs(o.f) < 2147483648.0 ? (int32_t)o.f : INT32_MIN), reg64[r]);
+            return;
+        }
+        std::string p = place(o);
+        if (typeOf(o) == TokenType::FLOAT) {
+            ins("cvttsd2si", p, reg32[r]);
+            ins("movslq", reg32[r], reg64[r]);
+        }
+        else
+            ins("movq", p, reg64[r]);
+    }
+
+    //  double  xmm
+    void loadFloat(const Operand& o, int x) {
+        if (o.isImm()) {
+            double v = o.kind == OperandKind::FLOAT ? o.f :
+                (double)(o.kind == OperandKind::CHAR ? (int8_t)o.i : o.i);
+            if (v == 0 && !std::signbit(v))
+                ins("xorpd", xmm(x), xmm(x));
+            else
+                ins("movsd", floatConst(v), xmm(x));
+            return;
+        }
+        std::string p = place(o);
+        if (typeOf(o) == TokenType::FLOAT)
+            ins("movsd", p, xmm(x));
+        else
+            ins("cvtsi2sdq", p, xmm(x));
+    }
+
+    // Ͷ rax  xmm0
+    TokenType loadValue(const Operand& o) {
+        TokenType t = typeOf(o);
+        if (t == TokenType::FLOAT)
+            loadFloat(o, 0);
+        else
+            loadInt(o, RAX);
+        return t;
+    }
+
+    /*
+    *  rax / xmm0  from ͵ֵ C++ ʽת to 
+    * ؽǷ xmm0
+    */
+    bool convert(TokenType from, TokenType to) {
+        bool fromFloat = from == TokenType::FLOAT;
+        switch (to) {
+        case TokenType::FLOAT:
+            if (!fromFloat)
+                ins("cvtsi2sdq", "%rax", "%xmm0");
+            return true;
+        case TokenType::INT:
+            if (fromFloat) {
+                ins("cvttsd2si", "%xmm0", "%eax");
+                ins("movslq", "%eax", "%rax");
+            }
+            return false;
+        case TokenType::CHAR:
+            if (fromFloat)
+                ins("cvttsd2si", "%xmm0", "%eax");
+            if (from != TokenType::CHAR && from != TokenType::BOOL)
+                ins("movsbq", "%al", "%rax");
+            return false;
+        case TokenType::BOOL:
+            if (from == TokenType::BOOL)
+                return false;
+            truthOfValue(fromFloat);
+            ins("movzbl", "%al", "%eax");
+            return false;
+        default:
+            return fromFloat;
+        }
+    }
+
+    // rax / xmm0 еֵǷ 0 alfloat  NaN Ϊ棩
+    void truthOfValue(bool isFloat) {
+        if (isFloat) {
+            ins("xorpd", "%xmm1", "%xmm1");
+            ins("ucomisd", "%xmm1", "%xmm0");
+            ins("setne", "%al");
+            ins("setp", "%cl");
+            ins("orb", "%cl", "%al");
+        }
+        else {
+            ins("testq", "%rax", "%rax");
+            ins("setne", "%al");
+        }
+    }
+
+    //  rax / xmm0  from ͵ֵд dst
+    void store(const Operand& dst, TokenType from) {
+        bool inXmm = convert(from, typeOf(dst));
+        std::string p = place(dst);
+        if (inXmm)
+            ins("movsd", "%xmm0", p);
+        else
+            ins("movq", "%rax", p);
+    }
+
+    // ---------- ָ ----------
+
+    void genFunction(const IRFunction& f, size_t k) {
+        fn = &f;
+        fnIndex = k;
+        layoutFrame();
+        allocateFrameRegisters();
+        stubs.clear();
+
+        out << "\n# " << symName(f.name) << "\n";
+        if (allocate)
+            out << "# regalloc: " << alloc.values << " values, " << alloc.splits << " splits, "
+            << alloc.spilled << " spilled\n";
+        out << functionLabel(f.name) << ":\n";
+        ins("pushq", "%rbp");
+        ins("movq", "%rsp", "%rbp");
+        if (frameSize)
+            ins("subq", imm(frameSize), "%rsp");
+
+        // ĴĲԼĲλ
+        size_t ints = 0, floats = 0;
+        for (const Param& p : f.params) {
+            std::string slot;
+            auto it = slots.find(operandKey(Operand::var(p.name)));
+            if (it->second < 0)
+                slot = std::to_string(it->second) + "(%rbp)";
+            if (!p.isRef && p.type == TokenType::FLOAT) {
+                if (floats < FLOAT_ARG_REGS)
+                    ins("movsd", xmm((int)floats), slot);
+                floats++;
+            }
+            else {
+                if (ints < INT_ARG_REGS)
+                    ins("movq", reg64[intArgRegs[ints]], slot);
+                ints++;
+            }
+        }
+
+        for (auto& r : savedRegs)
+            ins("movq", reg64[r.first], std::to_string(r.second) + "(%rbp)");
+        // ڴֵĴβδӲλװ
+        for (const Param& p : f.params) {
+            Operand v = Operand::var(p.name);
+            Location loc = alloc.atEntry(v);
+            if (loc.kind == Location::REG)
+                ins(typeOf(v) == TokenType::FLOAT ? "movsd" : "movq", slotPlace(operandKey(v)),
+                    typeOf(v) == TokenType::FLOAT ? xmm(loc.reg) : reg64[loc.reg]);
+        }
+
+        const auto& code = prog.getInstructions();
+        for (uint32_t i = f.begin + 1; i < f.end; i++) {
+            curInstr = i;
+            emitMoves(alloc.movesBefore(i));
+            genInstruction(code[i], i + 1 == f.end);
+            if (code[i].type != IRType::GOTO)
+                emitMoves(alloc.movesOnExit(i, false));
+        }
+
+        out << ".Lret" << k << ":\n";
+        for (auto& r : savedRegs)
+            ins("movq", std::to_string(r.second) + "(%rbp)", reg64[r.first]);
+        ins("leave");
+        ins("ret");
+
+        for (auto& stub : stubs) {
+            out << stub.first << ":\n";
+            emitMoves(alloc.movesOnExit(stub.second, true));
+            ins("jmp", label(code[stub.second].result));
+        }
+    }
+
+    void genInstruction(const IRInstruction& instr, bool last) {
+        switch (instr.type) {
+        case IRType::ADD:
+        case IRType::SUB:
+        case IRType::MUL:
+        case IRType::DIV:
+            genArith(instr);
+            break;
+        case IRType::LESS:
+        case IRType::GREATER:
+        case IRType::EQUAL_EQUAL:
+        case IRType::NOT_EQUAL:
+            genCompare(instr);
+            break;
+        case IRType::AND:
+        case IRType::OR:
+            truthOf(instr.op1);
+            ins("movb", "%al", "%dl");
+            truthOf(instr.op2);
+            ins(instr.type == IRType::AND ? "andb" : "orb", "%dl", "%al");
+            ins("movzbl", "%al", "%eax");
+            store(instr.result, TokenType::BOOL);
+            break;
+        case IRType::ASSIGN:
+            store(instr.result, loadValue(instr.op1));
+            break;
+
+        case IRType::ALLOC_ARR:
+            loadInt(instr.op1, RDI);
+            ins("shlq", "$3", "%rdi");
+            ins("call", "aya_alloc");
+            store(instr.result, typeOf(instr.result));
+            break;
+        case IRType::LOAD_ARR: {
+            TokenType elem = elementOf(instr.op1, instr.resType);
+            std::string p = elementPlace(instr.op1, instr.op2);
+            ins(elem == TokenType::FLOAT ? "movsd" : "movq", p, elem == TokenType::FLOAT ? "%xmm0" : "%rax");
+            store(instr.result, elem);
+            break;
+        }
+        case IRType::STORE_ARR: {
+            TokenType elem = elementOf(instr.result, instr.resType);
+            bool inXmm = convert(loadValue(instr.op2), elem);
+            std::string p = elementPlace(instr.result, instr.op1);
+            ins(inXmm ? "movsd" : "movq", inXmm ? "%xmm0" : "%rax", p);
+            break;
+        }
+
+        case IRType::CALL:
+            genCall(instr);
+            break;
+        case IRType::RETURN:
+            if (!instr.op1.isNone())
+                convert(loadValue(instr.op1), fn->retType);
+            if (!last)
+                ins("jmp", ".Lret" + std::to_string(fnIndex));
+            break;
+
+        case IRType::LABEL:
+            out << label(instr.result) << ":\n";
+            break;
+        case IRType::GOTO:
+            emitMoves(alloc.movesOnExit(curInstr, true));
+            ins("jmp", label(instr.result));
+            break;
+        case IRType::IF_TRUE_GOTO:
+        case IRType::IF_FALSE_GOTO:
+            genBranch(instr);
+            break;
+
+        case IRType::INPUT: {
+            TokenType t = typeOf(instr.result);
+            if (t == TokenType::FLOAT)
+                ins("call", "aya_read_float");
+            else if (t == TokenType::CHAR)
+                ins("call", "aya_read_char");
+            else
+                ins("call", "aya_read_int");
+            store(instr.result, t == TokenType::FLOAT || t == TokenType::CHAR ? t : TokenType::INT);
+            break;
+        }
+        case IRType::OUTPUT: {
+            TokenType t = typeOf(instr.op1);
+            if (t == TokenType::FLOAT) {
+                loadFloat(instr.op1, 0);
+                ins("call", "aya_print_float");
+            }
+            else {
+                loadInt(instr.op1, RDI);
+                ins("call", t == TokenType::CHAR ? "aya_print_char" : "aya_print_int");
+            }
+            break;
+        }
+
+        case IRType::PARAM:
+        case IRType::FUNC_BEGIN:
+        case IRType::FUNC_END:
+            break;
+        default:
+            throw std::runtime_error("native backend: unsupported IR instruction");
+        }
+    }
+
+    // Ԫͣδ֪ʱָϼ¼
+    TokenType elementOf(const Operand& arr, TokenType fallback) const {
+        TokenType t = elementType(typeOf(arr));
+        return t == TokenType::UNKNOWN ? fallback : t;
+    }
+
+    // ڶֱӵͲĴ
+    std::string intRhs(const Operand& o, Reg r, bool allowImm) {
+        int64_t v;
+        if (allowImm && intImmediate(o, v))
+            return imm(v);
+        loadInt(o, r);
+        return reg64[r];
+    }
+
+    void genArith(const IRInstruction& instr) {
+        if (typeOf(instr.op1) == TokenType::FLOAT || typeOf(instr.op2) == TokenType::FLOAT) {
+            loadFloat(instr.op1, 0);
+            loadFloat(instr.op2, 1);
+            static const char* const ops[] = { "addsd", "subsd", "mulsd", "divsd" };
+            ins(ops[(int)instr.type - (int)IRType::ADD], "%xmm1", "%xmm0");
+            store(instr.result, TokenType::FLOAT);
+            return;
+        }
+        // C++  char / bool Ϊ int 32 λ
+        loadInt(instr.op1, RAX);
+        if (instr.type == IRType::DIV) {
+            loadInt(instr.op2, RCX);
+            ins("cltd");
+            ins("idivl", "%ecx");
+        }
+        else {
+            std::string rhs = intRhs(instr.op2, RCX, true);
+            if (rhs[0] == '%')
+                rhs = "%ecx";
+            static const char* const ops[] = { "addl", "subl", "imull" };
+            ins(ops[(int)instr.type - (int)IRType::ADD], rhs, "%eax");
+        }
+        ins("movslq", "%eax", "%rax");
+        store(instr.result, TokenType::INT);
+    }
+
+    void genCompare(const IRInstruction& instr) {
+        if (typeOf(instr.op1) == TokenType::FLOAT || typeOf(instr.op2) == TokenType::FLOAT) {
+            loadFloat(instr.op1, 0);
+            loadFloat(instr.op2, 1);
+            //  NaN Ƚʱֻ != Ϊ
+            switch (instr.type) {
+            case IRType::LESS:
+                ins("ucomisd", "%xmm0", "%xmm1");
+                ins("seta", "%al");
+                break;
+            case IRType::GREATER:
+                ins("ucomisd", "%xmm1", "%xmm0");
+                ins("seta", "%al");
+                break;
+            case IRType::EQUAL_EQUAL:
+                ins("ucomisd", "%xmm1", "%xmm0");
+                ins("sete", "%al");
+                ins("setnp", "%cl");
+                ins("andb", "%cl", "%al");
+                break;
+            default:
+                ins("ucomisd", "%xmm1", "%xmm0");
+                ins("setne", "%al");
+                ins("setp", "%cl");
+                ins("orb", "%cl", "%al");
+                break;
+            }
+        }
+        else {
+            loadInt(instr.op1, RAX);
+            ins("cmpq", intRhs(instr.op2, RCX, true), "%rax");
+            switch (instr.type) {
+            case IRType::LESS:        ins("setl", "%al"); break;
+            case IRType::GREATER:     ins("setg", "%al"); break;
+            case IRType::EQUAL_EQUAL: ins("sete", "%al"); break;
+            default:                  ins("setne", "%al"); break;
+            }
+        }
+        ins("movzbl", "%al", "%eax");
+        store(instr.result, TokenType::BOOL);
+    }
+
+    // Ƿ 0 al
+    void truthOf(const Operand& o) {
+        if (o.isImm()) {
+            bool v = o.kind == OperandKind::FLOAT ? o.f != 0 :
+                (o.kind == OperandKind::CHAR ? (int8_t)o.i : o.i) != 0;
+            ins("movb", v ? "$1" : "$0", "%al");
+            return;
+        }
+        if (typeOf(o) == TokenType::FLOAT) {
+            loadFloat(o, 0);
+            truthOfValue(true);
+        }
+        else {
+            ins("cmpq", "$0", place(o));
+            ins("setne", "%al");
+        }
+    }
+
+    void genBranch(const IRInstruction& instr) {
+        bool onTrue = instr.type == IRType::IF_TRUE_GOTO;
+        const Operand& c = instr.op1;
+        std::string target = branchTarget(instr);
+        if (c.isImm()) {
+            bool v = c.kind == OperandKind::FLOAT ? c.f != 0 :
+                (c.kind == OperandKind::CHAR ? (int8_t)c.i : c.i) != 0;
+            if (v == onTrue)
+                ins("jmp", target);
+            return;
+        }
+        if (typeOf(c) == TokenType::FLOAT) {
+            loadFloat(c, 0);
+            ins("xorpd", "%xmm1", "%xmm1");
+            ins("ucomisd", "%xmm1", "%xmm0");
+            if (onTrue) {
+                ins("jne", target);
+                ins("jp", target);
+            }
+            else {
+                ins("jp", "1f");
+                ins("je", target);
+                out << "1:\n";
+            }
+            return;
+        }
+        ins("cmpq", "$0", place(c));
+        ins(onTrue ? "jne" : "je", target);
+    }
+
+    /*
+    * ãʵ÷ŽջϵݴװĴ
+    * ݴײջϴݵĲʱ rsp ָ
+    */
+    void genCall(const IRInstruction& instr) {
+        auto it = functions.find(instr.op1.id);
+        if (it == functions.end())
+            throw std::runtime_error("native backend: call to undefined function " + prog.str(instr.op1));
+        const IRFunction& callee = *it->second;
+        const Operand* args = prog.args(instr);
+
+        struct ArgSlot {
+            bool inXmm;
+            int reg;            // ĴţջϲΪ -1
+            int32_t offset;     // ݴеƫ
+        };
+        std::vector<ArgSlot> slotsOf(instr.argCount);
+        size_t ints = 0, floats = 0, stacked = 0;
+        for (uint32_t i = 0; i < instr.argCount; i++) {
+            const Param& p = callee.params[i];
+            ArgSlot& s = slotsOf[i];
+            s.inXmm = !p.isRef && p.type == TokenType::FLOAT;
+            size_t& n = s.inXmm ? floats : ints;
+            s.reg = n < (s.inXmm ? FLOAT_ARG_REGS : INT_ARG_REGS) ? (int)n : -1;
+            n++;
+            if (s.reg < 0)
+                s.offset = 8 * (int32_t)stacked++;
+        }
+        int32_t staged = (int32_t)stacked;
+        for (ArgSlot& s : slotsOf)
+            if (s.reg >= 0)
+                s.offset = 8 * staged++;
+        int32_t area = (8 * staged + 15) & ~15;
+        if (area)
+            ins("subq", imm(area), "%rsp");
+
+        for (uint32_t i = 0; i < instr.argCount; i++) {
+            const Param& p = callee.params[i];
+            const Operand& a = args[i];
+            std::string dst = std::to_string(slotsOf[i].offset) + "(%rsp)";
+            if (p.isRef) {
+                loadAddress(a);
+                ins("movq", "%rax", dst);
+                continue;
+            }
+            bool inXmm = convert(loadValue(a), p.type);
+            ins(inXmm ? "movsd" : "movq", inXmm ? "%xmm0" : "%rax", dst);
+        }
+        for (const ArgSlot& s : slotsOf) {
+            if (s.reg < 0)
+                continue;
+            std::string src = std::to_string(s.offset) + "(%rsp)";
+            if (s.inXmm)
+                ins("movsd", src, xmm(s.reg));
+            else
+                ins("movq", src, reg64[intArgRegs[s.reg]]);
+        }
+        if (area && !stacked) {
+            ins("addq", imm(area), "%rsp");
+            area = 0;
+        }
+        ins("call", functionLabel(callee.name));
+        if (area)
+            ins("addq", imm(area), "%rsp");
+        if (!instr.result.isNone())
+            store(instr.result, callee.retType);
+    }
+
+    // ref ʵεĵַŽ rax
+    void loadAddress(const Operand& a) {
+        if (a.isVar() && refParams.count(a.id)) {
+            ins("movq", std::to_string(slots.at(operandKey(a))) + "(%rbp)", "%rax");
+            return;
+        }
+        if (!a.isLocation() && a.kind != OperandKind::ELEM)
+            throw std::runtime_error("native backend: ref argument is not a location");
+        ins("leaq", place(a), "%rax");
+    }
+};
+
+}
+
+void X86CodeGen::generate(IRProgram& ir, std::ostream& out) {
+    AsmWriter(ir, out, registerAllocation).run();
+}
+
+void X86CodeGen::generateAndAssemble(IRProgram& ir, const std::string& asmFile, const std::string& outputExe) {
+    std::ofstream out(asmFile);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot open output file");
+    }
+    generate(ir, out);
+    out.close();
+
+    std::string obj = outputExe + ".o";
+    std::string cmd = "as -o \"" + obj + "\" \"" + asmFile + "\" && ld -o \"" + outputExe + "\" \"" + obj + "\"";
+    int ret = system(cmd.c_str());
+    std::remove(obj.c_str());
+    if (ret != 0) {
+        throw std::runtime_error("Assembling failed");
+    }
+
+    std::cout << "Compilation succeeded: " << outputExe << "\n";
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include "IR.h"
+
+/*
+* x86-64 
+* 壺 IRProgram ֱӷ GASAT&T ﷨࣬ as / ld  Linux ִļ g++
+* Լ
+*	System V Լ / ָη rdi rsi rdx rcx r8 r9float  xmm0-xmm7ѹջ
+*	ֵ rax / xmm0ref βδַ
+*	ֵȷɨֵļĴûмĴʱջ֡Լ 8 ֽڲλ
+*	ÿֵռ 8 ֽڣint  32 λչchar ضΪ 8 λbool Ϊ 0/1float Ϊ doubleΪԪָ
+*	Ԫͳһ 8 ֽڣʱ bump 䣬ͷţ C++ ˵ new һ£
+*	ʱ롢ڴ䡢 _startԻʽһֻ Linux ϵͳ
+*	ʽ C++ ˵ std::cout һ£float  %g ȡ 6 λЧ֣bool  0/1
+*/
+class X86CodeGen {
+public:
+    // ɨĴ䣨RegAlloc.hرʱÿֵջ
+    bool registerAllocation = true;
+
+    // ֻɻ
+    void generate(IRProgram& ir, std::ostream& out);
+
+    // д asmFileٵ as / ld  outputExe
+    void generateAndAssemble(IRProgram& ir, const std::string& asmFile, const std::string& outputExe);
+};
@@ -4,7 +4,9 @@
 #include"Parser.h"
 #include "utf8.h"
 #include"Lexer.h"
+#include"SourceBuffer.h"
 #include"IR.h"
+#include"PassManager.h"
 #include <cstdio>
 #include <filesystem>
 
@@ -15,41 +17,90 @@
 #endif
 
 #include"CodeGen .h"
+#include"X86Gen.h"
+#include"Bytecode.h"
+#include"VM.h"
+#include"CompileCache.h"
 
 
-std::vector<uint32_t> loadSourceFile(const std::string& inputFile) {
-    std::ifstream file(inputFile, std::ios::binary);
-    std::string bytes((std::istreambuf_iterator<char>(file)),
-        std::istreambuf_iterator<char>());
+// ǰŻԴ -> Ż IR
+static void compileToIR(std::string_view source, IRProgram& ir, int optLevel, bool verifyIR, bool timePasses) {
+    Lexer lexer(source);
 
-    if (!utf8::is_valid(bytes.begin(), bytes.end()))
-        throw std::runtime_error("Invalid UTF-8 in source file");
+    // 뵥Ԫȫ AST ڵ㣬뿪ʱͷ
+    AstArena arena;
+    Parser parser(lexer, arena);
+    std::vector<Statement*>res;
 
-    std::vector<uint32_t> result;
-    auto it = bytes.begin();
-    while (it != bytes.end())
-        result.push_back(utf8::next(it, bytes.end()));
-    return result;
+   // parseStatement ļĩβ NULLŽб
+   Statement* temp = parser.parseStatement();
+   while (temp != NULL) {
+       res.push_back(temp);
+       temp = parser.parseStatement();
+   }
+
+
+    SemanticAnalyzer sema;
+    for (auto& i : res) {
+        sema.analyze(i);
+    }
+
+
+    for (auto& i : res) {
+        ir.visitStatement(i);
+    }
+    //ir.print();
+
+    PassManager passes;
+    passes.verify = verifyIR;
+    buildPipeline(passes, optLevel);
+    passes.run(ir);
+    if (timePasses)
+        passes.printStats(std::cerr);
 }
 
 int main(int argc, char* argv[]) {
-#if not _DEBUG
+    std::string inputFile = "test.aya";
+    std::string outputFile = "test.cpp";
+    bool run = false;
+    int optLevel = 2;
+    bool timePasses = false;
+    bool native = false;
+    bool keepAsm = false;
+    bool jit = true;
+    bool useCache = true;
+    std::string hostProfile = "release";
+#if _DEBUG
+    bool verifyIR = true;
+    int firstOption = 1;
+#else
+    bool verifyIR = false;
+    int firstOption = 2;
     if (argc < 2) {
         std::cerr << "÷: ayanami <source.aya> [ѡ]\n";
         std::cerr << "ѡ:\n"
             << "  -o <file>     exeļ\n"
-            << "  run           벢ִ\n";
+            << "  run           ִֽУⲿ -native ͬʱɲбس\n"
+            << "  -O0 -O1 -O2   ŻĬ -O2\n"
+            << "  -time-passes  ÿŻ pass ĺʱĶ\n"
+            << "  -verify-ir    ÿ pass ֮ IR\n"
+            << "  -native       ֱ x86-64 ࣬ as / ld ӣLinux g++\n"
+            << "  -S             -native ɵĻļ\n"
+            << "  -no-jit       run ʱִֻУȵ㺯ʱɱش\n"
+            << "  -no-cache     ʹñ뻺棨Ĭ ~/.cache/ayanami AYANAMI_CACHE_DIR ָ\n"
+            << "  -cxx-profile <debug|release|native>\n"
+            << "                ɵ C++ ı뵵λĬ release-O2 CXX / CXXFLAGS ɸǱ׷Ӳ\n";
         return 1;
     }
 
-    std::string inputFile = argv[1];
-    std::string outputFile = inputFile;
+    inputFile = argv[1];
+    outputFile = inputFile;
     outputFile = outputFile.substr(0, outputFile.size() - 4);
     outputFile += ".cpp";
-    bool run = false;
+#endif
 
     // в
-    for (int i = 2; i < argc; ++i) {
+    for (int i = firstOption; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "-o" && i + 1 < argc) {
             outputFile = argv[++i];
@@ -58,53 +109,107 @@ int main(int argc, char* argv[]) {
         else if (arg == "run") {
             run = true;
         }
+        else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            optLevel = arg[2] - '0';
+        }
+        else if (arg == "-time-passes") {
+            timePasses = true;
+        }
+        else if (arg == "-verify-ir") {
+            verifyIR = true;
+        }
+        else if (arg == "-native") {
+            native = true;
+        }
+        else if (arg == "-S") {
+            keepAsm = true;
+        }
+        else if (arg == "-no-jit") {
+            jit = false;
+        }
+        else if (arg == "-no-cache") {
+            useCache = false;
+        }
+        else if (arg == "-cxx-profile" && i + 1 < argc) {
+            hostProfile = argv[++i];
+        }
     }
-#endif
     try {
-        std::string inputFile = "test.aya";
-        std::string outputFile = "test.cpp";
-
         std::cerr << "start compiling\n";
-        std::vector<uint32_t> src = loadSourceFile(inputFile);
-
-        Lexer lexer(src);
-
-        std::vector<Token> tokens = lexer.tokenize();
-        //for (int i = 0; i < tokens.size(); i++) {
-        //    std::cout << tokens[i] << " no." << i << std::endl;
-        //}
-
-        Parser parser(tokens);
-        std::vector<Statement*>res;
+        SourceBuffer src(inputFile);
+
+        // Ҫִļʱֱ
+        if (run && !native) {
+            IRProgram ir;
+            compileToIR(src.view(), ir, optLevel, verifyIR, timePasses);
+            BcProgram bc = compileBytecode(ir);
+            std::cerr << "\n--------vm output---------\n\n";
+            VM vm(bc);
+            vm.jit = jit;
+            // ʱ뱾سһԷ 0 ״̬˳Ϣд stderr
+            try {
+                return vm.run();
+            }
+            catch (const std::runtime_error& ex) {
+                std::cerr << "\n" << ex.what() << "\n";
+                return 1;
+            }
+        }
 
-       Statement* temp = NULL;
-       do {
-           temp = parser.parseStatement();
-           res.push_back(temp);
-       } while (temp != NULL);
+        std::string exeFile = outputFile.substr(0, outputFile.size() - 4);
+        std::string asmFile = exeFile + ".s";
+        // ʵʲļg++  Windows ϻᲹ .exe
+        std::string binary = exeFile;
+#ifdef _WIN32
+        if (!native)
+            binary += ".exe";
+#endif
 
+        CodeGen cg;
+        cg.profile = hostProfile;
+#if _DEBUG
+        cg.keepSource = true;
+#endif
 
-        SemanticAnalyzer sema;
-        for (auto& i : res) {
-            sema.analyze(i);
+        // Ҫм pass ͳʱ߻棻flags Ӱѡ
+        bool cacheable = useCache && !keepAsm && !timePasses && !verifyIR;
+        std::string key;
+        if (cacheable) {
+            std::string flags = native ? std::string("native")
+                : "cpp " + cg.compileCommand() + "\n" + CodeGen::compilerVersion();
+            flags += " -O" + std::to_string(optLevel);
+            key = CompileCache::key(src.view(), flags);
         }
-
-
-        IRProgram ir(sema);
-        for (auto& i : res) {
-            ir.visitStatement(i);
+        CompileCache cache;
+        if (cacheable && cache.fetch(key, binary)) {
+            std::cerr << "cache hit " << key << ": " << binary << "\n";
         }
-        //ir.print();
-
-
-        CodeGen cg;
-        cg.generateAndCompile(ir, outputFile, outputFile.substr(0, outputFile.size() - 4));
+        else {
+            IRProgram ir;
+            compileToIR(src.view(), ir, optLevel, verifyIR, timePasses);
+            if (native) {
+                X86CodeGen x86;
+                x86.registerAllocation = optLevel > 0;
+                x86.generateAndAssemble(ir, asmFile, exeFile);
+            }
+            else {
+                cg.generateAndCompile(ir, outputFile, exeFile);
+            }
+            if (cacheable)
+                cache.store(key, binary);
+        }
+        if (cacheable)
+            cache.printStats(std::cerr);
 
 #if not _DEBUG
-        std::filesystem::remove(outputFile);
+        if (native && !keepAsm)
+            std::filesystem::remove(asmFile);
         if (run) {
-            outputFile = outputFile.substr(0, outputFile.size() - 4);
-            outputFile += ".exe";
+            outputFile = binary;
+#ifndef _WIN32
+            if (std::filesystem::path(outputFile).is_relative())
+                outputFile = "./" + outputFile;
+#endif
             std::cerr << "start " << outputFile << std::endl;
             std::cerr << "\n--------exe output---------\n\n";
             system(outputFile.c_str());
@@ -1,52 +1,18 @@
 #pragma once
 #include<vector>
 #include <string>
+#include <string_view>
+#include <iterator>
+#include <cstdint>
 #include <unordered_set>
 #include <iostream>
 #include "utf8.h"
+#include "Interner.h"
 
 #ifndef UTIL_H
 #define UTIL_H
 #endif
 
-inline std::vector<uint32_t> stringToUint32ts(const std::string s) {
-    std::vector<uint32_t> result;
-    auto it = s.begin();
-    while (it != s.end())
-        result.push_back(utf8::next(it, s.end()));
-    return result;
-}
-
-inline std::string uint32tsToString(const std::vector<uint32_t>& utf32) {
-    std::string utf8;
-    for (uint32_t codepoint : utf32) {
-        if (codepoint <= 0x7F) {
-            utf8.push_back(static_cast<char>(codepoint));
-        }
-        else if (codepoint <= 0x7FF) {
-            utf8.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
-            utf8.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-        }
-        else if (codepoint <= 0xFFFF) {
-            utf8.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
-            utf8.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-            utf8.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-        }
-        else if (codepoint <= 0x10FFFF) {
-            utf8.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
-            utf8.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
-            utf8.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-            utf8.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-        }
-        else {
-            // Ƿ Unicode 㣬滻Ϊ U+FFFD
-            utf8 += "\xEF\xBF\xBD";
-        }
-    }
-    return utf8;
-}
-
-
 enum class TokenType {
     IDENTIFIER,     // ʶ
     BOOL_LITERAL,
@@ -106,7 +72,7 @@ enum class TokenType {
 
 struct Token {
     TokenType type;
-    std::vector<uint32_t> lexeme;
+    SymId lexeme;
     int line;
 
     friend std::ostream& operator<<(std::ostream& out, Token& a) {
@@ -171,60 +137,108 @@ struct Token {
         }
         out << ",";
 
-        std::string utf8_str = uint32tsToString(a.lexeme);
-        out << utf8_str << "]";
+        out << symName(a.lexeme) << "]";
         return out;
     }
 };
 
-class Keyword {
-private:
-    std::vector<std::vector<uint32_t>> keywords;
-public:
-    Keyword(){
-        std::vector<std::string> rawKeywords = {
-         "fn", "if", "for", "while", "do","in","continue","break", "return",
-         "ref", "const", "bool", "int", "float", "char","void","true","false",
-         "+","-","*","/","=","||","&&","==","!=","<",">",
-         "(",")","{","}",",","[","]"
-        };  
-
-        for (const auto& kw : rawKeywords) {
-           keywords.push_back(stringToUint32ts(kw));
-        }
-    }
+struct KeywordEntry {
+    std::string_view text;
+    TokenType type;
+};
 
-    bool isKeyword(const std::vector<uint32_t>& check) {
-        for (auto& kw : keywords) {
-            if (kw == check) {
-                return true;
-                break;
-            }
-        }
+/*
+* ؼ/
+* ÿֱдӦ TokenType±öֵ
+*  TokenType ʱͱλ
+*/
+inline constexpr KeywordEntry keywordTable[] = {
+    { "fn", TokenType::FN }, { "if", TokenType::IF }, { "for", TokenType::FOR },
+    { "while", TokenType::WHILE }, { "do", TokenType::DO }, { "in", TokenType::IN },
+    { "continue", TokenType::CONTINUE }, { "break", TokenType::BREAK },
+    { "return", TokenType::RETURN }, { "ref", TokenType::REF }, { "const", TokenType::CONST },
+    { "bool", TokenType::BOOL }, { "int", TokenType::INT }, { "float", TokenType::FLOAT },
+    { "char", TokenType::CHAR }, { "void", TokenType::VOID },
+    { "true", TokenType::TRUE }, { "false", TokenType::FALSE },
+    { "input", TokenType::INPUT }, { "output", TokenType::OUTPUT },
+
+    { "+", TokenType::ADD }, { "-", TokenType::SUB }, { "*", TokenType::MUL },
+    { "/", TokenType::DEV }, { "=", TokenType::EQUAL }, { "||", TokenType::OR },
+    { "&&", TokenType::AND }, { "==", TokenType::EQUAL_EQUAL }, { "!=", TokenType::NOT_EQUAL },
+    { "<", TokenType::LESS }, { ">", TokenType::GREATER },
+
+    { "(", TokenType::LPAREN }, { ")", TokenType::RPAREN }, { "{", TokenType::LBRACE },
+    { "}", TokenType::RBRACE }, { ",", TokenType::COMMA },
+    { "[", TokenType::LSQUARE }, { "]", TokenType::RSQUARE },
+};
+
+/*
+* ؼʶ
+*  (, ַ, ڶַ) ɵϣλΨһѡ
+* һζȽϣ O() Ҳڴ档
+* ϣڱڹ죬κγͻᱻ static_assert 
+*/
+constexpr size_t KEYWORD_SLOTS = 128;
+
+constexpr size_t keywordHash(std::string_view word) {
+    unsigned char first = (unsigned char)word[0];
+    unsigned char second = word.size() > 1 ? (unsigned char)word[1] : first;
+    return (word.size() + 16 * first + 9 * second) % KEYWORD_SLOTS;
+}
+
+struct KeywordSlots {
+    int8_t index[KEYWORD_SLOTS];
+    bool collision;
+};
 
-        return false;
+constexpr KeywordSlots buildKeywordSlots() {
+    KeywordSlots slots{};
+    slots.collision = false;
+    for (size_t i = 0; i < KEYWORD_SLOTS; i++)
+        slots.index[i] = -1;
+    for (size_t i = 0; i < std::size(keywordTable); i++) {
+        size_t h = keywordHash(keywordTable[i].text);
+        if (slots.index[h] != -1)
+            slots.collision = true;
+        slots.index[h] = (int8_t)i;
     }
+    return slots;
+}
 
-    TokenType getEnum(std::vector<uint32_t>& word) {
-        int i = 0;
-        for (i = 0; i < keywords.size(); i++) {
-            if (word == keywords[i])
-                break;
-        }
+inline constexpr KeywordSlots keywordSlots = buildKeywordSlots();
 
+class Keyword {
+public:
+    // ǹؼʱ TokenType::UNKNOWN
+    static constexpr TokenType getEnum(std::string_view word) {
+        if (word.empty())
+            return TokenType::UNKNOWN;
+        int8_t i = keywordSlots.index[keywordHash(word)];
+        if (i == -1 || keywordTable[i].text != word)
+            return TokenType::UNKNOWN;
+        return keywordTable[i].type;
+    }
 
-        if (i < 18)
-            return (TokenType)((int)TokenType::KEYWORD + i+1);
-        else if (i < 29)
-            return (TokenType)((int)TokenType::KEYWORD + i+2);
-        else 
-            return (TokenType)((int)TokenType::KEYWORD + i+3);
+    static constexpr bool isKeyword(std::string_view word) {
+        return getEnum(word) != TokenType::UNKNOWN;
     }
 };
 
+static_assert(!keywordSlots.collision, "keyword perfect hash has a collision, adjust keywordHash");
+constexpr bool keywordTableRoundTrips() {
+    for (const KeywordEntry& e : keywordTable) {
+        if (Keyword::getEnum(e.text) != e.type)
+            return false;
+    }
+    return true;
+}
+
+static_assert(keywordTableRoundTrips(), "keyword table out of sync");
+static_assert(!Keyword::isKeyword("main"), "keyword table out of sync");
+
 struct Param {
     TokenType type;
-    std::vector<uint32_t> name;
+    SymId name;
     bool isRef;
 };
 